@@ -46,7 +46,7 @@ full_tests = [
     "sanr400_0.5.clq", "sanr400_0.7.clq" 
 ]
 
-def run_instances(hardware, run_type):
+def run_instances(hardware, run_type, proof_flags):
     # Control how many times the instances are run for each code test case
     temp_cwd = os.getcwd()
     for i in range (5):
@@ -64,7 +64,7 @@ def run_instances(hardware, run_type):
         for filename in laptop_tests: # CHANGE
             print("#",end='',flush=True) #outputs a hash character per instance run
             proofname = "proof_outputs/" + filename[:-4] + "_proof"
-            os.system('./glasgow_clique_solver --prove ' + proofname + ' test-instances/DIMACS_all_ascii/' + filename + ' >> ' + output_filename)
+            os.system('./glasgow_clique_solver --prove ' + proofname + ' ' + proof_flags + ' test-instances/DIMACS_all_ascii/' + filename + ' >> ' + output_filename)
         print("")
 
 def main():
@@ -72,61 +72,28 @@ def main():
     hardware = sys.argv[1]
     cwd = os.getcwd()
 
-    # compile code for 1st test - unaltered code
+    # the proof logging variants are chosen at runtime, so we only need one build
     os.chdir(cwd + '/build')
-    os.system('cmake .. -DCODETYPE:STRING=original')
+    os.system('cmake ..')
     os.system('make')
     os.chdir(cwd)
-    # for each test instance record runtime
-    run_instances(hardware, "Original")
-
-    # compile code for 2nd test - /n code
-    os.chdir(cwd + '/build')
-    os.system('cmake .. -DCODETYPE:STRING=newline')
-    os.system('make')
-    os.chdir(cwd)
-    # for each test instance record runtime
-    run_instances(hardware, "Newline")
 
-    # compile code for 3rd test - fmt lib
-    os.chdir(cwd + '/build')
-    os.system('cmake .. -DCODETYPE:STRING=fmt')
-    os.system('make')
-    os.chdir(cwd)
-    # for each test instance record runtime
-    run_instances(hardware, "FMT")
-
-    # compile code for 4th test - colour classes fix
-    os.chdir(cwd + '/build')
-    os.system('cmake .. -DCODETYPE:STRING=colour')
-    os.system('make')
-    os.chdir(cwd)
-    # for each test instance record runtime
-    run_instances(hardware, "Colour_Class")
-
-    # compile code for 5th test - vector vs map
-    os.chdir(cwd + '/build')
-    os.system('cmake .. -DCODETYPE:STRING=vector')
-    os.system('make')
-    os.chdir(cwd)
-    # for each test instance record runtime
-    run_instances(hardware, "Vector")
-
-    # compile code for 6th test - no comments included
-    os.chdir(cwd + '/build')
-    os.system('cmake .. -DCODETYPE:STRING=comment')
-    os.system('make')
-    os.chdir(cwd)
-    # for each test instance record runtime
-    run_instances(hardware, "Comment")
-
-    # compile code for 7th test - max improvement attempt (newline w/ colour class fix, no comments)
-    os.chdir(cwd + '/build')
-    os.system('cmake .. -DCODETYPE:STRING=max')
-    os.system('make')
-    os.chdir(cwd)
     # for each test instance record runtime
-    run_instances(hardware, "Max")
+    run_instances(hardware, "Original", "--proof-sink=iostream-endl")
+    # \n rather than endl
+    run_instances(hardware, "Newline", "--proof-sink=iostream")
+    # fmt lib
+    run_instances(hardware, "FMT", "--proof-sink=fmt")
+    # colour classes fix
+    run_instances(hardware, "Colour_Class", "--proof-sink=iostream-endl --proof-skip-singletons")
+    # vector vs map
+    run_instances(hardware, "Vector", "--proof-sink=iostream-endl --proof-dense-ids")
+    # no comments included
+    run_instances(hardware, "Comment", "--proof-sink=iostream-endl --proof-no-comments")
+    # max improvement attempt (newline w/ colour class fix, no comments)
+    run_instances(hardware, "Max", "--proof-sink=iostream --proof-skip-singletons --proof-no-comments")
+    # our own buffering and write(2), with everything else from max
+    run_instances(hardware, "Raw", "--proof-sink=raw --proof-skip-singletons --proof-no-comments")
 
 if __name__ == "__main__":
     main()
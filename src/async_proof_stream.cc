@@ -0,0 +1,217 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#include "async_proof_stream.hh"
+#include "parallel_compressing_stream.hh"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <streambuf>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using std::condition_variable;
+using std::deque;
+using std::make_unique;
+using std::move;
+using std::mutex;
+using std::ostream;
+using std::pair;
+using std::size_t;
+using std::streambuf;
+using std::streamsize;
+using std::thread;
+using std::unique_lock;
+using std::unique_ptr;
+using std::vector;
+
+namespace
+{
+    class AsyncBuffer : public streambuf
+    {
+        private:
+            unique_ptr<ostream> _underlying;
+            size_t _buffer_size;
+            vector<unique_ptr<char[]> > _buffers;
+
+            mutex _mutex;
+            condition_variable _cv;
+            deque<unsigned> _free;
+            deque<pair<unsigned, size_t> > _full;
+            bool _stopping = false, _failed = false;
+
+            unsigned _current = 0;
+            thread _writer;
+
+            auto writer_loop() -> void
+            {
+                unique_lock<mutex> guard(_mutex);
+                while (true) {
+                    _cv.wait(guard, [&] { return _stopping || ! _full.empty(); });
+                    if (_full.empty())
+                        break;
+
+                    auto [ index, length ] = _full.front();
+                    _full.pop_front();
+
+                    // don't hold the lock whilst doing the actual writing, so
+                    // the search thread can keep filling the other buffers
+                    guard.unlock();
+                    bool ok = false;
+                    try {
+                        ok = bool(_underlying->write(_buffers[index].get(), length));
+                    }
+                    catch (...) {
+                    }
+                    guard.lock();
+
+                    if (! ok)
+                        _failed = true;
+                    _free.push_back(index);
+                    _cv.notify_all();
+                }
+            }
+
+            // give the current buffer to the writer thread, and wait until
+            // we have a free one to carry on with
+            auto hand_off() -> bool
+            {
+                unique_lock<mutex> guard(_mutex);
+                if (_stopping)
+                    return false;
+
+                if (pptr() != pbase()) {
+                    _full.emplace_back(_current, pptr() - pbase());
+                    _cv.notify_all();
+                }
+                else
+                    _free.push_back(_current);
+
+                _cv.wait(guard, [&] { return ! _free.empty(); });
+                _current = _free.front();
+                _free.pop_front();
+                setp(_buffers[_current].get(), _buffers[_current].get() + _buffer_size);
+
+                return ! _failed;
+            }
+
+        protected:
+            auto overflow(int_type c) -> int_type override
+            {
+                if (! hand_off())
+                    return traits_type::eof();
+
+                if (! traits_type::eq_int_type(c, traits_type::eof())) {
+                    *pptr() = traits_type::to_char_type(c);
+                    pbump(1);
+                }
+
+                return traits_type::not_eof(c);
+            }
+
+            auto xsputn(const char * s, streamsize n) -> streamsize override
+            {
+                streamsize done = 0;
+                while (done < n) {
+                    if (pptr() == epptr() && ! hand_off())
+                        return done;
+
+                    streamsize chunk = std::min<streamsize>(n - done, epptr() - pptr());
+                    traits_type::copy(pptr(), s + done, chunk);
+                    pbump(int(chunk));
+                    done += chunk;
+                }
+
+                return done;
+            }
+
+            auto sync() -> int override
+            {
+                // deliberately lazy: std::endl on every line must not turn
+                // into a buffer hand-off per line
+                return 0;
+            }
+
+        public:
+            AsyncBuffer(unique_ptr<ostream> && underlying, size_t buffer_size, unsigned number_of_buffers) :
+                _underlying(move(underlying)),
+                _buffer_size(buffer_size)
+            {
+                if (number_of_buffers < 2)
+                    number_of_buffers = 2;
+
+                for (unsigned i = 0 ; i < number_of_buffers ; ++i) {
+                    _buffers.emplace_back(make_unique<char[]>(_buffer_size));
+                    if (0 != i)
+                        _free.push_back(i);
+                }
+
+                setp(_buffers[_current].get(), _buffers[_current].get() + _buffer_size);
+                _writer = thread([this] { writer_loop(); });
+            }
+
+            ~AsyncBuffer() override
+            {
+                close();
+            }
+
+            auto close() -> bool
+            {
+                if (! _writer.joinable())
+                    return ! _failed;
+
+                {
+                    unique_lock<mutex> guard(_mutex);
+                    if (pptr() != pbase())
+                        _full.emplace_back(_current, pptr() - pbase());
+                    setp(nullptr, nullptr);
+                    _stopping = true;
+                    _cv.notify_all();
+                }
+
+                _writer.join();
+
+                // a compressing stream only writes its last blocks when it is
+                // closed, and flushing it doesn't do that, so close it here
+                // to find out whether they could be written
+                if (auto c = dynamic_cast<ParallelCompressingStream *>(_underlying.get()))
+                    c->close();
+                else
+                    _underlying->flush();
+                if (! *_underlying)
+                    _failed = true;
+
+                return ! _failed;
+            }
+    };
+}
+
+struct AsyncProofStream::Imp
+{
+    AsyncBuffer buffer;
+
+    Imp(unique_ptr<ostream> && underlying, size_t buffer_size, unsigned number_of_buffers) :
+        buffer(std::move(underlying), buffer_size, number_of_buffers)
+    {
+    }
+};
+
+AsyncProofStream::AsyncProofStream(unique_ptr<ostream> && underlying, size_t buffer_size, unsigned number_of_buffers) :
+    ostream(nullptr),
+    _imp(make_unique<Imp>(std::move(underlying), buffer_size, number_of_buffers))
+{
+    rdbuf(&_imp->buffer);
+}
+
+AsyncProofStream::~AsyncProofStream()
+{
+    _imp->buffer.close();
+}
+
+auto AsyncProofStream::close() -> void
+{
+    if (! _imp->buffer.close())
+        setstate(badbit);
+}
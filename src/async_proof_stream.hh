@@ -0,0 +1,49 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#ifndef GLASGOW_SUBGRAPH_SOLVER_GUARD_SRC_ASYNC_PROOF_STREAM_HH
+#define GLASGOW_SUBGRAPH_SOLVER_GUARD_SRC_ASYNC_PROOF_STREAM_HH 1
+
+#include <cstddef>
+#include <memory>
+#include <ostream>
+
+/**
+ * An output stream that hands fixed-size buffers to a dedicated writer
+ * thread, which drains them into an underlying stream (a file, or a
+ * compressing filter). The bytes that reach the underlying stream are
+ * exactly the bytes written here, in the same order.
+ *
+ * At most a fixed number of buffers are ever in flight: if the writer
+ * thread falls behind, writing blocks until a buffer becomes free.
+ * Flushing (including std::endl) does not force a hand-off, only close()
+ * or destruction does.
+ */
+class AsyncProofStream : public std::ostream
+{
+    private:
+        struct Imp;
+        std::unique_ptr<Imp> _imp;
+
+    public:
+        static constexpr std::size_t default_buffer_size = 1 << 20;
+        static constexpr unsigned default_number_of_buffers = 4;
+
+        explicit AsyncProofStream(std::unique_ptr<std::ostream> && underlying,
+                std::size_t buffer_size = default_buffer_size,
+                unsigned number_of_buffers = default_number_of_buffers);
+
+        ~AsyncProofStream() override;
+
+        AsyncProofStream(const AsyncProofStream &) = delete;
+        auto operator= (const AsyncProofStream &) -> AsyncProofStream & = delete;
+
+        /**
+         * Hand over anything still buffered, wait for the writer thread to
+         * finish, and flush the underlying stream, or close it if it is a
+         * ParallelCompressingStream. Sets badbit if anything could not be
+         * written. Safe to call more than once.
+         */
+        auto close() -> void;
+};
+
+#endif
@@ -0,0 +1,141 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#ifndef GLASGOW_SUBGRAPH_SOLVER_GUARD_SRC_BITSET_COLOURING_HH
+#define GLASGOW_SUBGRAPH_SOLVER_GUARD_SRC_BITSET_COLOURING_HH 1
+
+#include "svo_bitset.hh"
+#include "bitset_kernels.hh"
+
+#include <vector>
+
+/**
+ * Greedy sequential colouring, in the style of BBMC, working directly on
+ * the words of the bitsets. We keep the range of words that might still
+ * have something left to colour, and shrink it as colour classes are
+ * peeled off, so that sparse sets only pay for the words they occupy.
+ * The caller passes in a range of words outside which the set is known to
+ * be empty, and gets back the range the set actually occupies. Since a
+ * child's set is a subset of its parent's, keeping these per depth means
+ * that a search never looks at words its parent found to be empty.
+ * Within a colour class, words before the one we last coloured from are
+ * known to be empty, and are skipped too. Over a long range, removing a
+ * vertex's neighbours also finds the next vertex to colour.
+ *
+ * The scratch space is allocated once, and reused for every colouring.
+ * Colouring does not recurse, so one of these is enough for a search.
+ * Bitset_ is SVOBitset, or a FixedBitset.
+ */
+template <typename Bitset_>
+class BitsetColouring
+{
+    private:
+        using BitWord = SVOBitset::BitWord;
+
+        const std::vector<Bitset_> & _adj;
+        unsigned _n_words;
+        std::vector<BitWord> _left, _q;
+
+    public:
+        /// Masking fewer words than this is done inline
+        static constexpr unsigned long_range = 8;
+
+        /// The words from lo up to but not including hi
+        struct WordRange
+        {
+            unsigned lo, hi;
+        };
+
+        /**
+         * The adjacency bitsets must outlive us, and must not be resized.
+         */
+        BitsetColouring(const std::vector<Bitset_> & adj, unsigned size) :
+            _adj(adj),
+            _n_words((size + SVOBitset::bits_per_word - 1) / SVOBitset::bits_per_word),
+            _left(_n_words),
+            _q(_n_words)
+        {
+        }
+
+        /**
+         * Every word, for when nothing is known about a set.
+         */
+        auto all_words() const -> WordRange
+        {
+            return WordRange{ 0, _n_words };
+        }
+
+        /**
+         * Colour the set whose i'th word is word(i), which must be zero
+         * outside range. For each colour class in turn, calls vertex(v) for
+         * each of its vertices in increasing order, and then end_class(n),
+         * where n is the size of the class. Afterwards, range is narrowed to
+         * the words that were not zero.
+         */
+        template <typename Word_, typename Vertex_, typename EndClass_>
+        auto colour(WordRange & range, const Word_ & word, const Vertex_ & vertex, const EndClass_ & end_class) -> void
+        {
+            BitWord * left = _left.data();
+            BitWord * q = _q.data();
+
+            // copy the set, and find the range of words that have anything in them
+            unsigned lo = range.hi, hi = range.lo;
+            for (unsigned i = range.lo ; i < range.hi ; ++i) {
+                left[i] = word(i);
+                if (0 != left[i]) {
+                    if (lo == range.hi)
+                        lo = i;
+                    hi = i + 1;
+                }
+            }
+
+            range = lo < hi ? WordRange{ lo, hi } : WordRange{ 0, 0 };
+
+            // while we've things left to colour
+            while (lo < hi) {
+                // things that can still be given this colour
+                for (unsigned i = lo ; i < hi ; ++i)
+                    q[i] = left[i];
+
+                unsigned q_lo = lo, n = 0;
+                while (true) {
+                    while (q_lo < hi && 0 == q[q_lo])
+                        ++q_lo;
+                    if (q_lo == hi)
+                        break;
+
+                    // first thing we can colour
+                    int bit = __builtin_ctzll(q[q_lo]);
+                    int v = q_lo * SVOBitset::bits_per_word + bit;
+                    left[q_lo] &= ~(BitWord{ 1 } << bit);
+                    q[q_lo] &= ~(BitWord{ 1 } << bit);
+
+                    vertex(v);
+                    ++n;
+
+                    // can't give anything adjacent to this the same colour. over
+                    // a long range, this also finds the next thing to colour,
+                    // but a short range isn't worth the call
+                    const BitWord * a = _adj[v].words();
+                    if (hi - q_lo >= long_range) {
+                        auto f = bitset_kernels.and_not_find_first(q + q_lo, a + q_lo, hi - q_lo);
+                        if (BitsetKernels::npos == f)
+                            break;
+                        q_lo += f / SVOBitset::bits_per_word;
+                    }
+                    else {
+                        for (unsigned i = q_lo ; i < hi ; ++i)
+                            q[i] &= ~a[i];
+                    }
+                }
+
+                end_class(n);
+
+                while (lo < hi && 0 == left[lo])
+                    ++lo;
+                while (hi > lo && 0 == left[hi - 1])
+                    --hi;
+            }
+        }
+};
+
+#endif
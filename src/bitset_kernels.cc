@@ -0,0 +1,431 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#include "bitset_kernels.hh"
+#include "configuration.hh"
+
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#  include <immintrin.h>
+#  define GLASGOW_BITSET_KERNELS_X86 1
+#endif
+
+using std::string;
+using std::string_view;
+
+namespace
+{
+    using BitWord = BitsetKernels::BitWord;
+    constexpr unsigned bits_per_word = sizeof(BitWord) * 8;
+    constexpr unsigned npos = BitsetKernels::npos;
+
+    // The scalar loops, which are always inlined, so that when they are
+    // used from a function with a target attribute they are compiled for
+    // that target (which gets us hardware popcnt, for example).
+#define GLASGOW_BITSET_ALWAYS_INLINE __attribute__((always_inline)) inline
+
+    GLASGOW_BITSET_ALWAYS_INLINE auto scalar_and_with(BitWord * a, const BitWord * b, unsigned n) -> void
+    {
+        for (unsigned i = 0 ; i < n ; ++i)
+            a[i] &= b[i];
+    }
+
+    GLASGOW_BITSET_ALWAYS_INLINE auto scalar_or_with(BitWord * a, const BitWord * b, unsigned n) -> void
+    {
+        for (unsigned i = 0 ; i < n ; ++i)
+            a[i] |= b[i];
+    }
+
+    GLASGOW_BITSET_ALWAYS_INLINE auto scalar_and_not_with(BitWord * a, const BitWord * b, unsigned n) -> void
+    {
+        for (unsigned i = 0 ; i < n ; ++i)
+            a[i] &= ~b[i];
+    }
+
+    GLASGOW_BITSET_ALWAYS_INLINE auto scalar_any(const BitWord * a, unsigned n) -> bool
+    {
+        for (unsigned i = 0 ; i < n ; ++i)
+            if (0 != a[i])
+                return true;
+        return false;
+    }
+
+    GLASGOW_BITSET_ALWAYS_INLINE auto scalar_count(const BitWord * a, unsigned n) -> unsigned
+    {
+        unsigned result = 0;
+        for (unsigned i = 0 ; i < n ; ++i)
+            result += __builtin_popcountll(a[i]);
+        return result;
+    }
+
+    GLASGOW_BITSET_ALWAYS_INLINE auto scalar_find_first(const BitWord * a, unsigned n) -> unsigned
+    {
+        for (unsigned i = 0 ; i < n ; ++i)
+            if (0 != a[i])
+                return i * bits_per_word + __builtin_ctzll(a[i]);
+        return npos;
+    }
+
+    GLASGOW_BITSET_ALWAYS_INLINE auto scalar_and_any(BitWord * a, const BitWord * b, unsigned n) -> bool
+    {
+        BitWord seen = 0;
+        for (unsigned i = 0 ; i < n ; ++i)
+            seen |= (a[i] &= b[i]);
+        return 0 != seen;
+    }
+
+    GLASGOW_BITSET_ALWAYS_INLINE auto scalar_and_count(const BitWord * a, const BitWord * b, unsigned n) -> unsigned
+    {
+        unsigned result = 0;
+        for (unsigned i = 0 ; i < n ; ++i)
+            result += __builtin_popcountll(a[i] & b[i]);
+        return result;
+    }
+
+    GLASGOW_BITSET_ALWAYS_INLINE auto scalar_and_not_find_first(BitWord * a, const BitWord * b, unsigned n) -> unsigned
+    {
+        unsigned i = 0;
+        for ( ; i < n ; ++i)
+            if (0 != (a[i] &= ~b[i]))
+                break;
+
+        if (i == n)
+            return npos;
+
+        unsigned result = i * bits_per_word + __builtin_ctzll(a[i]);
+        for (++i ; i < n ; ++i)
+            a[i] &= ~b[i];
+        return result;
+    }
+
+    // the fallback, for the baseline instruction set
+    namespace scalar
+    {
+        auto and_with(BitWord * a, const BitWord * b, unsigned n) -> void { scalar_and_with(a, b, n); }
+        auto or_with(BitWord * a, const BitWord * b, unsigned n) -> void { scalar_or_with(a, b, n); }
+        auto and_not_with(BitWord * a, const BitWord * b, unsigned n) -> void { scalar_and_not_with(a, b, n); }
+        auto any(const BitWord * a, unsigned n) -> bool { return scalar_any(a, n); }
+        auto count(const BitWord * a, unsigned n) -> unsigned { return scalar_count(a, n); }
+        auto find_first(const BitWord * a, unsigned n) -> unsigned { return scalar_find_first(a, n); }
+        auto and_any(BitWord * a, const BitWord * b, unsigned n) -> bool { return scalar_and_any(a, b, n); }
+        auto and_count(const BitWord * a, const BitWord * b, unsigned n) -> unsigned { return scalar_and_count(a, b, n); }
+        auto and_not_find_first(BitWord * a, const BitWord * b, unsigned n) -> unsigned { return scalar_and_not_find_first(a, b, n); }
+
+        const BitsetKernels kernels{ "scalar", and_with, or_with, and_not_with, any, count, find_first, and_any, and_count, and_not_find_first };
+    }
+
+#ifdef GLASGOW_BITSET_KERNELS_X86
+    // the same loops, but with hardware popcnt
+    namespace sse42
+    {
+#define GLASGOW_BITSET_TARGET __attribute__((target("sse4.2,popcnt")))
+        GLASGOW_BITSET_TARGET auto and_with(BitWord * a, const BitWord * b, unsigned n) -> void { scalar_and_with(a, b, n); }
+        GLASGOW_BITSET_TARGET auto or_with(BitWord * a, const BitWord * b, unsigned n) -> void { scalar_or_with(a, b, n); }
+        GLASGOW_BITSET_TARGET auto and_not_with(BitWord * a, const BitWord * b, unsigned n) -> void { scalar_and_not_with(a, b, n); }
+        GLASGOW_BITSET_TARGET auto any(const BitWord * a, unsigned n) -> bool { return scalar_any(a, n); }
+        GLASGOW_BITSET_TARGET auto count(const BitWord * a, unsigned n) -> unsigned { return scalar_count(a, n); }
+        GLASGOW_BITSET_TARGET auto find_first(const BitWord * a, unsigned n) -> unsigned { return scalar_find_first(a, n); }
+        GLASGOW_BITSET_TARGET auto and_any(BitWord * a, const BitWord * b, unsigned n) -> bool { return scalar_and_any(a, b, n); }
+        GLASGOW_BITSET_TARGET auto and_count(const BitWord * a, const BitWord * b, unsigned n) -> unsigned { return scalar_and_count(a, b, n); }
+        GLASGOW_BITSET_TARGET auto and_not_find_first(BitWord * a, const BitWord * b, unsigned n) -> unsigned { return scalar_and_not_find_first(a, b, n); }
+#undef GLASGOW_BITSET_TARGET
+
+        const BitsetKernels kernels{ "sse4.2", and_with, or_with, and_not_with, any, count, find_first, and_any, and_count, and_not_find_first };
+    }
+
+    // four words at a time, with popcnt for counting
+    namespace avx2
+    {
+#define GLASGOW_BITSET_TARGET __attribute__((target("avx2,popcnt")))
+        GLASGOW_BITSET_TARGET GLASGOW_BITSET_ALWAYS_INLINE auto load(const BitWord * a) -> __m256i
+        {
+            return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a));
+        }
+
+        GLASGOW_BITSET_TARGET GLASGOW_BITSET_ALWAYS_INLINE auto store(BitWord * a, __m256i x) -> void
+        {
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(a), x);
+        }
+
+        // which of the four words are non-zero, as the low four bits
+        GLASGOW_BITSET_TARGET GLASGOW_BITSET_ALWAYS_INLINE auto non_zero_words(__m256i x) -> unsigned
+        {
+            return 0xf & ~unsigned(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(x, _mm256_setzero_si256()))));
+        }
+
+        GLASGOW_BITSET_TARGET auto and_with(BitWord * a, const BitWord * b, unsigned n) -> void
+        {
+            unsigned i = 0;
+            for ( ; i + 4 <= n ; i += 4)
+                store(a + i, _mm256_and_si256(load(a + i), load(b + i)));
+            scalar_and_with(a + i, b + i, n - i);
+        }
+
+        GLASGOW_BITSET_TARGET auto or_with(BitWord * a, const BitWord * b, unsigned n) -> void
+        {
+            unsigned i = 0;
+            for ( ; i + 4 <= n ; i += 4)
+                store(a + i, _mm256_or_si256(load(a + i), load(b + i)));
+            scalar_or_with(a + i, b + i, n - i);
+        }
+
+        GLASGOW_BITSET_TARGET auto and_not_with(BitWord * a, const BitWord * b, unsigned n) -> void
+        {
+            unsigned i = 0;
+            for ( ; i + 4 <= n ; i += 4)
+                store(a + i, _mm256_andnot_si256(load(b + i), load(a + i)));
+            scalar_and_not_with(a + i, b + i, n - i);
+        }
+
+        GLASGOW_BITSET_TARGET auto any(const BitWord * a, unsigned n) -> bool
+        {
+            unsigned i = 0;
+            for ( ; i + 4 <= n ; i += 4) {
+                auto x = load(a + i);
+                if (! _mm256_testz_si256(x, x))
+                    return true;
+            }
+            return scalar_any(a + i, n - i);
+        }
+
+        GLASGOW_BITSET_TARGET auto count(const BitWord * a, unsigned n) -> unsigned
+        {
+            return scalar_count(a, n);
+        }
+
+        GLASGOW_BITSET_TARGET auto find_first(const BitWord * a, unsigned n) -> unsigned
+        {
+            unsigned i = 0;
+            for ( ; i + 4 <= n ; i += 4) {
+                auto x = load(a + i);
+                if (! _mm256_testz_si256(x, x)) {
+                    unsigned w = i + __builtin_ctz(non_zero_words(x));
+                    return w * bits_per_word + __builtin_ctzll(a[w]);
+                }
+            }
+            auto result = scalar_find_first(a + i, n - i);
+            return npos == result ? npos : i * bits_per_word + result;
+        }
+
+        GLASGOW_BITSET_TARGET auto and_any(BitWord * a, const BitWord * b, unsigned n) -> bool
+        {
+            unsigned i = 0;
+            auto seen = _mm256_setzero_si256();
+            for ( ; i + 4 <= n ; i += 4) {
+                auto x = _mm256_and_si256(load(a + i), load(b + i));
+                store(a + i, x);
+                seen = _mm256_or_si256(seen, x);
+            }
+            bool rest = scalar_and_any(a + i, b + i, n - i);
+            return rest || ! _mm256_testz_si256(seen, seen);
+        }
+
+        GLASGOW_BITSET_TARGET auto and_count(const BitWord * a, const BitWord * b, unsigned n) -> unsigned
+        {
+            return scalar_and_count(a, b, n);
+        }
+
+        GLASGOW_BITSET_TARGET auto and_not_find_first(BitWord * a, const BitWord * b, unsigned n) -> unsigned
+        {
+            unsigned i = 0, result = npos;
+            for ( ; i + 4 <= n ; i += 4) {
+                auto x = _mm256_andnot_si256(load(b + i), load(a + i));
+                store(a + i, x);
+                if (npos == result && ! _mm256_testz_si256(x, x)) {
+                    unsigned w = i + __builtin_ctz(non_zero_words(x));
+                    result = w * bits_per_word + __builtin_ctzll(a[w]);
+                }
+            }
+            auto rest = scalar_and_not_find_first(a + i, b + i, n - i);
+            return (npos != result || npos == rest) ? result : i * bits_per_word + rest;
+        }
+#undef GLASGOW_BITSET_TARGET
+
+        const BitsetKernels kernels{ "avx2", and_with, or_with, and_not_with, any, count, find_first, and_any, and_count, and_not_find_first };
+    }
+
+    // eight words at a time, using masks for the tail, and vector popcount
+    namespace avx512
+    {
+#define GLASGOW_BITSET_TARGET __attribute__((target("avx512f,avx512vpopcntdq,popcnt")))
+        GLASGOW_BITSET_TARGET GLASGOW_BITSET_ALWAYS_INLINE auto tail_mask(unsigned i, unsigned n) -> __mmask8
+        {
+            return (n - i >= 8) ? __mmask8(0xff) : __mmask8((1u << (n - i)) - 1);
+        }
+
+        GLASGOW_BITSET_TARGET GLASGOW_BITSET_ALWAYS_INLINE auto load(const BitWord * a, __mmask8 m) -> __m512i
+        {
+            return _mm512_maskz_loadu_epi64(m, a);
+        }
+
+        GLASGOW_BITSET_TARGET GLASGOW_BITSET_ALWAYS_INLINE auto store(BitWord * a, __mmask8 m, __m512i x) -> void
+        {
+            _mm512_mask_storeu_epi64(a, m, x);
+        }
+
+        GLASGOW_BITSET_TARGET GLASGOW_BITSET_ALWAYS_INLINE auto sum_lanes(__m512i x) -> unsigned
+        {
+            alignas(64) BitWord lanes[8];
+            _mm512_store_si512(lanes, x);
+            BitWord result = 0;
+            for (auto & l : lanes)
+                result += l;
+            return result;
+        }
+
+        GLASGOW_BITSET_TARGET auto and_with(BitWord * a, const BitWord * b, unsigned n) -> void
+        {
+            for (unsigned i = 0 ; i < n ; i += 8) {
+                auto m = tail_mask(i, n);
+                store(a + i, m, _mm512_and_si512(load(a + i, m), load(b + i, m)));
+            }
+        }
+
+        GLASGOW_BITSET_TARGET auto or_with(BitWord * a, const BitWord * b, unsigned n) -> void
+        {
+            for (unsigned i = 0 ; i < n ; i += 8) {
+                auto m = tail_mask(i, n);
+                store(a + i, m, _mm512_or_si512(load(a + i, m), load(b + i, m)));
+            }
+        }
+
+        GLASGOW_BITSET_TARGET auto and_not_with(BitWord * a, const BitWord * b, unsigned n) -> void
+        {
+            for (unsigned i = 0 ; i < n ; i += 8) {
+                auto m = tail_mask(i, n);
+                store(a + i, m, _mm512_maskz_andnot_epi64(m, load(b + i, m), load(a + i, m)));
+            }
+        }
+
+        GLASGOW_BITSET_TARGET auto any(const BitWord * a, unsigned n) -> bool
+        {
+            for (unsigned i = 0 ; i < n ; i += 8) {
+                auto x = load(a + i, tail_mask(i, n));
+                if (_mm512_test_epi64_mask(x, x))
+                    return true;
+            }
+            return false;
+        }
+
+        GLASGOW_BITSET_TARGET auto count(const BitWord * a, unsigned n) -> unsigned
+        {
+            auto total = _mm512_setzero_si512();
+            for (unsigned i = 0 ; i < n ; i += 8)
+                total = _mm512_add_epi64(total, _mm512_popcnt_epi64(load(a + i, tail_mask(i, n))));
+            return sum_lanes(total);
+        }
+
+        GLASGOW_BITSET_TARGET auto find_first(const BitWord * a, unsigned n) -> unsigned
+        {
+            for (unsigned i = 0 ; i < n ; i += 8) {
+                auto x = load(a + i, tail_mask(i, n));
+                if (auto nz = _mm512_test_epi64_mask(x, x)) {
+                    unsigned w = i + __builtin_ctz(nz);
+                    return w * bits_per_word + __builtin_ctzll(a[w]);
+                }
+            }
+            return npos;
+        }
+
+        GLASGOW_BITSET_TARGET auto and_any(BitWord * a, const BitWord * b, unsigned n) -> bool
+        {
+            __mmask8 seen = 0;
+            for (unsigned i = 0 ; i < n ; i += 8) {
+                auto m = tail_mask(i, n);
+                auto x = _mm512_and_si512(load(a + i, m), load(b + i, m));
+                store(a + i, m, x);
+                seen |= _mm512_test_epi64_mask(x, x);
+            }
+            return 0 != seen;
+        }
+
+        GLASGOW_BITSET_TARGET auto and_count(const BitWord * a, const BitWord * b, unsigned n) -> unsigned
+        {
+            auto total = _mm512_setzero_si512();
+            for (unsigned i = 0 ; i < n ; i += 8) {
+                auto m = tail_mask(i, n);
+                total = _mm512_add_epi64(total, _mm512_popcnt_epi64(_mm512_and_si512(load(a + i, m), load(b + i, m))));
+            }
+            return sum_lanes(total);
+        }
+
+        GLASGOW_BITSET_TARGET auto and_not_find_first(BitWord * a, const BitWord * b, unsigned n) -> unsigned
+        {
+            unsigned result = npos;
+            for (unsigned i = 0 ; i < n ; i += 8) {
+                auto m = tail_mask(i, n);
+                auto x = _mm512_maskz_andnot_epi64(m, load(b + i, m), load(a + i, m));
+                store(a + i, m, x);
+                if (npos == result) {
+                    if (auto nz = _mm512_test_epi64_mask(x, x)) {
+                        unsigned w = i + __builtin_ctz(nz);
+                        result = w * bits_per_word + __builtin_ctzll(a[w]);
+                    }
+                }
+            }
+            return result;
+        }
+#undef GLASGOW_BITSET_TARGET
+
+        const BitsetKernels kernels{ "avx512", and_with, or_with, and_not_with, any, count, find_first, and_any, and_count, and_not_find_first };
+    }
+#endif
+
+    auto supported(string_view name) -> bool
+    {
+        if (name == "scalar")
+            return true;
+#ifdef GLASGOW_BITSET_KERNELS_X86
+        __builtin_cpu_init();
+        if (name == "sse4.2")
+            return __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt");
+        if (name == "avx2")
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+        if (name == "avx512")
+            return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq");
+#endif
+        return false;
+    }
+
+    auto kernels_called(string_view name) -> const BitsetKernels *
+    {
+        if (name == "scalar")
+            return &scalar::kernels;
+#ifdef GLASGOW_BITSET_KERNELS_X86
+        if (name == "sse4.2")
+            return &sse42::kernels;
+        if (name == "avx2")
+            return &avx2::kernels;
+        if (name == "avx512")
+            return &avx512::kernels;
+#endif
+        return nullptr;
+    }
+
+    auto best_kernels() -> BitsetKernels
+    {
+        for (auto name : { "avx512", "avx2", "sse4.2" })
+            if (supported(name))
+                return *kernels_called(name);
+        return scalar::kernels;
+    }
+
+#undef GLASGOW_BITSET_ALWAYS_INLINE
+}
+
+BitsetKernels bitset_kernels = best_kernels();
+
+auto select_bitset_kernels(string_view name) -> void
+{
+    if (name == "auto") {
+        bitset_kernels = best_kernels();
+        return;
+    }
+
+    auto k = kernels_called(name);
+    if (! k)
+        throw UnsupportedConfiguration{ "Unknown bitset kernels '" + string(name) + "'" };
+    if (! supported(name))
+        throw UnsupportedConfiguration{ "This CPU does not support the '" + string(name) + "' bitset kernels" };
+    bitset_kernels = *k;
+}
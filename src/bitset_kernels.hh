@@ -0,0 +1,69 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#ifndef GLASGOW_SUBGRAPH_SOLVER_GUARD_SRC_BITSET_KERNELS_HH
+#define GLASGOW_SUBGRAPH_SOLVER_GUARD_SRC_BITSET_KERNELS_HH 1
+
+#include <limits>
+#include <string_view>
+
+/**
+ * Bulk operations on arrays of bitset words, used for long SVOBitsets and
+ * by the colouring kernel. Each has a plain scalar version, and versions
+ * for SSE4.2 (which mostly means hardware popcnt), AVX2 and AVX-512 (with
+ * VPOPCNTDQ). The best set that the CPU supports is picked when the
+ * program starts, and is then called through these pointers.
+ *
+ * The fused operations do two things in one pass over memory.
+ */
+struct BitsetKernels
+{
+    using BitWord = unsigned long long;
+
+    static constexpr const unsigned npos = std::numeric_limits<unsigned>::max();
+
+    /// Which instruction set these use
+    const char * name;
+
+    /// a &= b
+    auto (* and_with)(BitWord * a, const BitWord * b, unsigned n) -> void;
+
+    /// a |= b
+    auto (* or_with)(BitWord * a, const BitWord * b, unsigned n) -> void;
+
+    /// a &= ~b
+    auto (* and_not_with)(BitWord * a, const BitWord * b, unsigned n) -> void;
+
+    /// Is any bit of a set?
+    auto (* any)(const BitWord * a, unsigned n) -> bool;
+
+    /// How many bits of a are set?
+    auto (* count)(const BitWord * a, unsigned n) -> unsigned;
+
+    /// The first set bit of a, or npos
+    auto (* find_first)(const BitWord * a, unsigned n) -> unsigned;
+
+    /// a &= b, and then is any bit of a still set?
+    auto (* and_any)(BitWord * a, const BitWord * b, unsigned n) -> bool;
+
+    /// How many bits of a & b are set?
+    auto (* and_count)(const BitWord * a, const BitWord * b, unsigned n) -> unsigned;
+
+    /// a &= ~b, and then the first set bit of a, or npos
+    auto (* and_not_find_first)(BitWord * a, const BitWord * b, unsigned n) -> unsigned;
+};
+
+/**
+ * The kernels currently in use.
+ */
+extern BitsetKernels bitset_kernels;
+
+/**
+ * Use a particular set of kernels: "scalar", "sse4.2", "avx2", "avx512", or
+ * "auto" for the best that this CPU supports.
+ *
+ * \throw UnsupportedConfiguration if the name is unknown, or if this CPU
+ * does not support them.
+ */
+auto select_bitset_kernels(std::string_view name) -> void;
+
+#endif
@@ -3,32 +3,62 @@
 #include "clique.hh"
 #include "watches.hh"
 #include "svo_bitset.hh"
+#include "fixed_bitset.hh"
+#include "bitset_colouring.hh"
+#include "clique_heuristic.hh"
+#include "clique_reduction.hh"
 #include "proof.hh"
 #include "configuration.hh"
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <list>
+#include <memory>
+#include <mutex>
 #include <numeric>
+#include <optional>
 #include <random>
+#include <thread>
 #include <tuple>
 #include <type_traits>
 #include <utility>
 #include <vector>
 
+using std::atomic;
+using std::chrono::duration_cast;
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+using std::condition_variable;
 using std::conditional_t;
+using std::deque;
 using std::find;
+using std::find_if;
+using std::get;
 using std::iota;
 using std::is_same;
 using std::list;
 using std::make_tuple;
+using std::make_unique;
+using std::max;
+using std::min;
 using std::mt19937;
 using std::move;
+using std::mutex;
+using std::nullopt;
+using std::optional;
 using std::pair;
 using std::reverse;
 using std::sort;
 using std::string_view;
 using std::swap;
+using std::thread;
 using std::to_string;
+using std::tuple;
+using std::unique_lock;
+using std::unique_ptr;
 using std::vector;
 
 namespace
@@ -41,22 +71,128 @@ namespace
         DecidedTrue
     };
 
+    // shared between threads, when searching in parallel, so that a clique
+    // found by any thread tightens the bound in all of them
     struct Incumbent
     {
-        unsigned value = 0;
+        atomic<unsigned> value{ 0 };
+        mutex c_mutex;
         vector<int> c;
 
         auto update(const vector<int> & new_c, unsigned long long & find_nodes, unsigned long long & prove_nodes) -> void
         {
             if (new_c.size() > value) {
-                find_nodes += prove_nodes;
-                prove_nodes = 0;
-                value = new_c.size();
-                c = new_c;
+                unique_lock<mutex> guard(c_mutex);
+                if (new_c.size() > value) {
+                    find_nodes += prove_nodes;
+                    prove_nodes = 0;
+                    c = new_c;
+                    value = new_c.size();
+                }
             }
         }
     };
 
+    // a subtree near the top of the search, to be explored by any thread
+    template <typename Bitset_>
+    struct SearchTask
+    {
+        vector<int> c;
+        Bitset_ p;
+
+        // the colour bound which let us create this task
+        unsigned bound;
+    };
+
+    /**
+     * One deque of tasks per thread. Each thread takes tasks from the back
+     * of its own deque, which gives the usual search order, and when it runs
+     * out, it steals from the front of the others, which is where the
+     * shallowest (and so probably the biggest) tasks are.
+     */
+    template <typename Task_>
+    class WorkStealingQueues
+    {
+        private:
+            struct Queue
+            {
+                mutex m;
+                deque<Task_> tasks;
+            };
+
+            vector<Queue> _queues;
+
+            mutex _idle_mutex;
+            condition_variable _idle_cv;
+            long _queued = 0, _outstanding = 0;
+
+        public:
+            explicit WorkStealingQueues(unsigned n) :
+                _queues(n)
+            {
+            }
+
+            /// Tasks are given in search order, and will be taken in that order by this thread
+            auto push(unsigned t, vector<Task_> && tasks) -> void
+            {
+                if (tasks.empty())
+                    return;
+
+                {
+                    unique_lock<mutex> guard(_queues[t].m);
+                    for (auto i = tasks.rbegin() ; i != tasks.rend() ; ++i)
+                        _queues[t].tasks.push_back(move(*i));
+                }
+
+                unique_lock<mutex> guard(_idle_mutex);
+                _queued += tasks.size();
+                _outstanding += tasks.size();
+                _idle_cv.notify_all();
+            }
+
+            auto take(unsigned t) -> optional<Task_>
+            {
+                optional<Task_> result;
+                for (unsigned i = 0 ; i < _queues.size() && ! result ; ++i) {
+                    auto & q = _queues[(t + i) % _queues.size()];
+                    unique_lock<mutex> guard(q.m);
+                    if (! q.tasks.empty()) {
+                        if (0 == i) {
+                            result = move(q.tasks.back());
+                            q.tasks.pop_back();
+                        }
+                        else {
+                            result = move(q.tasks.front());
+                            q.tasks.pop_front();
+                        }
+                    }
+                }
+
+                if (result) {
+                    unique_lock<mutex> guard(_idle_mutex);
+                    --_queued;
+                }
+
+                return result;
+            }
+
+            /// Call once for each task taken, after pushing anything it created
+            auto finished() -> void
+            {
+                unique_lock<mutex> guard(_idle_mutex);
+                if (0 == --_outstanding)
+                    _idle_cv.notify_all();
+            }
+
+            /// Wait until there might be something to take, returning false if everything is done
+            auto wait_for_work() -> bool
+            {
+                unique_lock<mutex> guard(_idle_mutex);
+                _idle_cv.wait(guard, [&] { return _queued > 0 || 0 == _outstanding; });
+                return 0 != _outstanding;
+            }
+    };
+
     template <typename EntryType_>
     struct FlatWatchTable
     {
@@ -68,51 +204,123 @@ namespace
         }
     };
 
+    // Bitset_ is a FixedBitset big enough for the graph, or SVOBitset
+    template <typename Bitset_>
     struct CliqueRunner
     {
+        using Task = SearchTask<Bitset_>;
+
+        // how many levels of the search tree are shared out between threads
+        static constexpr unsigned parallel_split_depth = 2;
+
         const CliqueParams & params;
-        Incumbent incumbent;
+        Incumbent & incumbent;
+
+        // if we're working on a reduced graph, what's left of it
+        const ReducedGraph * reduced;
 
-        int size;
-        vector<SVOBitset> adj, connected_table;
+        int size, graph_size;
+        vector<Bitset_> adj;
+        vector<SVOBitset> connected_table;
         vector<int> order, invorder;
 
         Watches<int, FlatWatchTable> watches;
 
+        BitsetColouring<Bitset_> colouring;
+        using WordRange = typename BitsetColouring<Bitset_>::WordRange;
+
+        // the words that p occupied when it was coloured, at each depth
+        vector<WordRange> word_ranges;
+
+        // a new_p (and for the connected reduction, a new_a) for each depth,
+        // allocated the first time the search gets that deep and reused after
+        // that, so that the search only allocates as it reaches new depths.
+        // these have room reserved for the deepest possible search, so slots
+        // never move once they're handed out
+        vector<Bitset_> p_arena;
+        vector<SVOBitset> a_arena;
+        unsigned long long search_allocations = 0;
+
+        // scratch space for colour_class_order_sorted
+        vector<int> sorted_prelim, sorted_sizes, sorted_start, sorted_order;
+
+        // for tighten_bound: the classes it can use, as bitsets, how many
+        // neighbours the current vertex has in each, which classes a
+        // conflict has frozen, scratch space, and what it managed
+        vector<Bitset_> tighten_classes;
+        Bitset_ tighten_scratch;
+        vector<unsigned> tighten_counts;
+        vector<char> tighten_frozen;
+        unsigned long long tightened_by_recolouring = 0, tightened_by_conflicts = 0;
+
+        // what tighten_bound did at each depth, which is needed to log a
+        // proof of the bound if we prune at that depth later on
+        struct TightenedBound
+        {
+            int end = 0;
+            vector<tuple<int, int, int> > conflicts;
+        };
+        vector<TightenedBound> tightened;
+
         mt19937 global_rand;
 
         int * space;
 
-        CliqueRunner(const InputGraph & g, const CliqueParams & p) :
+        CliqueRunner(const InputGraph & g, const ReducedGraph * r, const CliqueParams & p, Incumbent & i) :
             params(p),
-            size(g.size()),
-            adj(g.size(), SVOBitset{ unsigned(size), 0 }),
+            incumbent(i),
+            reduced(r),
+            size(r ? int(r->vertices.size()) : g.size()),
+            graph_size(g.size()),
             order(size),
-            invorder(size),
+            invorder(graph_size, -1),
+            colouring(adj, size),
+            sorted_prelim(size),
+            sorted_sizes(size),
+            sorted_start(size),
+            sorted_order(size),
+            tighten_scratch(unsigned(size), 0),
             space(nullptr)
         {
             space = new int[size * (size + 1) * 2];
+            reserve_arenas();
 
-            if (params.restarts_schedule->might_restart())
-                watches.table.data.resize(g.size());
+            // build these in place, rather than copying an empty one
+            adj.reserve(size);
+            for (int v = 0 ; v < size ; ++v)
+                adj.emplace_back(unsigned(size), 0);
 
-            // populate our order with every vertex initially
-            iota(order.begin(), order.end(), 0);
-
-            // pre-calculate degrees
-            vector<int> degrees;
-            degrees.resize(size);
-            g.for_each_edge([&] (int f, int, string_view) { ++degrees[f]; });
-
-            // sort on degree
-            if (! params.input_order)
-                sort(order.begin(), order.end(),
-                        [&] (int a, int b) { return (degrees[a] > degrees[b] || (degrees[a] == degrees[b] && a < b)); });
+            if (params.restarts_schedule->might_restart())
+                watches.table.data.resize(size);
+
+            // sort on degree, unless we're told not to. the reduction has
+            // already done this for what's left.
+            if (reduced)
+                order = reduced->vertices;
+            else if (params.input_order)
+                iota(order.begin(), order.end(), 0);
+            else
+                order = g.degree_order();
 
             for (unsigned i = 0 ; i < order.size() ; ++i)
                 invorder[order[i]] = i;
 
-            g.for_each_edge([&] (int f, int t, string_view) { adj[invorder[f]].set(invorder[t]); });
+            // if the graph came from a cache, it may already have the
+            // adjacency matrix in this order
+            auto matrix = params.input_order ? nullptr : g.degree_ordered_matrix();
+            if (matrix && reduced && order != g.degree_order())
+                matrix = nullptr;
+
+            if (matrix) {
+                unsigned words = (size + 63) / 64;
+                for (int v = 0 ; v < size ; ++v)
+                    adj[v].assign_words(matrix + size_t(v) * words, words);
+            }
+            else
+                g.for_each_edge([&] (int f, int t, string_view) {
+                        if (-1 != invorder[f] && -1 != invorder[t])
+                            adj[invorder[f]].set(invorder[t]);
+                        });
 
             if (params.connected) {
                 connected_table.resize(size);
@@ -121,155 +329,126 @@ namespace
             }
         }
 
+        // a runner for another thread, sharing the graph and the incumbent
+        CliqueRunner(const CliqueRunner & other) :
+            params(other.params),
+            incumbent(other.incumbent),
+            reduced(other.reduced),
+            size(other.size),
+            graph_size(other.graph_size),
+            adj(other.adj),
+            connected_table(other.connected_table),
+            order(other.order),
+            invorder(other.invorder),
+            colouring(adj, size),
+            sorted_prelim(size),
+            sorted_sizes(size),
+            sorted_start(size),
+            sorted_order(size),
+            tighten_scratch(unsigned(size), 0),
+            space(new int[size * (size + 1) * 2])
+        {
+            reserve_arenas();
+        }
+
         ~CliqueRunner()
         {
             delete[] space;
         }
 
+        auto reserve_arenas() -> void
+        {
+            p_arena.reserve(size + 2);
+            word_ranges.resize(size + 2);
+            if (params.connected)
+                a_arena.reserve(size + 2);
+        }
+
+        template <typename B_>
+        auto arena_slot(vector<B_> & arena, int depth) -> B_ &
+        {
+            while (arena.size() <= unsigned(depth)) {
+                arena.emplace_back(unsigned(size), 0);
+                ++search_allocations;
+            }
+            return arena[depth];
+        }
+
         auto colour_class_order(
-                const SVOBitset & p,
+                const Bitset_ & p,
+                WordRange & range,
                 int * p_order,
                 int * p_bounds,
                 int & p_end) -> void
         {
-            SVOBitset p_left = p;      // not coloured yet
+            const auto * p_words = p.words();
             unsigned colour = 0;         // current colour
             p_end = 0;
 
-            // while we've things left to colour
-            while (p_left.any()) {
-                // next colour
-                ++colour;
-                // things that can still be given this colour
-                SVOBitset q = p_left;
-
-                // while we can still give something this colour
-                while (q.any()) {
-                    // first thing we can colour
-                    int v = q.find_first();
-                    p_left.reset(v);
-                    q.reset(v);
-
-                    // can't give anything adjacent to this the same colour
-                    q.intersect_with_complement(adj[v]);
-
-                    // record in result
-                    p_bounds[p_end] = colour;
-                    p_order[p_end] = v;
-                    ++p_end;
-                }
-            }
+            colouring.colour(range,
+                    [&] (unsigned i) { return p_words[i]; },
+                    [&] (int v) {
+                        p_bounds[p_end] = colour + 1;
+                        p_order[p_end] = v;
+                        ++p_end;
+                    },
+                    [&] (unsigned) { ++colour; });
         }
 
         auto connected_colour_class_order(
-                const SVOBitset & p,
+                const Bitset_ & p,
+                WordRange & range,
                 const SVOBitset & a,
                 int * p_order,
                 int * p_bounds,
                 int & p_end) -> void
         {
+            const auto * p_words = p.words();
+            const auto * a_words = a.words();
             unsigned colour = 0;         // current colour
             p_end = 0;
 
-            SVOBitset p_left = p; // not coloured yet
-            p_left.intersect_with_complement(a);
-
-            // while we've things left to colour
-            while (p_left.any()) {
-                // next colour
-                ++colour;
-                // things that can still be given this colour
-                SVOBitset q = p_left;
-
-                // while we can still give something this colour
-                while (q.any()) {
-                    // first thing we can colour
-                    int v = q.find_first();
-                    p_left.reset(v);
-                    q.reset(v);
-
-                    // can't give anything adjacent to this the same colour
-                    q.intersect_with_complement(adj[v]);
-
-                    // record in result
-                    p_bounds[p_end] = colour;
-                    p_order[p_end] = v;
-                    ++p_end;
-                }
-            }
-
-            p_left = p;
-            p_left &= a;
-
-            // while we've things left to colour
-            while (p_left.any()) {
-                // next colour
-                ++colour;
-                // things that can still be given this colour
-                SVOBitset q = p_left;
-
-                // while we can still give something this colour
-                while (q.any()) {
-                    // first thing we can colour
-                    int v = q.find_first();
-                    p_left.reset(v);
-                    q.reset(v);
-
-                    // can't give anything adjacent to this the same colour
-                    q.intersect_with_complement(adj[v]);
-
-                    // record in result
-                    p_bounds[p_end] = colour;
-                    p_order[p_end] = v;
-                    ++p_end;
-                }
-            }
+            auto record = [&] (int v) {
+                p_bounds[p_end] = colour + 1;
+                p_order[p_end] = v;
+                ++p_end;
+            };
+
+            // colour things that aren't connected first, so they come last
+            auto not_connected = range, connected = range;
+            colouring.colour(not_connected, [&] (unsigned i) { return p_words[i] & ~a_words[i]; }, record, [&] (unsigned) { ++colour; });
+            colouring.colour(connected, [&] (unsigned i) { return p_words[i] & a_words[i]; }, record, [&] (unsigned) { ++colour; });
+            range = not_connected.lo == not_connected.hi ? connected : connected.lo == connected.hi ? not_connected :
+                WordRange{ min(not_connected.lo, connected.lo), max(not_connected.hi, connected.hi) };
         }
 
         auto colour_class_order_2df(
-                const SVOBitset & p,
+                const Bitset_ & p,
+                WordRange & range,
                 int * p_order,
                 int * p_bounds,
                 int * defer,
                 int & p_end) -> void
         {
-            SVOBitset p_left = p;      // not coloured yet
+            const auto * p_words = p.words();
             unsigned colour = 0;         // current colour
             p_end = 0;
 
             unsigned d = 0;             // number deferred
 
-            // while we've things left to colour
-            while (p_left.any()) {
-                // next colour
-                ++colour;
-                // things that can still be given this colour
-                SVOBitset q = p_left;
-
-                // while we can still give something this colour
-                unsigned number_with_this_colour = 0;
-                while (q.any()) {
-                    // first thing we can colour
-                    int v = q.find_first();
-                    p_left.reset(v);
-                    q.reset(v);
-
-                    // can't give anything adjacent to this the same colour
-                    q.intersect_with_complement(adj[v]);
-
-                    // record in result
-                    p_bounds[p_end] = colour;
-                    p_order[p_end] = v;
-                    ++p_end;
-                    ++number_with_this_colour;
-                }
-
-                if (1 == number_with_this_colour) {
-                    --p_end;
-                    --colour;
-                    defer[d++] = p_order[p_end];
-                }
-            }
+            colouring.colour(range,
+                    [&] (unsigned i) { return p_words[i]; },
+                    [&] (int v) {
+                        p_bounds[p_end] = colour + 1;
+                        p_order[p_end] = v;
+                        ++p_end;
+                    },
+                    [&] (unsigned number_with_this_colour) {
+                        if (1 == number_with_this_colour)
+                            defer[d++] = p_order[--p_end];
+                        else
+                            ++colour;
+                    });
 
             // handle deferred singletons
             for (unsigned n = 0 ; n < d ; ++n) {
@@ -281,46 +460,31 @@ namespace
         }
 
         auto colour_class_order_sorted(
-                const SVOBitset & p,
+                const Bitset_ & p,
+                WordRange & range,
                 int * p_order,
                 int * p_bounds,
                 int & p_end) -> void
         {
-            SVOBitset p_left = p;      // not coloured yet
+            const auto * p_words = p.words();
             unsigned colour = 0;         // current colour
             p_end = 0;
 
-            std::vector<int> p_order_prelim(size);
-            std::vector<int> colour_sizes(size);
-            std::vector<int> colour_start(size);
-            std::vector<int> sorted_order(size);
-
-            // while we've things left to colour
-            while (p_left.any()) {
-                colour_start[colour] = p_end;
-                colour_sizes[colour] = 0;
-
-                // next colour
-                ++colour;
-                // things that can still be given this colour
-                SVOBitset q = p_left;
-
-                // while we can still give something this colour
-                while (q.any()) {
-                    // first thing we can colour
-                    int v = q.find_first();
-                    p_left.reset(v);
-                    q.reset(v);
-
-                    // can't give anything adjacent to this the same colour
-                    q.intersect_with_complement(adj[v]);
-
-                    // record in result
-                    p_order_prelim[p_end] = v;
-                    ++p_end;
-                    ++colour_sizes[colour - 1];
-                }
-            }
+            auto & p_order_prelim = sorted_prelim;
+            auto & colour_sizes = sorted_sizes;
+            auto & colour_start = sorted_start;
+
+            colouring.colour(range,
+                    [&] (unsigned i) { return p_words[i]; },
+                    [&] (int v) {
+                        p_order_prelim[p_end] = v;
+                        ++p_end;
+                    },
+                    [&] (unsigned n) {
+                        colour_start[colour] = p_end - n;
+                        colour_sizes[colour] = n;
+                        ++colour;
+                    });
 
             // sort
             iota(sorted_order.begin(), sorted_order.begin() + colour, 0);
@@ -339,9 +503,206 @@ namespace
             }
         }
 
+        auto colour_class_order_from_params(
+                const Bitset_ & p,
+                WordRange & range,
+                int * p_order,
+                int * p_bounds,
+                int * defer,
+                int & p_end) -> void
+        {
+            switch (params.colour_class_order) {
+                case ColourClassOrder::ColourOrder:     colour_class_order(p, range, p_order, p_bounds, p_end); break;
+                case ColourClassOrder::SingletonsFirst: colour_class_order_2df(p, range, p_order, p_bounds, defer, p_end); break;
+                case ColourClassOrder::Sorted:          colour_class_order_sorted(p, range, p_order, p_bounds, p_end); break;
+            }
+        }
+
+        // after colouring, try to show that more of the vertices that the
+        // colour bound can't prune still can't take c beyond the incumbent,
+        // working through them in order. if c plus k vertices is as big as
+        // the incumbent, each vertex must either fit into one of the first
+        // k colour classes, perhaps after moving its only neighbour in a
+        // class into a later class, or it must be in an infra-chromatic
+        // conflict with two of those classes. classes in a conflict are
+        // frozen, because the proof of the conflict depends upon exactly
+        // what is in them. the vertices that manage this get bounds of at
+        // most k, so they are pruned along with the first k classes.
+        auto tighten_bound(
+                int depth,
+                unsigned c_size,
+                int * p_order,
+                int * p_bounds,
+                int p_end) -> void
+        {
+            if (params.proof) {
+                while (tightened.size() <= unsigned(depth))
+                    tightened.emplace_back();
+                tightened[depth].end = 0;
+                tightened[depth].conflicts.clear();
+            }
+
+            if (incumbent.value <= c_size)
+                return;
+
+            int k = incumbent.value - c_size;
+            int start = 0;
+            while (start < p_end && p_bounds[start] <= k)
+                ++start;
+            if (start == 0 || start == p_end)
+                return;
+
+            while (tighten_classes.size() < unsigned(k)) {
+                tighten_classes.emplace_back(unsigned(size), 0);
+                ++search_allocations;
+            }
+            for (int i = 0 ; i < k ; ++i)
+                tighten_classes[i].reset();
+            for (int x = 0 ; x < start ; ++x)
+                tighten_classes[p_bounds[x] - 1].set(p_order[x]);
+            tighten_frozen.assign(k, 0);
+            tighten_counts.resize(k);
+
+            int end = start;
+            for ( ; end < p_end ; ++end) {
+                int v = p_order[end];
+
+                // count v's neighbours in each class. if there are none in
+                // some class, v can go straight into it.
+                int fits = -1;
+                for (int i = 0 ; i < k ; ++i)
+                    if (! tighten_frozen[i]) {
+                        tighten_counts[i] = tighten_classes[i].count_intersection(adj[v]);
+                        if (0 == tighten_counts[i]) {
+                            fits = i;
+                            break;
+                        }
+                    }
+
+                // otherwise, look for a class where v has only one neighbour
+                // w. if w can go into a later class, v can take its place.
+                // if not, but there is a later class with no common
+                // neighbours of v and w, then v can't form a triangle with
+                // the two classes, which is an infra-chromatic conflict.
+                // (looking at earlier classes too, or for triangles between
+                // any two classes, prunes a little more, but costs far more
+                // than it saves.)
+                int moved = -1, moved_to = -1, first = -1, second = -1;
+                for (int i = 0 ; i < k && -1 == fits ; ++i) {
+                    if (tighten_frozen[i] || 1 != tighten_counts[i])
+                        continue;
+
+                    tighten_scratch = tighten_classes[i];
+                    tighten_scratch &= adj[v];
+                    int w = tighten_scratch.find_first();
+                    tighten_scratch = adj[v];
+                    tighten_scratch &= adj[w];
+
+                    for (int j = i + 1 ; j < k ; ++j) {
+                        if (tighten_frozen[j])
+                            continue;
+
+                        if (0 == tighten_classes[j].count_intersection(adj[w])) {
+                            fits = i;
+                            moved = w;
+                            moved_to = j;
+                            break;
+                        }
+                        else if (-1 == first && 0 == tighten_classes[j].count_intersection(tighten_scratch)) {
+                            first = i;
+                            second = j;
+                        }
+                    }
+                }
+
+                if (-1 != fits) {
+                    if (-1 != moved) {
+                        tighten_classes[fits].reset(moved);
+                        tighten_classes[moved_to].set(moved);
+                        p_bounds[find(p_order, p_order + end, moved) - p_order] = moved_to + 1;
+                    }
+                    tighten_classes[fits].set(v);
+                    p_bounds[end] = fits + 1;
+                    ++tightened_by_recolouring;
+                    continue;
+                }
+
+                if (-1 == first)
+                    break;
+
+                tighten_frozen[first] = 1;
+                tighten_frozen[second] = 1;
+                p_bounds[end] = k;
+                ++tightened_by_conflicts;
+                if (params.proof)
+                    tightened[depth].conflicts.emplace_back(v, first, second);
+            }
+
+            if (params.proof)
+                tightened[depth].end = end;
+        }
+
+        // log the colour bound for the first n + 1 vertices in p_order
+        auto colour_bound_proof(
+                int depth,
+                int n,
+                const int * p_order,
+                const int * p_bounds) -> void
+        {
+            vector<vector<int> > colour_classes;
+            vector<InfraChromaticConflict> conflicts;
+
+            // if tighten_bound did anything here, its classes come first,
+            // possibly with conflicts, and are no longer in order
+            int start = 0;
+            if (params.tighten_bounds && unsigned(depth) < tightened.size() && 0 != tightened[depth].end) {
+                auto & t = tightened[depth];
+                start = t.end;
+
+                auto in_conflict = [&] (int v) {
+                    return t.conflicts.end() != find_if(t.conflicts.begin(), t.conflicts.end(), [&] (const auto & c) { return get<0>(c) == v; });
+                };
+
+                for (int x = 0 ; x < start ; ++x)
+                    if (! in_conflict(p_order[x])) {
+                        if (colour_classes.size() < unsigned(p_bounds[x]))
+                            colour_classes.resize(p_bounds[x]);
+                        colour_classes[p_bounds[x] - 1].push_back(p_order[x]);
+                    }
+
+                for (auto & [ v, first, second ] : t.conflicts) {
+                    auto & conflict = conflicts.emplace_back(InfraChromaticConflict{ order[v], unsigned(first), unsigned(second), { }, { } });
+                    for (auto & w : colour_classes[first])
+                        if (adj[v].test(w))
+                            conflict.first_neighbours.push_back(order[w]);
+                    for (auto & w : colour_classes[second])
+                        if (adj[v].test(w))
+                            conflict.second_neighbours.push_back(order[w]);
+                }
+
+                for (auto & cc : colour_classes)
+                    for (auto & w : cc)
+                        w = order[w];
+            }
+
+            for (int v = start ; v <= n ; ++v) {
+                if (start == v || p_bounds[v - 1] != p_bounds[v])
+                    colour_classes.emplace_back();
+                colour_classes.back().push_back(order[p_order[v]]);
+            }
+
+            if (conflicts.empty())
+                params.proof->colour_bound(colour_classes);
+            else
+                params.proof->colour_bound(colour_classes, conflicts);
+        }
+
         auto post_nogood(
                 const vector<int> & c)
         {
+            if (c.size() > params.nogood_size_limit)
+                return;
+
             Nogood<int> nogood;
             nogood.literals.assign(c.begin(), c.end());
             watches.post_nogood(move(nogood));
@@ -362,12 +723,28 @@ namespace
             vector<pair<int, bool> > result;
             for (auto & w : v)
                 result.emplace_back(order[w], true);
-            for (int w = 0 ; w < size ; ++w)
+            for (int w = 0 ; w < graph_size ; ++w)
                 if (result.end() == find_if(result.begin(), result.end(), [&] (auto & x) { return x.first == w; }))
                     result.emplace_back(w, false);
             return result;
         }
 
+        template <bool connected_>
+        auto child_a(
+                int depth,
+                conditional_t<connected_, const SVOBitset &, int> a,
+                int v) -> conditional_t<connected_, const SVOBitset &, int>
+        {
+            if constexpr (connected_) {
+                auto & new_a = arena_slot(a_arena, depth);
+                new_a = a;
+                new_a |= connected_table[v];
+                return new_a;
+            }
+            else
+                return a;
+        }
+
         template <bool connected_>
         auto expand(
                 int depth,
@@ -375,7 +752,7 @@ namespace
                 unsigned long long & find_nodes,
                 unsigned long long & prove_nodes,
                 vector<int> & c,
-                SVOBitset & p,
+                Bitset_ & p,
                 conditional_t<connected_, const SVOBitset &, int> a,
                 int spacepos) -> SearchResult
         {
@@ -388,18 +765,21 @@ namespace
 
             int p_end = 0;
 
+            // p is a subset of the parent's p, so it only occupies words that
+            // the parent's did
+            auto & range = word_ranges[depth];
+            range = 0 == spacepos ? colouring.all_words() : word_ranges[depth - 1];
+
             if constexpr (connected_) {
                 if (! c.empty())
-                    connected_colour_class_order(p, a, p_order, p_bounds, p_end);
+                    connected_colour_class_order(p, range, a, p_order, p_bounds, p_end);
                 else
-                    colour_class_order(p, p_order, p_bounds, p_end);
+                    colour_class_order(p, range, p_order, p_bounds, p_end);
             }
             else {
-                switch (params.colour_class_order) {
-                    case ColourClassOrder::ColourOrder:     colour_class_order(p, p_order, p_bounds, p_end); break;
-                    case ColourClassOrder::SingletonsFirst: colour_class_order_2df(p, p_order, p_bounds, &space[spacepos + 2 * size], p_end); break;
-                    case ColourClassOrder::Sorted:          colour_class_order_sorted(p, p_order, p_bounds, p_end); break;
-                }
+                colour_class_order_from_params(p, range, p_order, p_bounds, &space[spacepos + 2 * size], p_end);
+                if (params.tighten_bounds && ! params.proof_is_for_hom)
+                    tighten_bound(depth, c.size(), p_order, p_bounds, p_end);
             }
 
             // for each v in p... (v comes later)
@@ -409,15 +789,8 @@ namespace
                     return SearchResult::Aborted;
 
                 if (c.size() + p_bounds[n] <= incumbent.value) {
-                    if (params.proof) {
-                        vector<vector<int> > colour_classes;
-                        for (int v = 0 ; v <= n ; ++v) {
-                            if (0 == v || p_bounds[v - 1] != p_bounds[v])
-                                colour_classes.emplace_back();
-                            colour_classes.back().push_back(order[p_order[v]]);
-                        }
-                        params.proof->colour_bound(colour_classes);
-                    }
+                    if (params.proof)
+                        colour_bound_proof(depth, n, p_order, p_bounds);
                     break;
                 }
 
@@ -425,7 +798,7 @@ namespace
                 // valid shortcut in the connected case.
                 if constexpr (! connected_) {
                     if (p_bounds[n] == n + 1) {
-                        auto c_save = c;
+                        auto c_size = c.size();
                         for ( ; n >= 0 ; --n)
                             c.push_back(p_order[n]);
                         incumbent.update(c, find_nodes, prove_nodes);
@@ -444,7 +817,7 @@ namespace
                             return SearchResult::DecidedTrue;
                         }
 
-                        c = move(c_save);
+                        c.resize(c_size);
 
                         break;
                     }
@@ -490,26 +863,23 @@ namespace
                 }
 
                 // filter p to contain vertices adjacent to v
-                SVOBitset new_p = p;
-                new_p &= adj[v];
+                Bitset_ & new_p = arena_slot(p_arena, depth);
+                new_p = p;
+                bool new_p_any = new_p.intersect_with_and_any(adj[v]);
 
-                if (params.restarts_schedule->might_restart())
+                if (params.restarts_schedule->might_restart()) {
                     watches.propagate(v,
                             [&] (int literal) { return c.end() == find(c.begin(), c.end(), literal); },
                             [&] (int literal) { new_p.reset(literal); }
                             );
+                    new_p_any = new_p.any();
+                }
 
                 if (params.proof)
                     params.proof->start_level(depth + 1);
 
-                if (new_p.any()) {
-                    auto new_a = a;
-
-                    if constexpr (connected_) {
-                        new_a |= connected_table[v];
-                    }
-
-                    switch (expand<connected_>(depth + 1, nodes, find_nodes, prove_nodes, c, new_p, new_a, spacepos + 2 * size)) {
+                if (new_p_any) {
+                    switch (expand<connected_>(depth + 1, nodes, find_nodes, prove_nodes, c, new_p, child_a<connected_>(depth, a, v), spacepos + 2 * size)) {
                         case SearchResult::Aborted:
                             return SearchResult::Aborted;
 
@@ -554,6 +924,69 @@ namespace
                 return SearchResult::Complete;
         }
 
+        // look for a good clique before we start searching, and make it the
+        // incumbent if it's any good. returns true if that's enough for a
+        // decision problem, or for stop_after_finding.
+        auto warm_start(CliqueResult & result) -> bool
+        {
+            if ((! params.warm_start) || params.connected || params.proof_is_for_hom)
+                return false;
+
+            auto start_time = steady_clock::now();
+            auto deadline = start_time + params.warm_start_time_limit;
+
+            unsigned target = size;
+            if (params.decide)
+                target = min(target, *params.decide);
+            if (params.stop_after_finding)
+                target = min(target, *params.stop_after_finding);
+
+            unsigned n_threads = max(1u, params.warm_start_threads ? params.warm_start_threads : thread::hardware_concurrency());
+            auto c = find_heuristic_clique(adj, size, n_threads, params.warm_start_moves, target,
+                    [&] { return steady_clock::now() >= deadline || params.timeout->should_abort(); });
+
+            result.extra_stats.emplace_back("warm_start_clique = " + to_string(c.size()));
+            result.extra_stats.emplace_back("warm_start_time = " + to_string(duration_cast<milliseconds>(steady_clock::now() - start_time).count()));
+
+            if (c.size() <= incumbent.value)
+                return false;
+
+            incumbent.update(c, result.find_nodes, result.prove_nodes);
+
+            if (params.proof && ! params.decide) {
+                params.proof->start_level(0);
+                params.proof->new_incumbent(unpermute_and_finish(c));
+            }
+
+            if (decided()) {
+                if (params.proof)
+                    params.proof->post_solution(unpermute(c));
+                return true;
+            }
+
+            return false;
+        }
+
+        // the reduction deleted everything whose core number was below its
+        // lower bound, but if the warm start has improved on that, we can
+        // delete some more. this goes in the reduction's degeneracy order,
+        // so that each deletion is justified in the same way.
+        auto remove_low_core_vertices(Bitset_ & p) -> void
+        {
+            if ((! reduced) || incumbent.value <= reduced->lower_bound)
+                return;
+
+            for (unsigned i = 0 ; i < reduced->peel_order.size() ; ++i)
+                if (unsigned(reduced->core_numbers[i]) < incumbent.value) {
+                    int v = reduced->peel_order[i];
+                    p.reset(invorder[v]);
+                    if (params.proof) {
+                        params.proof->start_level(0);
+                        params.proof->backtrack_from_binary_variables(vector<int>{ v });
+                    }
+                }
+        }
+
         template <bool connected_>
         auto run() -> CliqueResult
         {
@@ -562,13 +995,17 @@ namespace
             if (params.decide)
                 incumbent.value = *params.decide - 1;
 
-            // do the search
-            bool done = false;
+            // do the search, unless a heuristic solution is good enough
+            bool done = warm_start(result);
             unsigned number_of_restarts = 0;
 
-            SVOBitset p{ unsigned(size), 0 };
+            // nogoods from here on were posted during the latest restart
+            unsigned latest_nogoods = 0;
+
+            Bitset_ p{ unsigned(size), 0 };
             for (int i = 0 ; i < size ; ++i)
                 p.set(i);
+            remove_low_core_vertices(p);
 
             while (! done) {
                 ++number_of_restarts;
@@ -583,8 +1020,15 @@ namespace
 
                 watches.clear_new_nogoods();
 
+                // give the ones we just learned a chance to be useful
+                // before they can be deleted
+                if (params.nogood_reduce_interval && 0 == number_of_restarts % params.nogood_reduce_interval)
+                    watches.reduce_nogoods(params.nogood_reduce_fraction, latest_nogoods);
+                latest_nogoods = watches.nogoods.size();
+
                 auto new_p = p;
                 vector<int> c;
+                c.reserve(size);
                 conditional_t<connected_, SVOBitset, int> a{ };
                 if constexpr (connected_)
                     a = SVOBitset{ unsigned(size), 0 };
@@ -609,8 +1053,20 @@ namespace
                 params.restarts_schedule->did_a_restart();
             }
 
-            if (params.restarts_schedule->might_restart())
+            if (params.restarts_schedule->might_restart()) {
                 result.extra_stats.emplace_back("restarts = " + to_string(number_of_restarts));
+                result.extra_stats.emplace_back("nogoods_stored = " + to_string(watches.nogoods.size()));
+                result.extra_stats.emplace_back("nogoods_deleted = " + to_string(watches.deleted));
+                result.extra_stats.emplace_back("nogood_propagations = " + to_string(watches.propagations));
+            }
+
+            if (params.allocation_stats)
+                result.extra_stats.emplace_back("search_allocations = " + to_string(search_allocations));
+
+            if (params.tighten_bounds) {
+                result.extra_stats.emplace_back("tightened_by_recolouring = " + to_string(tightened_by_recolouring));
+                result.extra_stats.emplace_back("tightened_by_conflicts = " + to_string(tightened_by_conflicts));
+            }
 
             if (params.proof && params.decide && incumbent.c.empty() && ! params.proof_is_for_hom)
                 params.proof->finish_unsat_proof();
@@ -623,7 +1079,361 @@ namespace
 
             return result;
         }
+
+        auto decided() const -> bool
+        {
+            return (params.decide && incumbent.value >= *params.decide) ||
+                (params.stop_after_finding && incumbent.value >= *params.stop_after_finding);
+        }
+
+        // either search a task, or if it is near the top of the tree, do
+        // what expand() would do for its node but turn each branch into a
+        // new task instead of recursing
+        auto search_or_split(
+                Task & task,
+                vector<Task> & children,
+                unsigned long long & nodes,
+                unsigned long long & find_nodes,
+                unsigned long long & prove_nodes) -> SearchResult
+        {
+            if (params.timeout->should_abort())
+                return SearchResult::Aborted;
+
+            // the incumbent might have improved since the task was created
+            if (task.bound <= incumbent.value)
+                return SearchResult::Complete;
+
+            auto & c = task.c;
+            auto & p = task.p;
+
+            if (c.size() >= parallel_split_depth)
+                return expand<false>(c.size(), nodes, find_nodes, prove_nodes, c, p, 0, 0);
+
+            ++nodes;
+            ++prove_nodes;
+
+            int * p_order = &space[0];
+            int * p_bounds = &space[size];
+            int p_end = 0;
+            auto range = colouring.all_words();
+            colour_class_order_from_params(p, range, p_order, p_bounds, &space[2 * size], p_end);
+            if (params.tighten_bounds)
+                tighten_bound(c.size(), c.size(), p_order, p_bounds, p_end);
+
+            for (int n = p_end - 1 ; n >= 0 ; --n) {
+                if (c.size() + p_bounds[n] <= incumbent.value)
+                    break;
+
+                if (p_bounds[n] == n + 1) {
+                    auto clique = c;
+                    for ( ; n >= 0 ; --n)
+                        clique.push_back(p_order[n]);
+                    incumbent.update(clique, find_nodes, prove_nodes);
+                    if (decided())
+                        return SearchResult::DecidedTrue;
+                    break;
+                }
+
+                auto v = p_order[n];
+                Task child{ c, p, unsigned(c.size() + p_bounds[n]) };
+                child.c.push_back(v);
+
+                if (params.decide || params.stop_after_finding) {
+                    if (decided())
+                        return SearchResult::DecidedTrue;
+                }
+                else
+                    incumbent.update(child.c, find_nodes, prove_nodes);
+
+                if (child.p.intersect_with_and_any(adj[v]))
+                    children.push_back(move(child));
+
+                p.reset(v);
+            }
+
+            return SearchResult::Complete;
+        }
+
+        auto run_parallel() -> CliqueResult
+        {
+            CliqueResult result;
+
+            if (params.decide)
+                incumbent.value = *params.decide - 1;
+
+            if (warm_start(result)) {
+                for (auto & v : incumbent.c)
+                    result.clique.insert(order[v]);
+                return result;
+            }
+
+            unsigned n_threads = max(1u, params.threads ? params.threads : thread::hardware_concurrency());
+
+            vector<unique_ptr<CliqueRunner> > runners;
+            for (unsigned t = 1 ; t < n_threads ; ++t)
+                runners.push_back(make_unique<CliqueRunner>(*this));
+
+            vector<CliqueResult> thread_results(n_threads);
+
+            WorkStealingQueues<Task> queues{ n_threads };
+            Task root{ { }, Bitset_{ unsigned(size), 0 }, unsigned(size) + 1 };
+            for (int i = 0 ; i < size ; ++i)
+                root.p.set(i);
+            remove_low_core_vertices(root.p);
+            vector<Task> roots;
+            roots.push_back(move(root));
+            queues.push(0, move(roots));
+
+            auto work = [&] (unsigned t, CliqueRunner & runner) {
+                auto & r = thread_results[t];
+                while (true) {
+                    auto task = queues.take(t);
+                    if (! task) {
+                        if (queues.wait_for_work())
+                            continue;
+                        else
+                            break;
+                    }
+
+                    vector<Task> children;
+                    if (SearchResult::DecidedTrue == runner.search_or_split(*task, children, r.nodes, r.find_nodes, r.prove_nodes)) {
+                        // stop everyone else, without this counting as a timeout
+                        params.timeout->trigger_early_abort();
+                    }
+
+                    queues.push(t, move(children));
+                    queues.finished();
+                }
+            };
+
+            vector<thread> threads;
+            for (unsigned t = 1 ; t < n_threads ; ++t)
+                threads.emplace_back([&, t] { work(t, *runners[t - 1]); });
+            work(0, *this);
+            for (auto & t : threads)
+                t.join();
+
+            for (auto & r : thread_results) {
+                result.nodes += r.nodes;
+                result.find_nodes += r.find_nodes;
+                result.prove_nodes += r.prove_nodes;
+            }
+
+            if (params.allocation_stats) {
+                auto allocations = search_allocations;
+                for (auto & r : runners)
+                    allocations += r->search_allocations;
+                result.extra_stats.emplace_back("search_allocations = " + to_string(allocations));
+            }
+
+            if (params.tighten_bounds) {
+                auto recolourings = tightened_by_recolouring, conflicts = tightened_by_conflicts;
+                for (auto & r : runners) {
+                    recolourings += r->tightened_by_recolouring;
+                    conflicts += r->tightened_by_conflicts;
+                }
+                result.extra_stats.emplace_back("tightened_by_recolouring = " + to_string(recolourings));
+                result.extra_stats.emplace_back("tightened_by_conflicts = " + to_string(conflicts));
+            }
+
+            for (auto & v : incumbent.c)
+                result.clique.insert(order[v]);
+
+            return result;
+        }
     };
+
+    template <typename Bitset_>
+    auto run_with(const InputGraph & graph, const ReducedGraph * reduced, const CliqueParams & params, Incumbent & incumbent) -> CliqueResult
+    {
+        CliqueRunner<Bitset_> runner{ graph, reduced, params, incumbent };
+        if (params.threads != 1)
+            return runner.run_parallel();
+        else
+            return runner.template run<false>();
+    }
+
+    // use the smallest fixed width that fits
+    auto run_sized(unsigned n, const InputGraph & graph, const ReducedGraph * reduced, const CliqueParams & params, Incumbent & incumbent) -> CliqueResult
+    {
+        if (n <= FixedBitset<1>::capacity)
+            return run_with<FixedBitset<1> >(graph, reduced, params, incumbent);
+        else if (n <= FixedBitset<2>::capacity)
+            return run_with<FixedBitset<2> >(graph, reduced, params, incumbent);
+        else if (n <= FixedBitset<4>::capacity)
+            return run_with<FixedBitset<4> >(graph, reduced, params, incumbent);
+        else if (n <= FixedBitset<8>::capacity)
+            return run_with<FixedBitset<8> >(graph, reduced, params, incumbent);
+        else if (n <= FixedBitset<16>::capacity)
+            return run_with<FixedBitset<16> >(graph, reduced, params, incumbent);
+        else if (n <= FixedBitset<32>::capacity)
+            return run_with<FixedBitset<32> >(graph, reduced, params, incumbent);
+        else if (n <= FixedBitset<64>::capacity)
+            return run_with<FixedBitset<64> >(graph, reduced, params, incumbent);
+        else
+            return run_with<SVOBitset>(graph, reduced, params, incumbent);
+    }
+
+    // every clique lies in the neighbourhood of whichever of its vertices
+    // comes first in a degeneracy ordering, and a vertex has at most the
+    // degeneracy of the graph neighbours later in the ordering, so for a
+    // sparse graph we can solve one small subproblem per vertex rather
+    // than one huge problem. subproblems are shared out between threads,
+    // highest core number first, and each starts from the best clique
+    // found so far by any of them.
+    auto run_decomposed(const InputGraph & graph, const ReducedGraph * reduced, const CliqueParams & params, Incumbent & incumbent) -> CliqueResult
+    {
+        CliqueResult result;
+
+        if (params.decide)
+            incumbent.value = max<unsigned>(incumbent.value, *params.decide - 1);
+
+        unsigned target = graph.size() + 1;
+        if (params.decide)
+            target = min(target, *params.decide);
+        if (params.stop_after_finding)
+            target = min(target, *params.stop_after_finding);
+
+        int n = graph.size();
+        vector<int> peel_order, core_numbers(n, -1);
+        if (reduced) {
+            peel_order = reduced->peel_order;
+            for (unsigned i = 0 ; i < peel_order.size() ; ++i)
+                core_numbers[peel_order[i]] = reduced->core_numbers[i];
+        }
+        else {
+            auto d = degeneracy_order(graph, vector<char>(n, 0));
+            peel_order = move(d.order);
+            core_numbers = move(d.core_numbers);
+        }
+
+        vector<int> position(n, -1);
+        for (unsigned i = 0 ; i < peel_order.size() ; ++i)
+            position[peel_order[i]] = i;
+
+        // for each vertex, its neighbours that come later in the ordering
+        vector<long> later_start(peel_order.size() + 1, 0);
+        vector<int> later;
+        for (unsigned i = 0 ; i < peel_order.size() ; ++i) {
+            auto [ begin, end ] = graph.neighbours(peel_order[i]);
+            for (auto w = begin ; w != end ; ++w)
+                if (position[*w] > int(i))
+                    later.push_back(*w);
+            later_start[i + 1] = later.size();
+        }
+
+        unsigned n_threads = max(1u, params.threads ? params.threads : thread::hardware_concurrency());
+        vector<CliqueResult> thread_results(n_threads);
+        vector<unsigned long long> thread_subproblems(n_threads, 0);
+        atomic<unsigned> next_subproblem{ 0 };
+
+        auto work = [&] (unsigned t) {
+            auto & r = thread_results[t];
+
+            // each subproblem is searched by a single thread, as a plain
+            // maximum clique problem with a lower bound
+            CliqueParams sub_params;
+            sub_params.timeout = params.timeout;
+            sub_params.start_time = params.start_time;
+            sub_params.restarts_schedule.reset(params.restarts_schedule->clone());
+            sub_params.nogood_size_limit = params.nogood_size_limit;
+            sub_params.nogood_reduce_interval = params.nogood_reduce_interval;
+            sub_params.nogood_reduce_fraction = params.nogood_reduce_fraction;
+            sub_params.colour_class_order = params.colour_class_order;
+            sub_params.tighten_bounds = params.tighten_bounds;
+            if (target <= unsigned(graph.size()))
+                sub_params.stop_after_finding = target - 1;
+
+            vector<int> local(n, -1);
+            vector<pair<int, int> > edges;
+            vector<int> candidate;
+
+            for (unsigned s = next_subproblem++ ; s < peel_order.size() ; s = next_subproblem++) {
+                if (params.timeout->should_abort())
+                    break;
+
+                int i = peel_order.size() - 1 - s, v = peel_order[i];
+                auto begin = later.begin() + later_start[i], end = later.begin() + later_start[i + 1];
+                int k = end - begin;
+
+                // a clique containing v has at most core number + 1 vertices
+                if (unsigned(min(k, core_numbers[v])) + 1 <= incumbent.value)
+                    continue;
+
+                ++thread_subproblems[t];
+
+                for (int j = 0 ; j < k ; ++j)
+                    local[begin[j]] = j;
+
+                // an edge between two later neighbours is a later
+                // neighbour of whichever of them comes first
+                edges.clear();
+                for (int j = 0 ; j < k ; ++j)
+                    for (auto w = later.begin() + later_start[position[begin[j]]], w_end = later.begin() + later_start[position[begin[j]] + 1] ; w != w_end ; ++w)
+                        if (-1 != local[*w])
+                            edges.emplace_back(j, local[*w]);
+
+                for (int j = 0 ; j < k ; ++j)
+                    local[begin[j]] = -1;
+
+                candidate.assign(1, v);
+                if (k > 0) {
+                    InputGraph sub_graph{ k, false, false };
+                    sub_graph.add_edges(move(edges));
+
+                    Incumbent sub_incumbent;
+                    sub_incumbent.value = max<unsigned>(incumbent.value, 1) - 1;
+                    auto sub_result = run_sized(k, sub_graph, nullptr, sub_params, sub_incumbent);
+                    r.nodes += sub_result.nodes;
+                    r.find_nodes += sub_result.find_nodes;
+                    r.prove_nodes += sub_result.prove_nodes;
+
+                    for (auto & w : sub_result.clique)
+                        candidate.push_back(begin[w]);
+                }
+                incumbent.update(candidate, r.find_nodes, r.prove_nodes);
+
+                if (incumbent.value >= target) {
+                    // stop everyone else, without this counting as a timeout
+                    params.timeout->trigger_early_abort();
+                    break;
+                }
+            }
+        };
+
+        vector<thread> threads;
+        for (unsigned t = 1 ; t < n_threads ; ++t)
+            threads.emplace_back(work, t);
+        work(0);
+        for (auto & t : threads)
+            t.join();
+
+        unsigned long long subproblems = 0;
+        for (unsigned t = 0 ; t < n_threads ; ++t) {
+            result.nodes += thread_results[t].nodes;
+            result.find_nodes += thread_results[t].find_nodes;
+            result.prove_nodes += thread_results[t].prove_nodes;
+            subproblems += thread_subproblems[t];
+        }
+
+        result.clique.insert(incumbent.c.begin(), incumbent.c.end());
+
+        int degeneracy = 0;
+        for (auto & v : peel_order)
+            degeneracy = max(degeneracy, core_numbers[v]);
+        result.extra_stats.emplace_back("degeneracy = " + to_string(degeneracy));
+        result.extra_stats.emplace_back("subproblems = " + to_string(subproblems));
+
+        return result;
+    }
+
+    auto run_dense_or_decomposed(unsigned n, const InputGraph & graph, const ReducedGraph * reduced, const CliqueParams & params, Incumbent & incumbent) -> CliqueResult
+    {
+        if (params.sparse && ! params.proof && ! params.proof_is_for_hom && ! graph.directed())
+            return run_decomposed(graph, reduced, params, incumbent);
+        else
+            return run_sized(n, graph, reduced, params, incumbent);
+    }
 }
 
 auto solve_clique_problem(const InputGraph & graph, const CliqueParams & params) -> CliqueResult
@@ -633,10 +1443,26 @@ auto solve_clique_problem(const InputGraph & graph, const CliqueParams & params)
             for (int q = 0 ; q < graph.size() ; ++q)
                 params.proof->create_binary_variable(q, [&] (int v) { return graph.vertex_name(v); });
 
+            // we know how many constraints we're going to write, so we can
+            // stream the model to disk rather than holding it all in memory
+            long non_edges = long(graph.size()) * (graph.size() - 1) / 2;
+            if (graph.directed()) {
+                for (int p = 0 ; p < graph.size() ; ++p)
+                    for (int q = 0 ; q < p ; ++q)
+                        if (graph.adjacent(p, q))
+                            --non_edges;
+            }
+            else {
+                long loops = 0;
+                if (graph.loopy())
+                    for (int v = 0 ; v < graph.size() ; ++v)
+                        if (graph.adjacent(v, v))
+                            ++loops;
+                non_edges -= (graph.number_of_directed_edges() - loops) / 2;
+            }
+
+            params.proof->start_model(graph.size(), non_edges + (params.decide ? 1 : 0));
             params.proof->create_objective(graph.size(), params.decide);
-#ifdef VECTOR
-            params.proof->create_non_edge_constraint_vector(graph.size());
-#endif
             for (int p = 0 ; p < graph.size() ; ++p)
                 for (int q = 0 ; q < p ; ++q)
                     if (! graph.adjacent(p, q))
@@ -646,7 +1472,48 @@ auto solve_clique_problem(const InputGraph & graph, const CliqueParams & params)
         }
     }
 
-    CliqueRunner runner{ graph, params };
-    return params.connected ? runner.run<true>() : runner.run<false>();
-}
+    Incumbent incumbent;
+
+    // the connected reduction builds SVOBitsets for us, so it always uses them
+    if (params.connected) {
+        CliqueRunner<SVOBitset> runner{ graph, nullptr, params, incumbent };
+        return runner.run<true>();
+    }
+
+    optional<ReducedGraph> reduced;
+    if (params.reduce && ! params.proof_is_for_hom && ! graph.directed()) {
+        auto start_time = steady_clock::now();
+        reduced = reduce_clique_problem(graph, params, params.decide ? *params.decide - 1 : 0);
+        auto reduction_time = duration_cast<milliseconds>(steady_clock::now() - start_time).count();
+
+        auto add_reduction_stats = [&] (CliqueResult & result) {
+            result.extra_stats.emplace_front("reduction_time = " + to_string(reduction_time));
+            result.extra_stats.emplace_front("reduction_lower_bound = " + to_string(reduced->lower_bound));
+            result.extra_stats.emplace_front("reduced_size = " + to_string(reduced->vertices.size()));
+        };
+
+        // the greedy clique might be all we need
+        if ((params.decide && reduced->clique.size() >= *params.decide) ||
+                (params.stop_after_finding && reduced->clique.size() >= *params.stop_after_finding)) {
+            if (params.proof)
+                params.proof->post_solution(reduced->clique);
+
+            CliqueResult result;
+            result.clique.insert(reduced->clique.begin(), reduced->clique.end());
+            add_reduction_stats(result);
+            return result;
+        }
 
+        incumbent.value = reduced->lower_bound;
+
+        auto result = run_dense_or_decomposed(reduced->vertices.size(), graph, &*reduced, params, incumbent);
+        if (result.clique.size() < reduced->clique.size()) {
+            result.clique.clear();
+            result.clique.insert(reduced->clique.begin(), reduced->clique.end());
+        }
+        add_reduction_stats(result);
+        return result;
+    }
+
+    return run_dense_or_decomposed(graph.size(), graph, nullptr, params, incumbent);
+}
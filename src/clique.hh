@@ -40,15 +40,55 @@ struct CliqueParams
     /// Restarts schedule
     std::unique_ptr<RestartsSchedule> restarts_schedule;
 
-    /// Largest size of nogood to store (0 disables nogoods)
+    /// Largest size of nogood to store (0 disables nogoods, except for the
+    /// empty one that says the search is finished)
     unsigned nogood_size_limit = std::numeric_limits<unsigned>::max();
 
+    /// Delete some nogoods after this many restarts (0 never deletes)
+    unsigned nogood_reduce_interval = 0;
+
+    /// What fraction of the deletable nogoods to delete each time
+    double nogood_reduce_fraction = 0.5;
+
     /// Which colour order to use?
     ColourClassOrder colour_class_order = ColourClassOrder::SingletonsFirst;
 
     /// Colour in input order, rather than degree order
     bool input_order = false;
 
+    /// Search using this many threads, sharing out the top of the search
+    /// tree (no proofs or restarts unless this is 1)
+    unsigned threads = 1;
+
+    /// Report how many bitsets the search allocated, in extra_stats
+    bool allocation_stats = false;
+
+    /// After colouring, try to lower the bounds of the vertices the colour
+    /// bound can't prune, by recolouring them into earlier classes or by
+    /// finding infra-chromatic conflicts with pairs of earlier classes
+    bool tighten_bounds = false;
+
+    /// Delete vertices which can't be in a better clique, using core
+    /// numbers and colourings of neighbourhoods, before searching
+    bool reduce = false;
+
+    /// Rather than building an adjacency matrix for the whole graph, solve
+    /// one small subproblem for each vertex, following a degeneracy
+    /// ordering, sharing the subproblems out between threads (no proofs)
+    bool sparse = false;
+
+    /// Look for a good clique heuristically before searching
+    bool warm_start = false;
+
+    /// How many local search moves each warm start thread may make
+    unsigned long long warm_start_moves = 10000;
+
+    /// Give up on the warm start after this long
+    std::chrono::milliseconds warm_start_time_limit{ 1000 };
+
+    /// Threads to use for the warm start (0 for one per hardware thread)
+    unsigned warm_start_threads = 0;
+
     /// For use by the maximum common connected subgraph reduction
     std::function<auto (int, const std::function<auto (int) -> int> &) -> SVOBitset> connected;
 
@@ -0,0 +1,236 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#ifndef GLASGOW_SUBGRAPH_SOLVER_GUARD_SRC_CLIQUE_HEURISTIC_HH
+#define GLASGOW_SUBGRAPH_SOLVER_GUARD_SRC_CLIQUE_HEURISTIC_HH 1
+
+#include "svo_bitset.hh"
+
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * A quick way of finding a big clique, to give the search a good incumbent
+ * before it starts. There are two parts: greedy construction, which starts
+ * from a seed vertex and repeatedly adds the highest degree vertex that is
+ * adjacent to everything so far, and then a short local search, in the
+ * style of multi-neighbourhood tabu search for maximum clique. The local
+ * search adds a vertex whenever it can, otherwise swaps a vertex in for
+ * the only clique member it isn't adjacent to (making the removed vertex
+ * tabu for a while), and otherwise drops a vertex. It restarts from a
+ * random vertex if it goes too long without finding a bigger clique.
+ *
+ * Vertices must be numbered in degree order, highest degree first, as they
+ * are in the search. Bitset_ is SVOBitset, or a FixedBitset.
+ */
+template <typename Bitset_>
+class CliqueHeuristic
+{
+    private:
+        using BitWord = SVOBitset::BitWord;
+
+        const std::vector<Bitset_> & _adj;
+        int _size;
+        unsigned _n_words;
+        BitWord _last_word_mask;
+
+        /// Local search restarts after this many moves without improving
+        static constexpr unsigned long long restart_after = 4000;
+
+        /// How many candidates to score when picking a vertex to add
+        static constexpr unsigned add_samples = 16;
+
+        template <typename Function_>
+        auto _for_each_non_neighbour(int v, const Function_ & f) const -> void
+        {
+            const BitWord * words = _adj[v].words();
+            for (unsigned i = 0 ; i < _n_words ; ++i) {
+                BitWord w = ~words[i];
+                if (i + 1 == _n_words)
+                    w &= _last_word_mask;
+                while (0 != w) {
+                    int x = i * SVOBitset::bits_per_word + __builtin_ctzll(w);
+                    w &= w - 1;
+                    if (x != v)
+                        f(x);
+                }
+            }
+        }
+
+    public:
+        /**
+         * The adjacency bitsets must outlive us, and must not be resized.
+         */
+        CliqueHeuristic(const std::vector<Bitset_> & adj, int size) :
+            _adj(adj),
+            _size(size),
+            _n_words((size + SVOBitset::bits_per_word - 1) / SVOBitset::bits_per_word),
+            _last_word_mask(0 == size % SVOBitset::bits_per_word ? ~BitWord{ 0 } :
+                    (BitWord{ 1 } << (size % SVOBitset::bits_per_word)) - 1)
+        {
+        }
+
+        /**
+         * Greedily build a clique containing seed.
+         */
+        auto greedy(int seed) const -> std::vector<int>
+        {
+            std::vector<int> c{ seed };
+            Bitset_ p = _adj[seed];
+            p.reset(seed);
+            for (unsigned v = p.find_first() ; v != Bitset_::npos ; v = p.find_first()) {
+                c.push_back(v);
+                p &= _adj[v];
+                p.reset(v);
+            }
+            return c;
+        }
+
+        /**
+         * Local search starting from the clique start, for at most max_moves
+         * moves, or until we find a clique of size target, or should_stop()
+         * returns true. Returns the biggest clique seen.
+         */
+        template <typename ShouldStop_>
+        auto local_search(const std::vector<int> & start, unsigned long long max_moves, unsigned target,
+                std::mt19937_64 & rng, const ShouldStop_ & should_stop) const -> std::vector<int>
+        {
+            std::vector<int> best = start, c;
+            if (0 == _size)
+                return best;
+
+            // for each vertex, how many members of c it isn't adjacent to
+            std::vector<unsigned> missing(_size, 0);
+            std::vector<char> in_c(_size, 0);
+            std::vector<unsigned long long> tabu_until(_size, 0);
+            std::vector<int> add_moves, swap_moves;
+            Bitset_ addable{ unsigned(_size), 0 };
+
+            auto add = [&] (int v) {
+                in_c[v] = 1;
+                c.push_back(v);
+                _for_each_non_neighbour(v, [&] (int w) { ++missing[w]; });
+            };
+
+            auto remove = [&] (int u) {
+                in_c[u] = 0;
+                c.erase(std::find(c.begin(), c.end(), u));
+                _for_each_non_neighbour(u, [&] (int w) { --missing[w]; });
+            };
+
+            for (auto & v : start)
+                add(v);
+
+            unsigned long long last_improvement = 0;
+            for (unsigned long long move = 1 ; move <= max_moves && best.size() < target ; ++move) {
+                if (0 == move % 256 && should_stop())
+                    break;
+
+                if (move - last_improvement > restart_after) {
+                    while (! c.empty())
+                        remove(c.back());
+                    add(rng() % _size);
+                    last_improvement = move;
+                    continue;
+                }
+
+                add_moves.clear();
+                swap_moves.clear();
+                for (int w = 0 ; w < _size ; ++w)
+                    if ((! in_c[w]) && tabu_until[w] <= move) {
+                        if (0 == missing[w])
+                            add_moves.push_back(w);
+                        else if (1 == missing[w])
+                            swap_moves.push_back(w);
+                    }
+
+                if (! add_moves.empty()) {
+                    // prefer vertices which leave lots of other vertices addable
+                    int v = add_moves[0];
+                    if (add_moves.size() > 1) {
+                        addable.reset();
+                        for (auto & w : add_moves)
+                            addable.set(w);
+
+                        unsigned best_score = 0;
+                        for (unsigned s = 0 ; s < std::min<unsigned>(add_samples, add_moves.size()) ; ++s) {
+                            int w = add_moves[add_samples >= add_moves.size() ? s : rng() % add_moves.size()];
+                            unsigned score = _adj[w].count_intersection(addable);
+                            if (0 == s || score > best_score) {
+                                best_score = score;
+                                v = w;
+                            }
+                        }
+                    }
+
+                    add(v);
+                    if (c.size() > best.size()) {
+                        best = c;
+                        last_improvement = move;
+                    }
+                }
+                else if (! swap_moves.empty()) {
+                    int v = swap_moves[rng() % swap_moves.size()];
+                    int u = *std::find_if(c.begin(), c.end(), [&] (int u) { return ! _adj[u].test(v); });
+                    remove(u);
+                    add(v);
+                    tabu_until[u] = move + 7 + rng() % (swap_moves.size() + 1);
+                }
+                else if (! c.empty()) {
+                    // stuck on a plateau, so drop something
+                    int u = c[rng() % c.size()];
+                    remove(u);
+                    tabu_until[u] = move + 7;
+                }
+            }
+
+            return best;
+        }
+};
+
+/**
+ * Run greedy construction from every vertex, shared out between n_threads
+ * threads, and then have each thread run a local search from the best
+ * clique it found, with its own random seed. Stops early if a clique of
+ * size target is found, or if should_stop(), which must be safe to call
+ * from any thread, returns true. Returns the biggest clique found, in the
+ * same numbering as adj.
+ */
+template <typename Bitset_, typename ShouldStop_>
+auto find_heuristic_clique(const std::vector<Bitset_> & adj, int size, unsigned n_threads,
+        unsigned long long max_moves, unsigned target, const ShouldStop_ & should_stop) -> std::vector<int>
+{
+    CliqueHeuristic<Bitset_> heuristic{ adj, size };
+    std::vector<std::vector<int> > results(n_threads);
+
+    auto work = [&] (unsigned t) {
+        auto & best = results[t];
+        for (int s = t ; s < size && best.size() < target ; s += n_threads) {
+            if (should_stop())
+                return;
+            auto c = heuristic.greedy(s);
+            if (c.size() > best.size())
+                best = std::move(c);
+        }
+
+        std::mt19937_64 rng{ t };
+        best = heuristic.local_search(best, max_moves, target, rng, should_stop);
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned t = 1 ; t < n_threads ; ++t)
+        threads.emplace_back(work, t);
+    work(0);
+    for (auto & t : threads)
+        t.join();
+
+    std::vector<int> result;
+    for (auto & r : results)
+        if (r.size() > result.size())
+            result = std::move(r);
+    return result;
+}
+
+#endif
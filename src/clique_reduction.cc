@@ -0,0 +1,310 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#include "clique_reduction.hh"
+#include "proof.hh"
+
+#include <algorithm>
+#include <utility>
+
+using std::all_of;
+using std::any_of;
+using std::find;
+using std::max;
+using std::min;
+using std::move;
+using std::pair;
+using std::sort;
+using std::vector;
+
+namespace
+{
+    // colouring a neighbourhood costs up to the square of its size in
+    // adjacency tests, so we don't bother for vertices with more neighbours
+    // than this. these are rarely removable anyway.
+    constexpr int colour_reduction_degree_limit = 256;
+
+    // call f(w) for every neighbour w of v that hasn't been removed,
+    // ignoring loops
+    template <typename Function_>
+    auto for_each_remaining_neighbour(const InputGraph & graph, const vector<char> & removed, int v, const Function_ & f) -> void
+    {
+        auto [ begin, end ] = graph.neighbours(v);
+        for (auto w = begin ; w != end ; ++w)
+            if (*w != v && ! removed[*w])
+                f(*w);
+    }
+
+    auto remaining_degree(const InputGraph & graph, const vector<char> & removed, int v) -> int
+    {
+        int result = 0;
+        for_each_remaining_neighbour(graph, removed, v, [&] (int) { ++result; });
+        return result;
+    }
+
+    // for each vertex from the end of the degeneracy order, greedily build
+    // a clique from its neighbours that come later in the order, latest
+    // first. returns the biggest, if it's bigger than best_size.
+    auto greedy_clique(const InputGraph & graph, const vector<char> & removed, const DegeneracyOrder & d,
+            unsigned best_size) -> vector<int>
+    {
+        vector<int> best, c, candidates;
+        for (int i = int(d.order.size()) - 1 ; i >= 0 ; --i) {
+            int v = d.order[i];
+
+            // core numbers only go down from here
+            if (unsigned(d.core_numbers[v]) + 1 <= max<unsigned>(best_size, best.size()))
+                break;
+
+            candidates.clear();
+            for_each_remaining_neighbour(graph, removed, v, [&] (int w) {
+                    if (d.position[w] > d.position[v])
+                        candidates.push_back(w);
+                    });
+            sort(candidates.begin(), candidates.end(), [&] (int a, int b) { return d.position[a] > d.position[b]; });
+
+            c.clear();
+            c.push_back(v);
+            for (unsigned j = 0 ; j < candidates.size() ; ++j) {
+                if (c.size() + candidates.size() - j <= max<unsigned>(best_size, best.size()))
+                    break;
+
+                // search the lists of what's already in c, which stay in
+                // cache, rather than the list of each candidate
+                int w = candidates[j];
+                if (all_of(c.begin() + 1, c.end(), [&] (int x) { return graph.adjacent(x, w); }))
+                    c.push_back(w);
+            }
+
+            if (c.size() > max<unsigned>(best_size, best.size()))
+                best = c;
+        }
+
+        return best;
+    }
+
+    // greedily colour the remaining neighbours of v, giving up if that takes
+    // more than max_colours colours. colour_of must be -1 for every vertex,
+    // and is left that way.
+    auto colour_neighbourhood(const InputGraph & graph, const vector<char> & removed, int v, unsigned max_colours,
+            vector<vector<int> > & classes, vector<int> & colour_of) -> bool
+    {
+        classes.clear();
+        vector<char> used;
+        unsigned coloured = 0;
+        bool ok = true;
+        for_each_remaining_neighbour(graph, removed, v, [&] (int w) {
+                if (! ok)
+                    return;
+
+                // either scan the neighbours of w, or binary search its
+                // neighbours for each vertex we've coloured so far, whichever
+                // looks cheaper
+                used.assign(classes.size(), 0);
+                auto [ begin, end ] = graph.neighbours(w);
+                unsigned degree = end - begin, search_cost = 1;
+                while ((1u << search_cost) <= degree)
+                    ++search_cost;
+                if (degree <= coloured * search_cost) {
+                    for (auto x = begin ; x != end ; ++x)
+                        if (-1 != colour_of[*x])
+                            used[colour_of[*x]] = 1;
+                }
+                else {
+                    for (unsigned c = 0 ; c < classes.size() ; ++c)
+                        used[c] = any_of(classes[c].begin(), classes[c].end(), [&] (int x) { return graph.adjacent(w, x); });
+                }
+
+                unsigned c = find(used.begin(), used.end(), 0) - used.begin();
+                if (c == classes.size()) {
+                    if (classes.size() == max_colours) {
+                        ok = false;
+                        return;
+                    }
+                    classes.emplace_back();
+                }
+
+                classes[c].push_back(w);
+                colour_of[w] = c;
+                ++coloured;
+                });
+
+        for (auto & cc : classes)
+            for (auto & w : cc)
+                colour_of[w] = -1;
+
+        return ok;
+    }
+
+    auto log_deletion(const CliqueParams & params, int v, const vector<vector<int> > * colour_classes) -> void
+    {
+        if (! params.proof)
+            return;
+
+        // the same steps as the search uses to reject v at the top level
+        if (colour_classes) {
+            params.proof->start_level(1);
+            params.proof->colour_bound(*colour_classes);
+        }
+        params.proof->start_level(0);
+        params.proof->backtrack_from_binary_variables(vector<int>{ v });
+        if (colour_classes)
+            params.proof->forget_level(1);
+    }
+}
+
+auto degeneracy_order(const InputGraph & graph, const vector<char> & removed) -> DegeneracyOrder
+{
+    // Batagelj and Zaversnik's bucket algorithm
+    int n = graph.size();
+    DegeneracyOrder result;
+    result.core_numbers.assign(n, -1);
+    result.position.assign(n, -1);
+
+    auto & degree = result.core_numbers;
+    int max_degree = 0, count = 0;
+    for (int v = 0 ; v < n ; ++v)
+        if (! removed[v]) {
+            degree[v] = remaining_degree(graph, removed, v);
+            max_degree = max(max_degree, degree[v]);
+            ++count;
+        }
+
+    // bin_start[d] is where vertices of degree d start in order
+    vector<int> bin_start(max_degree + 2, 0);
+    for (int v = 0 ; v < n ; ++v)
+        if (! removed[v])
+            ++bin_start[degree[v] + 1];
+    for (int d = 1 ; d <= max_degree + 1 ; ++d)
+        bin_start[d] += bin_start[d - 1];
+
+    auto & pos = result.position;
+    result.order.resize(count);
+    {
+        vector<int> next = bin_start;
+        for (int v = 0 ; v < n ; ++v)
+            if (! removed[v]) {
+                pos[v] = next[degree[v]]++;
+                result.order[pos[v]] = v;
+            }
+    }
+
+    for (int i = 0 ; i < count ; ++i) {
+        int v = result.order[i];
+        result.degeneracy = max(result.degeneracy, degree[v]);
+        for_each_remaining_neighbour(graph, removed, v, [&] (int u) {
+                if (degree[u] > degree[v]) {
+                    // swap u with the first vertex of its bin, and shrink the bin
+                    int du = degree[u], pu = pos[u], pw = bin_start[du], w = result.order[pw];
+                    if (u != w) {
+                        result.order[pu] = w;
+                        pos[w] = pu;
+                        result.order[pw] = u;
+                        pos[u] = pw;
+                    }
+                    ++bin_start[du];
+                    --degree[u];
+                }
+                });
+    }
+
+    return result;
+}
+
+auto reduce_clique_problem(const InputGraph & graph, const CliqueParams & params, unsigned lower_bound) -> ReducedGraph
+{
+    int n = graph.size();
+    ReducedGraph result;
+    result.lower_bound = lower_bound;
+
+    unsigned target = n + 1;
+    if (params.decide)
+        target = min(target, *params.decide);
+    if (params.stop_after_finding)
+        target = min(target, *params.stop_after_finding);
+
+    vector<char> removed(n, 0);
+    vector<vector<int> > colour_classes;
+    vector<int> colour_of(n, -1);
+
+    DegeneracyOrder d;
+    while (true) {
+        d = degeneracy_order(graph, removed);
+
+        auto c = greedy_clique(graph, removed, d, result.lower_bound);
+        if (c.size() > result.lower_bound) {
+            result.clique = move(c);
+            result.lower_bound = result.clique.size();
+            if (params.proof && ! params.decide) {
+                vector<char> in_c(n, 0);
+                vector<pair<int, bool> > solution;
+                for (auto & v : result.clique) {
+                    in_c[v] = 1;
+                    solution.emplace_back(v, true);
+                }
+                for (int v = 0 ; v < n ; ++v)
+                    if (! in_c[v])
+                        solution.emplace_back(v, false);
+                params.proof->start_level(0);
+                params.proof->new_incumbent(solution);
+            }
+        }
+
+        if (result.clique.size() >= target)
+            break;
+
+        // a vertex in a clique with more than lower_bound vertices has at
+        // least lower_bound neighbours in the clique, so its core number is
+        // at least lower_bound. deleting in the degeneracy order means that
+        // each vertex has at most its core number of neighbours left when
+        // it goes, which is what the proof needs.
+        bool deleted_any = false;
+        for (auto & v : d.order)
+            if (unsigned(d.core_numbers[v]) < result.lower_bound) {
+                removed[v] = 1;
+                deleted_any = true;
+                log_deletion(params, v, nullptr);
+            }
+
+        // similarly, if its neighbourhood can be coloured using fewer than
+        // lower_bound colours
+        if (result.lower_bound > 0)
+            for (auto & v : d.order) {
+                if (removed[v] || params.timeout->should_abort())
+                    continue;
+
+                int degree = remaining_degree(graph, removed, v);
+                if (degree > colour_reduction_degree_limit || unsigned(degree) < result.lower_bound)
+                    continue;
+
+                if (colour_neighbourhood(graph, removed, v, result.lower_bound - 1, colour_classes, colour_of)) {
+                    removed[v] = 1;
+                    deleted_any = true;
+                    log_deletion(params, v, &colour_classes);
+                }
+            }
+
+        if (! deleted_any || params.timeout->should_abort())
+            break;
+    }
+
+    for (auto & v : d.order)
+        if (! removed[v]) {
+            result.peel_order.push_back(v);
+            result.core_numbers.push_back(d.core_numbers[v]);
+        }
+
+    vector<int> degrees(n, 0);
+    for (auto & v : result.peel_order) {
+        result.vertices.push_back(v);
+        degrees[v] = remaining_degree(graph, removed, v);
+    }
+
+    if (params.input_order)
+        sort(result.vertices.begin(), result.vertices.end());
+    else
+        sort(result.vertices.begin(), result.vertices.end(), [&] (int a, int b) {
+                return degrees[a] > degrees[b] || (degrees[a] == degrees[b] && a < b);
+                });
+
+    return result;
+}
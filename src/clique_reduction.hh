@@ -0,0 +1,75 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#ifndef GLASGOW_SUBGRAPH_SOLVER_GUARD_SRC_CLIQUE_REDUCTION_HH
+#define GLASGOW_SUBGRAPH_SOLVER_GUARD_SRC_CLIQUE_REDUCTION_HH 1
+
+#include "clique.hh"
+#include "formats/input_graph.hh"
+
+#include <vector>
+
+/**
+ * A degeneracy ordering of some of a graph's vertices, found by repeatedly
+ * removing a vertex of smallest remaining degree.
+ */
+struct DegeneracyOrder
+{
+    /// The vertices, in the order they were removed
+    std::vector<int> order;
+
+    /// The core number of each vertex, indexed by vertex (and -1 for
+    /// vertices that weren't included)
+    std::vector<int> core_numbers;
+
+    /// Where each vertex comes in order, indexed by vertex
+    std::vector<int> position;
+
+    /// The largest core number
+    int degeneracy = 0;
+};
+
+/**
+ * Compute a degeneracy ordering and core numbers for the subgraph induced
+ * by the vertices that aren't removed, in O(n + m) time. Loops are ignored.
+ * The graph must be undirected.
+ */
+auto degeneracy_order(const InputGraph & graph, const std::vector<char> & removed) -> DegeneracyOrder;
+
+/**
+ * What is left of a graph after reduce_clique_problem().
+ */
+struct ReducedGraph
+{
+    /// The remaining vertices, largest remaining degree first (or in input
+    /// order, if that is what the search is using)
+    std::vector<int> vertices;
+
+    /// The remaining vertices in the order they come in a degeneracy
+    /// ordering of what is left, with their core numbers
+    std::vector<int> peel_order, core_numbers;
+
+    /// The biggest clique found along the way, if it beat the lower bound
+    /// we were given. Its vertices might have been deleted, since they
+    /// can't be in anything bigger.
+    std::vector<int> clique;
+
+    /// The lower bound we reduced against, which is the size of clique if
+    /// we found one
+    unsigned lower_bound = 0;
+};
+
+/**
+ * Shrink the graph before searching for a clique bigger than lower_bound.
+ * A greedy clique in the degeneracy ordering raises the lower bound, then
+ * vertices whose core number is less than the lower bound are deleted,
+ * along with vertices whose neighbourhood can be greedily coloured using
+ * fewer colours than the lower bound, and this repeats until nothing more
+ * changes. If proof logging, the clique is logged as an incumbent (unless
+ * deciding), and each deletion is logged at level 0, so what is left can
+ * be searched as if the deleted vertices had never existed.
+ *
+ * The graph must be undirected.
+ */
+auto reduce_clique_problem(const InputGraph & graph, const CliqueParams & params, unsigned lower_bound) -> ReducedGraph;
+
+#endif
@@ -0,0 +1,157 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#ifndef GLASGOW_SUBGRAPH_SOLVER_GUARD_SRC_FIXED_BITSET_HH
+#define GLASGOW_SUBGRAPH_SOLVER_GUARD_SRC_FIXED_BITSET_HH 1
+
+#include "svo_bitset.hh"
+
+#include <limits>
+
+/**
+ * A bitset whose number of words is fixed at compile time, with the same
+ * interface as SVOBitset. Every loop has a constant trip count, so the
+ * compiler can unroll and vectorise it, and nothing is ever allocated
+ * on the heap, so copying one during search is just a copy of its words.
+ *
+ * The search is instantiated for a handful of sizes, and picks the
+ * smallest one that fits the graph, falling back to SVOBitset otherwise.
+ */
+template <unsigned words_>
+class FixedBitset
+{
+    public:
+        using BitWord = SVOBitset::BitWord;
+        static const constexpr int bits_per_word = SVOBitset::bits_per_word;
+
+        /// The most bits we can hold
+        static const constexpr unsigned capacity = words_ * bits_per_word;
+
+    private:
+        BitWord _data[words_];
+
+    public:
+        static constexpr const unsigned npos = std::numeric_limits<unsigned>::max();
+
+        FixedBitset()
+        {
+            reset();
+        }
+
+        /**
+         * For compatibility with SVOBitset. The size must be no more than
+         * capacity, and bits is used to fill every word.
+         */
+        FixedBitset(unsigned, unsigned bits)
+        {
+            for (unsigned i = 0 ; i < words_ ; ++i)
+                _data[i] = bits;
+        }
+
+        FixedBitset(const FixedBitset &) = default;
+
+        auto operator= (const FixedBitset &) -> FixedBitset & = default;
+
+        auto any() const -> bool
+        {
+            BitWord seen = 0;
+            for (unsigned i = 0 ; i < words_ ; ++i)
+                seen |= _data[i];
+            return 0 != seen;
+        }
+
+        auto find_first() const -> unsigned
+        {
+            for (unsigned i = 0 ; i < words_ ; ++i)
+                if (0 != _data[i])
+                    return i * bits_per_word + __builtin_ctzll(_data[i]);
+            return npos;
+        }
+
+        auto reset(int a) -> void
+        {
+            _data[unsigned(a) / bits_per_word] &= ~(BitWord{ 1 } << (unsigned(a) % bits_per_word));
+        }
+
+        auto reset() -> void
+        {
+            for (unsigned i = 0 ; i < words_ ; ++i)
+                _data[i] = 0;
+        }
+
+        auto set(int a) -> void
+        {
+            _data[unsigned(a) / bits_per_word] |= (BitWord{ 1 } << (unsigned(a) % bits_per_word));
+        }
+
+        auto test(int a) const -> bool
+        {
+            return _data[unsigned(a) / bits_per_word] & (BitWord{ 1 } << (unsigned(a) % bits_per_word));
+        }
+
+        auto operator&= (const FixedBitset & other) -> FixedBitset &
+        {
+            for (unsigned i = 0 ; i < words_ ; ++i)
+                _data[i] &= other._data[i];
+            return *this;
+        }
+
+        auto operator|= (const FixedBitset & other) -> FixedBitset &
+        {
+            for (unsigned i = 0 ; i < words_ ; ++i)
+                _data[i] |= other._data[i];
+            return *this;
+        }
+
+        auto intersect_with_complement(const FixedBitset & other) -> void
+        {
+            for (unsigned i = 0 ; i < words_ ; ++i)
+                _data[i] &= ~other._data[i];
+        }
+
+        /// Intersect with other, and then return whether anything is left,
+        /// in one pass
+        auto intersect_with_and_any(const FixedBitset & other) -> bool
+        {
+            BitWord seen = 0;
+            for (unsigned i = 0 ; i < words_ ; ++i)
+                seen |= (_data[i] &= other._data[i]);
+            return 0 != seen;
+        }
+
+        /// How many bits are in both this and other?
+        auto count_intersection(const FixedBitset & other) const -> unsigned
+        {
+            unsigned result = 0;
+            for (unsigned i = 0 ; i < words_ ; ++i)
+                result += __builtin_popcountll(_data[i] & other._data[i]);
+            return result;
+        }
+
+        auto number_of_words() const -> unsigned
+        {
+            return words_;
+        }
+
+        /// The underlying words, for things that need to work a word at a time
+        auto words() const -> const BitWord *
+        {
+            return _data;
+        }
+
+        /// Copy in n words, which must be no more than we have, and clear the rest
+        auto assign_words(const std::uint64_t * w, unsigned n) -> void
+        {
+            for (unsigned i = 0 ; i < words_ ; ++i)
+                _data[i] = i < n ? w[i] : 0;
+        }
+
+        auto count() const -> unsigned
+        {
+            unsigned result = 0;
+            for (unsigned i = 0 ; i < words_ ; ++i)
+                result += __builtin_popcountll(_data[i]);
+            return result;
+        }
+};
+
+#endif
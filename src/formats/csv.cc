@@ -2,115 +2,219 @@
 
 #include "formats/csv.hh"
 #include "formats/input_graph.hh"
+#include "formats/mapped_file.hh"
+#include "formats/parallel_parse.hh"
 
 #include <fstream>
 #include <optional>
-#include <tuple>
+#include <string_view>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 using std::ifstream;
+using std::move;
 using std::nullopt;
 using std::optional;
+using std::pair;
+using std::size_t;
 using std::string;
-using std::tuple;
+using std::string_view;
 using std::unordered_map;
 using std::vector;
 
 namespace
 {
-    auto read_csv(ifstream && infile, const string & filename, const optional<unordered_map<string, string> > & rename_map) -> InputGraph
+    // what we got from part of the file, with vertices numbered in the
+    // order they first appear in this part
+    struct CSVChunk
     {
-        if (! infile)
-            throw GraphFileError{ filename, "error opening file", false };
+        vector<string_view> names;
+        unordered_map<string_view, int> vertices;
 
-        unordered_map<string, int> vertices;
-        unordered_map<string, string> vertex_labels;
-        vector<tuple<int, int, string> > edges;
-        bool seen_vertex_label = false, seen_edge_label = false, seen_directed_edge = false;
+        // the first label given to each vertex, in the order they appear
+        vector<pair<int, string_view> > vertex_labels;
+
+        // one per edge line, with the lines using a > and the non-empty
+        // labels listed separately, since most files have neither
+        vector<pair<int, int> > edges;
+        vector<size_t> directed_edges;
+        vector<pair<size_t, string_view> > edge_labels;
+
+        // where each of our vertices ends up in the whole graph
+        vector<int> global_vertices;
+    };
+
+    auto vertex(CSVChunk & chunk, string_view name) -> int
+    {
+        auto [ it, inserted ] = chunk.vertices.try_emplace(name, chunk.names.size());
+        if (inserted)
+            chunk.names.push_back(name);
+        return it->second;
+    }
+
+    auto parse_csv(const string & filename, string_view text, CSVChunk & chunk) -> void
+    {
+        vector<bool> labelled;
 
-        string line;
+        for (size_t line_start = 0 ; line_start < text.size() ; ) {
+            auto line_end = text.find('\n', line_start);
+            if (string_view::npos == line_end)
+                line_end = text.size();
+            string_view line = text.substr(line_start, line_end - line_start);
+            line_start = line_end + 1;
 
-        while (getline(infile, line)) {
             auto pos = line.find_first_of(",>");
-            if (string::npos == pos)
+            if (string_view::npos == pos)
                 throw GraphFileError{ filename, "expected a comma but didn't get one", true };
 
-            string left = line.substr(0, pos), right = line.substr(pos + 1), label;
-            char delim = line.at(pos);
+            string_view left = line.substr(0, pos), right = line.substr(pos + 1), label;
+            char delim = line[pos];
 
             auto pos2 = right.find(',');
-            if (string::npos != pos2) {
+            if (string_view::npos != pos2) {
                 label = right.substr(pos2 + 1);
                 right = right.substr(0, pos2);
             }
 
             if (right.empty() && ! left.empty()) {
+                int v = vertex(chunk, left);
                 if (! label.empty()) {
-                    seen_vertex_label = true;
-                    vertex_labels.emplace(left, label);
+                    labelled.resize(chunk.names.size(), false);
+                    if (! labelled[v]) {
+                        labelled[v] = true;
+                        chunk.vertex_labels.emplace_back(v, label);
+                    }
                 }
-
-                vertices.emplace(left, vertices.size());
             }
             else {
-                int left_idx = vertices.emplace(left, vertices.size()).first->second;
-                int right_idx = vertices.emplace(right, vertices.size()).first->second;
+                int left_idx = vertex(chunk, left);
+                int right_idx = vertex(chunk, right);
 
                 if (! label.empty())
-                    seen_edge_label = true;
+                    chunk.edge_labels.emplace_back(chunk.edges.size(), label);
+                if (delim == '>')
+                    chunk.directed_edges.push_back(chunk.edges.size());
+                chunk.edges.emplace_back(left_idx, right_idx);
+            }
+        }
+    }
 
-                if (delim == '>') {
-                    seen_directed_edge = true;
-                    edges.emplace_back(left_idx, right_idx, label);
+    auto read_csv(const MappedFile & file, const string & filename, const optional<unordered_map<string, string> > & rename_map) -> InputGraph
+    {
+        auto pieces = split_at_lines(file.contents(), parse_chunk_count(file.contents().size()));
+        vector<CSVChunk> chunks(pieces.size());
+        parse_in_parallel(pieces.size(), [&] (unsigned c) { parse_csv(filename, pieces[c], chunks[c]); });
+
+        // number vertices in the order they first appear in the whole file,
+        // which is the order they first appear in the first piece they're in
+        unordered_map<string_view, int> vertices;
+        vector<string_view> names;
+        bool seen_vertex_label = false, seen_edge_label = false, seen_directed_edge = false;
+        for (auto & chunk : chunks) {
+            chunk.global_vertices.reserve(chunk.names.size());
+            for (auto & name : chunk.names) {
+                auto [ it, inserted ] = vertices.try_emplace(name, names.size());
+                if (inserted)
+                    names.push_back(name);
+                chunk.global_vertices.push_back(it->second);
+            }
+
+            seen_vertex_label = seen_vertex_label || ! chunk.vertex_labels.empty();
+            seen_edge_label = seen_edge_label || ! chunk.edge_labels.empty();
+            seen_directed_edge = seen_directed_edge || ! chunk.directed_edges.empty();
+        }
+
+        parse_in_parallel(chunks.size(), [&] (unsigned c) {
+                for (auto & [ f, t ] : chunks[c].edges) {
+                    f = chunks[c].global_vertices[f];
+                    t = chunks[c].global_vertices[t];
                 }
-                else {
-                    edges.emplace_back(left_idx, right_idx, label);
-                    edges.emplace_back(right_idx, left_idx, label);
+            });
+
+        InputGraph result{ int(names.size()), seen_vertex_label, seen_edge_label };
+
+        if (seen_directed_edge || seen_edge_label) {
+            for (auto & chunk : chunks) {
+                auto directed = chunk.directed_edges.begin();
+                auto label = chunk.edge_labels.begin();
+                for (size_t e = 0 ; e < chunk.edges.size() ; ++e) {
+                    auto [ f, t ] = chunk.edges[e];
+
+                    bool is_directed = directed != chunk.directed_edges.end() && *directed == e;
+                    if (is_directed)
+                        ++directed;
+
+                    string_view l;
+                    if (label != chunk.edge_labels.end() && label->first == e)
+                        l = (label++)->second;
+
+                    if (seen_directed_edge) {
+                        result.add_directed_edge(f, t, l);
+                        if (! is_directed)
+                            result.add_directed_edge(t, f, l);
+                    }
+                    else {
+                        // each line counts as an edge each way round, and
+                        // each of those is added in both directions
+                        result.add_directed_edge(f, t, l);
+                        result.add_directed_edge(t, f, l);
+                        result.add_directed_edge(t, f, l);
+                        result.add_directed_edge(f, t, l);
+                    }
                 }
             }
         }
-
-        InputGraph result{ int(vertices.size()), seen_vertex_label, seen_edge_label };
-
-        for (auto & [ f, t, l ] : edges)
-            if (seen_directed_edge)
-                result.add_directed_edge(f, t, l);
-            else if (seen_edge_label) {
-                result.add_directed_edge(f, t, l);
-                result.add_directed_edge(t, f, l);
+        else {
+            vector<pair<int, int> > edges;
+            size_t n_edges = 0;
+            for (auto & chunk : chunks)
+                n_edges += chunk.edges.size();
+            edges.reserve(2 * n_edges);
+            for (auto & chunk : chunks) {
+                edges.insert(edges.end(), chunk.edges.begin(), chunk.edges.end());
+                chunk.edges.clear();
+                chunk.edges.shrink_to_fit();
             }
-            else
-                result.add_edge(f, t);
+            result.add_edges(move(edges));
+        }
 
-        auto rename = [&] (const string & s) -> string {
+        auto rename = [&] (string_view s) -> string_view {
             if (rename_map) {
-                auto r = rename_map->find(s);
+                auto r = rename_map->find(string{ s });
                 if (r == rename_map->end())
-                    throw GraphFileError{ filename, "did not find a name for vertex '" + s + "'", true };
+                    throw GraphFileError{ filename, "did not find a name for vertex '" + string{ s } + "'", true };
                 return r->second;
             }
             else
                 return s;
         };
 
-        for (auto & [v, l] : vertices)
-            result.set_vertex_name(l, rename(v));
-
-        if (seen_vertex_label)
-            for (auto & [v, l] : vertices)
-                result.set_vertex_label(l, vertex_labels[v]);
+        for (unsigned v = 0 ; v < names.size() ; ++v)
+            result.set_vertex_name(v, rename(names[v]));
+
+        if (seen_vertex_label) {
+            vector<bool> labelled(names.size(), false);
+            for (auto & chunk : chunks)
+                for (auto & [ v, l ] : chunk.vertex_labels) {
+                    int g = chunk.global_vertices[v];
+                    if (! labelled[g]) {
+                        labelled[g] = true;
+                        result.set_vertex_label(g, l);
+                    }
+                }
+        }
 
         return result;
     }
 }
 
-auto read_csv(ifstream && infile, const string & filename) -> InputGraph
+auto read_csv(const MappedFile & file, const string & filename) -> InputGraph
 {
-    return read_csv(move(infile), filename, nullopt);
+    return read_csv(file, filename, nullopt);
 }
 
-auto read_csv_name(std::ifstream && infile, const std::string & filename, const std::string & name_map_filename) -> InputGraph
+auto read_csv_name(const MappedFile & file, const string & filename, const string & name_map_filename) -> InputGraph
 {
     ifstream name_map_file{ name_map_filename };
     if (! name_map_file)
@@ -127,7 +231,5 @@ auto read_csv_name(std::ifstream && infile, const std::string & filename, const
         rename_map->emplace(left, right);
     }
 
-    return read_csv(move(infile), filename, rename_map);
+    return read_csv(file, filename, rename_map);
 }
-
-
@@ -5,17 +5,19 @@
 
 #include "formats/input_graph.hh"
 #include "formats/graph_file_error.hh"
+#include "formats/mapped_file.hh"
 
-#include <iosfwd>
 #include <string>
 
 /**
- * Read a CSV format file into an InputGraph.
+ * Read a CSV format file into an InputGraph. Big files are split into
+ * pieces which are parsed in parallel. Vertices are numbered in the order
+ * they first appear.
  *
  * \throw GraphFileError
  */
-auto read_csv(std::ifstream && infile, const std::string & filename) -> InputGraph;
+auto read_csv(const MappedFile & file, const std::string & filename) -> InputGraph;
 
-auto read_csv_name(std::ifstream && infile, const std::string & filename, const std::string & name_map_filename) -> InputGraph;
+auto read_csv_name(const MappedFile & file, const std::string & filename, const std::string & name_map_filename) -> InputGraph;
 
 #endif
@@ -3,63 +3,189 @@
 #include "formats/dimacs.hh"
 #include "formats/input_graph.hh"
 #include "formats/graph_file_error.hh"
+#include "formats/mapped_file.hh"
 
-#include <fstream>
-#include <regex>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
 
-using std::getline;
-using std::ifstream;
-using std::regex;
-using std::smatch;
-using std::stoi;
+using std::max;
+using std::min;
+using std::move;
+using std::numeric_limits;
+using std::out_of_range;
+using std::pair;
 using std::string;
+using std::string_view;
 using std::to_string;
+using std::vector;
 
-auto read_dimacs(ifstream && infile, const string & filename) -> InputGraph
+namespace
 {
+    // the same as what std::regex means by \s and \d
+    auto is_space(char c) -> bool
+    {
+        return ' ' == c || '\t' == c || '\n' == c || '\v' == c || '\f' == c || '\r' == c;
+    }
+
+    auto is_digit(char c) -> bool
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    // reads through one line, matching it piece by piece
+    struct LineScanner
+    {
+        const char * p, * end;
+
+        // a number that didn't fit in an int, which stoi would have
+        // complained about if the line turns out to match
+        bool overflow = false;
+
+        auto at_end() const -> bool
+        {
+            return p == end;
+        }
+
+        auto literal(char c) -> bool
+        {
+            if (p != end && c == *p) {
+                ++p;
+                return true;
+            }
+            return false;
+        }
+
+        auto literal(string_view s) -> bool
+        {
+            if (string_view::size_type(end - p) >= s.size() && string_view{ p, s.size() } == s) {
+                p += s.size();
+                return true;
+            }
+            return false;
+        }
+
+        // \s*, returning whether there was at least one
+        auto spaces() -> bool
+        {
+            auto start = p;
+            while (p != end && is_space(*p))
+                ++p;
+            return p != start;
+        }
+
+        // \d+
+        auto number(int & result) -> bool
+        {
+            auto start = p;
+            long long value = 0;
+            while (p != end && is_digit(*p)) {
+                if (value <= numeric_limits<int>::max())
+                    value = value * 10 + (*p - '0');
+                ++p;
+            }
+
+            if (value > numeric_limits<int>::max())
+                overflow = true;
+            result = value;
+            return p != start;
+        }
+    };
+
+    // c(\s.*)?, where . matches anything except a newline or a carriage return
+    auto is_comment(string_view line) -> bool
+    {
+        if (line.empty() || 'c' != line[0])
+            return false;
+        if (1 == line.size())
+            return true;
+        return is_space(line[1]) && string_view::npos == line.find('\r', 2);
+    }
+
+    // p\s+(edge|col)\s+(\d+)\s+(\d+)?\s*
+    auto is_problem(string_view line, int & size, int & edges, bool & overflow) -> bool
+    {
+        LineScanner s{ line.data(), line.data() + line.size() };
+        if (! (s.literal('p') && s.spaces() && (s.literal("edge") || s.literal("col")) && s.spaces() && s.number(size) && s.spaces()))
+            return false;
+        // the edge count is only a hint, so we don't mind if it's silly
+        overflow = s.overflow;
+        if (s.number(edges))
+            s.spaces();
+        if (s.overflow != overflow)
+            edges = 0;
+        return s.at_end();
+    }
+
+    // e\s+(\d+)\s+(\d+)\s*
+    auto is_edge(string_view line, int & a, int & b, bool & overflow) -> bool
+    {
+        LineScanner s{ line.data(), line.data() + line.size() };
+        if (! (s.literal('e') && s.spaces() && s.number(a) && s.spaces() && s.number(b)))
+            return false;
+        s.spaces();
+        overflow = s.overflow;
+        return s.at_end();
+    }
+}
+
+auto read_dimacs(const MappedFile & file, const string & filename) -> InputGraph
+{
+    auto contents = file.contents();
+
     InputGraph result{ 0, false, false };
+    vector<pair<int, int> > edges;
+
+    for (string_view::size_type line_start = 0 ; line_start < contents.size() ; ) {
+        auto line_end = contents.find('\n', line_start);
+        if (string_view::npos == line_end)
+            line_end = contents.size();
+        string_view line = contents.substr(line_start, line_end - line_start);
+        line_start = line_end + 1;
 
-    string line;
-    while (getline(infile, line)) {
         if (line.empty())
             continue;
 
         /* Lines are comments, a problem description (contains the number of
-         * vertices), or an edge. */
-        static const regex
-            comment{ R"(c(\s.*)?)" },
-            problem{ R"(p\s+(edge|col)\s+(\d+)\s+(\d+)?\s*)" },
-            edge{ R"(e\s+(\d+)\s+(\d+)\s*)" };
-
-        smatch match;
-        if (regex_match(line, match, comment)) {
+         * vertices), or an edge. We test for edges first, because almost
+         * every line is one. */
+        int a, b;
+        bool overflow = false;
+        if (is_edge(line, a, b, overflow)) {
+            /* An edge. DIMACS files are 1-indexed. We assume we've already had
+             * a problem line (if not our size will be 0, so we'll throw). */
+            if (overflow)
+                throw out_of_range{ "stoi" };
+            if (0 == a || 0 == b || a > result.size() || b > result.size())
+                throw GraphFileError{ filename, "line '" + string{ line } + "' edge index out of bounds", true };
+            edges.emplace_back(a - 1, b - 1);
+        }
+        else if (is_comment(line)) {
             /* Comment, ignore */
         }
-        else if (regex_match(line, match, problem)) {
+        else if (is_problem(line, a, b, overflow)) {
             /* Problem. Specifies the size of the graph. Must happen exactly
              * once. */
             if (0 != result.size())
                 throw GraphFileError{ filename, "multiple 'p' lines encountered", true };
-            result.resize(stoi(match.str(2)));
-        }
-        else if (regex_match(line, match, edge)) {
-            /* An edge. DIMACS files are 1-indexed. We assume we've already had
-             * a problem line (if not our size will be 0, so we'll throw). */
-            int a{ stoi(match.str(1)) }, b{ stoi(match.str(2)) };
-            if (0 == a || 0 == b || a > result.size() || b > result.size())
-                throw GraphFileError{ filename, "line '" + line + "' edge index out of bounds", true };
-            result.add_edge(a - 1, b - 1);
+            if (overflow)
+                throw out_of_range{ "stoi" };
+            result.resize(a);
+
+            // every edge line is at least six characters long, so don't
+            // trust a silly edge count
+            edges.reserve(min<size_t>(max(b, 0), contents.size() / 6));
         }
         else
-            throw GraphFileError{ filename, "cannot parse line '" + line + "'", true };
+            throw GraphFileError{ filename, "cannot parse line '" + string{ line } + "'", true };
     }
 
-    if (! infile.eof())
-        throw GraphFileError{ filename, "error reading file", true };
+    result.add_edges(move(edges));
 
     for (int v = 0 ; v < result.size() ; ++v)
         result.set_vertex_name(v, to_string(v + 1));
 
     return result;
 }
-
@@ -5,15 +5,16 @@
 
 #include "formats/input_graph.hh"
 #include "formats/graph_file_error.hh"
+#include "formats/mapped_file.hh"
 
-#include <iosfwd>
 #include <string>
 
 /**
- * Read a DIMACS format file into an InputGraph.
+ * Read a DIMACS format file into an InputGraph. The file is scanned directly
+ * in memory, rather than being read line by line.
  *
  * \throw GraphFileError
  */
-auto read_dimacs(std::ifstream && infile, const std::string & filename) -> InputGraph;
+auto read_dimacs(const MappedFile & file, const std::string & filename) -> InputGraph;
 
 #endif
@@ -0,0 +1,366 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#include "formats/graph_cache.hh"
+#include "formats/mapped_file.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <utility>
+#include <vector>
+
+using std::ios;
+using std::max;
+using std::memcmp;
+using std::memcpy;
+using std::move;
+using std::numeric_limits;
+using std::ofstream;
+using std::string;
+using std::string_view;
+using std::to_string;
+using std::uint32_t;
+using std::uint64_t;
+using std::vector;
+
+/*
+ * The file is a CacheHeader, followed by these sections, each starting on
+ * an eight byte boundary:
+ *
+ *   offsets         (size + 1) uint64s, as InputGraph::neighbours()
+ *   targets         edges uint32s
+ *   order           size uint32s, as InputGraph::degree_order()
+ *   matrix          size * ((size + 63) / 64) uint64s, if has_matrix
+ *   names           names_bytes, a uint32 length and then the bytes of
+ *                   each vertex's name in turn
+ *   vertex labels   vertex_labels_bytes, the same, if has_vertex_labels
+ *   edge labels     edge_labels_bytes, the same for each edge, in the
+ *                   same order as targets, if has_edge_labels
+ *
+ * Everything is in the writer's byte order, which we check when reading.
+ */
+
+namespace
+{
+    const char magic[8] = { 'G', 'C', 'S', 'C', 'A', 'C', 'H', 'E' };
+    const uint32_t version = 1;
+    const uint32_t byte_order_mark = 0x01020304;
+
+    enum CacheFlags : uint32_t
+    {
+        directed = 1,
+        has_matrix = 2,
+        has_vertex_labels = 4,
+        has_edge_labels = 8
+    };
+
+    struct CacheHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint32_t flags;
+        uint32_t reserved;
+        uint64_t size;
+        uint64_t edges;
+        uint64_t names_bytes;
+        uint64_t vertex_labels_bytes;
+        uint64_t edge_labels_bytes;
+        uint64_t file_size;
+    };
+
+    static_assert(sizeof(CacheHeader) == 72, "CacheHeader must have no padding");
+
+    auto round_up(uint64_t n) -> uint64_t
+    {
+        return (n + 7) / 8 * 8;
+    }
+
+    auto row_words(uint64_t size) -> uint64_t
+    {
+        return (size + 63) / 64;
+    }
+
+    // the same test as InputGraph uses for whether to have a matrix
+    auto want_matrix(uint64_t size, uint64_t edges) -> bool
+    {
+        return size * row_words(size) <= max<uint64_t>(edges, 1 << 20);
+    }
+
+    struct StringTable
+    {
+        string data;
+
+        auto add(string_view s) -> void
+        {
+            uint32_t len = s.size();
+            data.append(reinterpret_cast<const char *>(&len), sizeof(len));
+            data.append(s);
+        }
+    };
+
+    // reads through the mapped file, checking as it goes
+    struct CacheReader
+    {
+        const string & filename;
+        string_view contents;
+        uint64_t pos = 0;
+
+        [[ noreturn ]] auto corrupt(const string & why) const -> void
+        {
+            throw GraphFileError{ filename, "graph cache is corrupt (" + why + ")", true };
+        }
+
+        auto section(uint64_t bytes, const char * what) -> const char *
+        {
+            pos = round_up(pos);
+            if (pos > contents.size() || bytes > contents.size() - pos)
+                corrupt(string{ what } + " runs past the end of the file");
+            auto result = contents.data() + pos;
+            pos += bytes;
+            return result;
+        }
+
+        template <typename T_>
+        auto array(uint64_t count, const char * what) -> const char *
+        {
+            if (count > contents.size() / sizeof(T_))
+                corrupt(string{ what } + " is too big");
+            return section(count * sizeof(T_), what);
+        }
+
+        template <typename T_>
+        static auto get(const char * data, uint64_t i) -> T_
+        {
+            T_ result;
+            memcpy(&result, data + i * sizeof(T_), sizeof(T_));
+            return result;
+        }
+
+        template <typename F_>
+        auto strings(uint64_t bytes, uint64_t count, const char * what, const F_ & f) -> void
+        {
+            auto data = section(bytes, what);
+            uint64_t p = 0;
+            for (uint64_t i = 0 ; i < count ; ++i) {
+                if (bytes - p < sizeof(uint32_t))
+                    corrupt(string{ what } + " are truncated");
+                auto len = get<uint32_t>(data + p, 0);
+                p += sizeof(uint32_t);
+                if (bytes - p < len)
+                    corrupt(string{ what } + " are truncated");
+                f(i, string_view{ data + p, len });
+                p += len;
+            }
+
+            if (p != bytes)
+                corrupt(string{ what } + " have trailing data");
+        }
+    };
+}
+
+auto write_graph_cache(const InputGraph & graph, const string & filename) -> void
+{
+    uint64_t size = graph.size();
+
+    vector<uint64_t> offsets{ 0 };
+    vector<uint32_t> targets;
+    for (int v = 0 ; v < graph.size() ; ++v) {
+        auto [ begin, end ] = graph.neighbours(v);
+        targets.insert(targets.end(), begin, end);
+        offsets.push_back(targets.size());
+    }
+
+    auto order = graph.degree_order();
+    vector<uint32_t> order_words(order.begin(), order.end());
+
+    vector<uint64_t> matrix;
+    if (want_matrix(size, targets.size())) {
+        vector<int> invorder(size);
+        for (unsigned i = 0 ; i < order.size() ; ++i)
+            invorder[order[i]] = i;
+
+        auto words = row_words(size);
+        matrix.resize(size * words);
+        for (int v = 0 ; v < graph.size() ; ++v) {
+            auto [ begin, end ] = graph.neighbours(v);
+            for (auto t = begin ; t != end ; ++t)
+                matrix[invorder[v] * words + invorder[*t] / 64] |= uint64_t{ 1 } << (invorder[*t] % 64);
+        }
+    }
+
+    StringTable names, vertex_labels, edge_labels;
+    for (int v = 0 ; v < graph.size() ; ++v) {
+        names.add(graph.vertex_name(v));
+        if (graph.has_vertex_labels())
+            vertex_labels.add(graph.vertex_label(v));
+        if (graph.has_edge_labels()) {
+            auto [ begin, end ] = graph.neighbours(v);
+            auto labels = graph.neighbour_labels(v);
+            for (auto t = begin ; t != end ; ++t)
+                edge_labels.add(labels[t - begin]);
+        }
+    }
+
+    CacheHeader header;
+    memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.byte_order = byte_order_mark;
+    header.flags = (graph.directed() ? uint32_t{ directed } : 0u) | (matrix.empty() ? 0u : uint32_t{ has_matrix }) |
+        (graph.has_vertex_labels() ? uint32_t{ has_vertex_labels } : 0u) | (graph.has_edge_labels() ? uint32_t{ has_edge_labels } : 0u);
+    header.reserved = 0;
+    header.size = size;
+    header.edges = targets.size();
+    header.names_bytes = names.data.size();
+    header.vertex_labels_bytes = vertex_labels.data.size();
+    header.edge_labels_bytes = edge_labels.data.size();
+
+    ofstream outfile{ filename, ios::binary };
+    if (! outfile)
+        throw GraphFileError{ filename, "unable to open graph cache for writing", false };
+
+    uint64_t pos = 0;
+    auto write = [&] (const void * data, uint64_t bytes) {
+        static const char padding[8] = { };
+        outfile.write(padding, round_up(pos) - pos);
+        pos = round_up(pos);
+        outfile.write(static_cast<const char *>(data), bytes);
+        pos += bytes;
+    };
+
+    // we don't know the file size until we've written everything, so write
+    // the header again at the end
+    write(&header, sizeof(header));
+    write(offsets.data(), offsets.size() * sizeof(uint64_t));
+    write(targets.data(), targets.size() * sizeof(uint32_t));
+    write(order_words.data(), order_words.size() * sizeof(uint32_t));
+    write(matrix.data(), matrix.size() * sizeof(uint64_t));
+    write(names.data.data(), names.data.size());
+    write(vertex_labels.data.data(), vertex_labels.data.size());
+    write(edge_labels.data.data(), edge_labels.data.size());
+
+    header.file_size = pos;
+    outfile.seekp(0);
+    outfile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    if (! outfile.flush())
+        throw GraphFileError{ filename, "error writing graph cache", true };
+}
+
+auto read_graph_cache(const MappedFile & file, const string & filename) -> InputGraph
+{
+    CacheReader reader{ filename, file.contents() };
+
+    CacheHeader header;
+    memcpy(&header, reader.section(sizeof(header), "header"), sizeof(header));
+    if (0 != memcmp(header.magic, magic, sizeof(magic)))
+        throw GraphFileError{ filename, "not a graph cache", true };
+    if (byte_order_mark != header.byte_order)
+        throw GraphFileError{ filename, "graph cache was written on a machine with a different byte order", true };
+    if (version != header.version)
+        throw GraphFileError{ filename, "graph cache has version " + to_string(header.version) + ", but we need version " + to_string(version), true };
+    if (header.file_size != file.contents().size())
+        reader.corrupt("it is " + to_string(file.contents().size()) + " bytes long, not " + to_string(header.file_size));
+    if (header.size > uint64_t(numeric_limits<int>::max()) || header.edges > uint64_t(numeric_limits<int>::max()))
+        reader.corrupt("it is too big");
+
+    int size = header.size;
+    InputGraph result{ size, 0 != (header.flags & has_vertex_labels), 0 != (header.flags & has_edge_labels) };
+
+    auto offsets_data = reader.array<uint64_t>(header.size + 1, "offsets");
+    auto targets_data = reader.array<uint32_t>(header.edges, "targets");
+    auto order_data = reader.array<uint32_t>(header.size, "order");
+
+    vector<long> offsets(size + 1);
+    vector<int> targets(header.edges);
+    for (int v = 0 ; v <= size ; ++v) {
+        auto o = CacheReader::get<uint64_t>(offsets_data, v);
+        if ((0 == v && 0 != o) || (v > 0 && uint64_t(offsets[v - 1]) > o) || o > header.edges || (v == size && o != header.edges))
+            reader.corrupt("bad offsets");
+        offsets[v] = o;
+    }
+
+    for (int v = 0 ; v < size ; ++v)
+        for (long e = offsets[v] ; e < offsets[v + 1] ; ++e) {
+            auto t = CacheReader::get<uint32_t>(targets_data, e);
+            if (t >= header.size || (e > offsets[v] && uint32_t(targets[e - 1]) >= t))
+                reader.corrupt("bad targets");
+            targets[e] = t;
+        }
+
+    // the order must be a permutation, sorted by degree
+    vector<int> order(size);
+    vector<bool> seen(size, false);
+    for (int i = 0 ; i < size ; ++i) {
+        auto v = CacheReader::get<uint32_t>(order_data, i);
+        if (v >= header.size || seen[v])
+            reader.corrupt("bad order");
+        seen[v] = true;
+        order[i] = v;
+
+        if (i > 0) {
+            auto d = offsets[v + 1] - offsets[v], prev_d = offsets[order[i - 1] + 1] - offsets[order[i - 1]];
+            if (prev_d < d || (prev_d == d && order[i - 1] > int(v)))
+                reader.corrupt("order is not by degree");
+        }
+    }
+
+    vector<uint64_t> matrix;
+    if (header.flags & has_matrix) {
+        auto words = row_words(header.size);
+        if (header.size > 0 && words > numeric_limits<uint64_t>::max() / header.size)
+            reader.corrupt("matrix is too big");
+        auto matrix_data = reader.array<uint64_t>(header.size * words, "matrix");
+        matrix.resize(header.size * words);
+        memcpy(matrix.data(), matrix_data, matrix.size() * sizeof(uint64_t));
+
+        // the search trusts the matrix, so check that each row has exactly
+        // the bits for its vertex's list set
+        vector<int> invorder(size);
+        for (int i = 0 ; i < size ; ++i)
+            invorder[order[i]] = i;
+        for (int i = 0 ; i < size ; ++i) {
+            long count = 0;
+            for (uint64_t w = 0 ; w < words ; ++w)
+                count += __builtin_popcountll(matrix[i * words + w]);
+            if (count != offsets[order[i] + 1] - offsets[order[i]])
+                reader.corrupt("matrix does not match the adjacency lists");
+            for (long e = offsets[order[i]] ; e < offsets[order[i] + 1] ; ++e)
+                if (! (matrix[i * words + invorder[targets[e]] / 64] & (uint64_t{ 1 } << (invorder[targets[e]] % 64))))
+                    reader.corrupt("matrix does not match the adjacency lists");
+        }
+    }
+
+    reader.strings(header.names_bytes, header.size, "names", [&] (uint64_t v, string_view name) {
+            result.set_vertex_name(v, name);
+            });
+
+    if (header.flags & has_vertex_labels)
+        reader.strings(header.vertex_labels_bytes, header.size, "vertex labels", [&] (uint64_t v, string_view label) {
+                result.set_vertex_label(v, label);
+                });
+    else if (0 != header.vertex_labels_bytes)
+        reader.corrupt("unexpected vertex labels");
+
+    vector<string> labels;
+    if (header.flags & has_edge_labels) {
+        labels.reserve(header.edges);
+        reader.strings(header.edge_labels_bytes, header.edges, "edge labels", [&] (uint64_t, string_view label) {
+                labels.emplace_back(label);
+                });
+    }
+    else if (0 != header.edge_labels_bytes)
+        reader.corrupt("unexpected edge labels");
+
+    result.assign_adjacency_lists(move(offsets), move(targets), move(labels), header.flags & directed);
+    result.set_degree_order(move(order), move(matrix));
+
+    return result;
+}
+
+auto looks_like_graph_cache(string_view start) -> bool
+{
+    return start.size() >= sizeof(magic) && 0 == memcmp(start.data(), magic, sizeof(magic));
+}
@@ -0,0 +1,36 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#ifndef GLASGOW_SUBGRAPH_SOLVER_SOLVER_FORMATS_GRAPH_CACHE_HH
+#define GLASGOW_SUBGRAPH_SOLVER_SOLVER_FORMATS_GRAPH_CACHE_HH 1
+
+#include "formats/input_graph.hh"
+#include "formats/graph_file_error.hh"
+#include "formats/mapped_file.hh"
+
+#include <string>
+#include <string_view>
+
+/**
+ * Write a graph to a binary cache file (conventionally suffixed .gcs),
+ * which read_graph_cache() can load far more quickly than the original
+ * file can be parsed. As well as the adjacency lists, names and labels,
+ * this holds the degree order that the clique search uses, and if it
+ * isn't too big, the adjacency matrix permuted into that order.
+ *
+ * \throw GraphFileError
+ */
+auto write_graph_cache(const InputGraph & graph, const std::string & filename) -> void;
+
+/**
+ * Read a graph cache. The file is checked before it is used.
+ *
+ * \throw GraphFileError
+ */
+auto read_graph_cache(const MappedFile & file, const std::string & filename) -> InputGraph;
+
+/**
+ * Does a file starting with this have a graph cache's magic number?
+ */
+auto looks_like_graph_cache(std::string_view start) -> bool;
+
+#endif
@@ -10,31 +10,30 @@
 #include <string>
 #include <type_traits>
 #include <vector>
-#include <map>
 #include <iterator>
 
 #include <boost/bimap.hpp>
 #include <boost/bimap/unordered_set_of.hpp>
 
 using std::back_inserter;
+using std::binary_search;
 using std::count_if;
-using std::distance;
-using std::find;
-using std::function;
 using std::isgraph;
-using std::numeric_limits;
+using std::lower_bound;
+using std::make_move_iterator;
 using std::make_optional;
 using std::make_pair;
-using std::map;
 using std::max;
 using std::move;
 using std::nullopt;
 using std::optional;
 using std::pair;
+using std::sort;
 using std::string;
 using std::string_view;
 using std::to_string;
 using std::transform;
+using std::unique;
 using std::vector;
 
 using Names = boost::bimaps::bimap<boost::bimaps::unordered_set_of<int>, boost::bimaps::unordered_set_of<string> >;
@@ -55,12 +54,126 @@ struct InputGraph::Imp
 {
     int size = 0;
     bool has_vertex_labels, has_edge_labels;
-    map<pair<int, int>, string> edges;
     vector<string> vertex_labels;
     Names vertex_names;
     bool loopy = false, directed = false;
+
+    // edges added since we last compacted, and if we have edge labels,
+    // their labels and whether they replace the label of an existing edge
+    vector<pair<int, int> > pending;
+    vector<string> pending_labels;
+    vector<bool> pending_replaces;
+    bool compacted = false;
+
+    // sorted adjacency lists: vertex v's neighbours are targets[offsets[v]]
+    // to targets[offsets[v + 1]], and labels is in the same order
+    vector<long> offsets{ 0 };
+    vector<int> targets;
+    vector<string> labels;
+
+    // an adjacency matrix, if it isn't much bigger than the lists
+    vector<uint64_t> matrix;
+    long matrix_row_words = 0;
+
+    // from a cache: the order we'd sort into, and the matrix in that order
+    vector<int> cached_degree_order;
+    vector<uint64_t> degree_ordered_matrix;
+
+    auto add(int a, int b, string_view label, bool replace) -> void
+    {
+        pending.emplace_back(a, b);
+        if (has_edge_labels) {
+            pending_labels.emplace_back(label);
+            pending_replaces.push_back(replace);
+        }
+        compacted = false;
+        cached_degree_order.clear();
+        degree_ordered_matrix.clear();
+    }
+
+    auto compact() -> void;
+    auto build_matrix() -> void;
 };
 
+auto InputGraph::Imp::compact() -> void
+{
+    // start with what we already have, which comes first, so that later
+    // edges can replace its labels
+    vector<pair<int, int> > edges;
+    vector<string> edge_labels;
+    vector<bool> edge_replaces;
+    edges.reserve(targets.size() + pending.size());
+    for (long v = 0 ; v + 1 < long(offsets.size()) ; ++v)
+        for (long e = offsets[v] ; e < offsets[v + 1] ; ++e)
+            edges.emplace_back(v, targets[e]);
+    edges.insert(edges.end(), pending.begin(), pending.end());
+
+    if (has_edge_labels) {
+        edge_labels = move(labels);
+        edge_labels.insert(edge_labels.end(), make_move_iterator(pending_labels.begin()), make_move_iterator(pending_labels.end()));
+        edge_replaces.resize(targets.size(), false);
+        edge_replaces.insert(edge_replaces.end(), pending_replaces.begin(), pending_replaces.end());
+    }
+
+    pending = vector<pair<int, int> >{ };
+    pending_labels.clear();
+    pending_replaces.clear();
+    targets.clear();
+    labels.clear();
+
+    offsets.assign(size + 1, 0);
+
+    if (! has_edge_labels) {
+        sort(edges.begin(), edges.end());
+        edges.erase(unique(edges.begin(), edges.end()), edges.end());
+        targets.reserve(edges.size());
+        for (auto & [ a, b ] : edges) {
+            ++offsets[a + 1];
+            targets.push_back(b);
+        }
+    }
+    else {
+        // sort by edge, and then by the order they were added, so that for
+        // each edge we can work out which label it ends up with
+        vector<long> order(edges.size());
+        for (long i = 0 ; i < long(order.size()) ; ++i)
+            order[i] = i;
+        sort(order.begin(), order.end(), [&] (long x, long y) { return make_pair(edges[x], x) < make_pair(edges[y], y); });
+
+        for (long i = 0 ; i < long(order.size()) ; ) {
+            auto edge = edges[order[i]];
+            auto label = order[i];
+            for (++i ; i < long(order.size()) && edges[order[i]] == edge ; ++i)
+                if (edge_replaces[order[i]])
+                    label = order[i];
+
+            ++offsets[edge.first + 1];
+            targets.push_back(edge.second);
+            labels.push_back(move(edge_labels[label]));
+        }
+    }
+
+    for (int v = 0 ; v < size ; ++v)
+        offsets[v + 1] += offsets[v];
+
+    build_matrix();
+    compacted = true;
+}
+
+auto InputGraph::Imp::build_matrix() -> void
+{
+    // an adjacency matrix is fast, but quadratic in size, so we only want
+    // one if it's no bigger than the lists, or is small anyway
+    matrix.clear();
+    matrix_row_words = (size + 63) / 64;
+    if (long(size) * matrix_row_words <= max<long>(targets.size(), 1 << 20)) {
+        matrix.assign(size * matrix_row_words, 0);
+        for (int v = 0 ; v < size ; ++v)
+            for (long e = offsets[v] ; e < offsets[v + 1] ; ++e)
+                matrix[v * matrix_row_words + targets[e] / 64] |= uint64_t{ 1 } << (targets[e] % 64);
+    }
+}
+
 InputGraph::InputGraph(int size, bool v, bool e) :
     _imp(new Imp{ })
 {
@@ -81,30 +194,66 @@ auto InputGraph::resize(int size) -> void
 {
     _imp->size = size;
     _imp->vertex_labels.resize(size);
+    _imp->compacted = false;
+    _imp->cached_degree_order.clear();
+    _imp->degree_ordered_matrix.clear();
 }
 
 auto InputGraph::add_edge(int a, int b) -> void
 {
-    _imp->edges.emplace(make_pair(a, b), "");
-    _imp->edges.emplace(make_pair(b, a), "");
+    _imp->add(a, b, "", false);
+    _imp->add(b, a, "", false);
     if (a == b)
         _imp->loopy = true;
 }
 
+auto InputGraph::add_edges(vector<pair<int, int> > && edges) -> void
+{
+    if (_imp->has_edge_labels) {
+        for (auto & [ a, b ] : edges)
+            add_edge(a, b);
+        return;
+    }
+
+    auto n = edges.size();
+    edges.reserve(2 * n);
+    for (decltype(n) i = 0 ; i < n ; ++i) {
+        auto [ a, b ] = edges[i];
+        edges.emplace_back(b, a);
+        if (a == b)
+            _imp->loopy = true;
+    }
+
+    if (_imp->pending.empty())
+        _imp->pending = move(edges);
+    else
+        _imp->pending.insert(_imp->pending.end(), edges.begin(), edges.end());
+    _imp->compacted = false;
+    _imp->cached_degree_order.clear();
+    _imp->degree_ordered_matrix.clear();
+}
+
 auto InputGraph::add_directed_edge(int a, int b, string_view label) -> void
 {
     sanity_check_name(label, "edge label");
 
     _imp->directed = true;
 
-    _imp->edges.emplace(make_pair(a, b), label).first->second = label;
+    _imp->add(a, b, label, true);
     if (a == b)
         _imp->loopy = true;
 }
 
 auto InputGraph::adjacent(int a, int b) const -> bool
 {
-    return _imp->edges.count({ a, b });
+    if (! _imp->compacted)
+        _imp->compact();
+
+    if (! _imp->matrix.empty())
+        return _imp->matrix[a * _imp->matrix_row_words + b / 64] & (uint64_t{ 1 } << (b % 64));
+
+    auto [ begin, end ] = neighbours(a);
+    return binary_search(begin, end, b);
 }
 
 auto InputGraph::size() const -> int
@@ -114,7 +263,10 @@ auto InputGraph::size() const -> int
 
 auto InputGraph::number_of_directed_edges() const -> int
 {
-    return _imp->edges.size();
+    if (! _imp->compacted)
+        _imp->compact();
+
+    return _imp->targets.size();
 }
 
 auto InputGraph::loopy() const -> bool
@@ -124,9 +276,10 @@ auto InputGraph::loopy() const -> bool
 
 auto InputGraph::degree(int a) const -> int
 {
-    auto lower = _imp->edges.lower_bound({ a, 0 });
-    auto upper = _imp->edges.upper_bound({ a, numeric_limits<int>::max() });
-    return distance(lower, upper);
+    if (! _imp->compacted)
+        _imp->compact();
+
+    return _imp->offsets[a + 1] - _imp->offsets[a];
 }
 
 auto InputGraph::set_vertex_label(int v, string_view l) -> void
@@ -167,7 +320,15 @@ auto InputGraph::vertex_from_name(string_view n) const -> optional<int>
 
 auto InputGraph::edge_label(int a, int b) const -> string_view
 {
-    return _imp->edges.find({a, b})->second;
+    auto labels = neighbour_labels(a);
+    if (! labels)
+        return "";
+
+    auto [ begin, end ] = neighbours(a);
+    auto it = lower_bound(begin, end, b);
+    if (it == end || *it != b)
+        return "";
+    return labels[it - begin];
 }
 
 auto InputGraph::has_vertex_labels() const -> bool
@@ -185,9 +346,81 @@ auto InputGraph::directed() const -> bool
     return _imp->directed;
 }
 
-auto InputGraph::for_each_edge(const function<auto (int, int, std::string_view) -> void> & c) const -> void
+auto InputGraph::compact() const -> void
+{
+    if (! _imp->compacted)
+        _imp->compact();
+}
+
+auto InputGraph::assign_adjacency_lists(vector<long> && offsets, vector<int> && targets,
+        vector<string> && labels, bool directed) -> void
+{
+    _imp->pending.clear();
+    _imp->pending_labels.clear();
+    _imp->pending_replaces.clear();
+    _imp->offsets = move(offsets);
+    _imp->targets = move(targets);
+    _imp->labels = move(labels);
+    _imp->directed = directed;
+    _imp->compacted = true;
+    _imp->build_matrix();
+
+    _imp->loopy = false;
+    for (int v = 0 ; v < _imp->size && ! _imp->loopy ; ++v)
+        if (adjacent(v, v))
+            _imp->loopy = true;
+
+    _imp->cached_degree_order.clear();
+    _imp->degree_ordered_matrix.clear();
+}
+
+auto InputGraph::degree_order() const -> vector<int>
+{
+    if (! _imp->cached_degree_order.empty())
+        return _imp->cached_degree_order;
+
+    vector<int> result(size());
+    for (int v = 0 ; v < size() ; ++v)
+        result[v] = v;
+
+    vector<int> degrees(size());
+    for (int v = 0 ; v < size() ; ++v)
+        degrees[v] = degree(v);
+
+    sort(result.begin(), result.end(),
+            [&] (int a, int b) { return (degrees[a] > degrees[b] || (degrees[a] == degrees[b] && a < b)); });
+
+    return result;
+}
+
+auto InputGraph::set_degree_order(vector<int> && order, vector<uint64_t> && matrix) -> void
+{
+    _imp->cached_degree_order = move(order);
+    _imp->degree_ordered_matrix = move(matrix);
+}
+
+auto InputGraph::degree_ordered_matrix() const -> const uint64_t *
+{
+    return _imp->degree_ordered_matrix.empty() ? nullptr : _imp->degree_ordered_matrix.data();
+}
+
+auto InputGraph::neighbours(int a) const -> pair<const int *, const int *>
+{
+    if (! _imp->compacted)
+        _imp->compact();
+
+    const int * targets = _imp->targets.data();
+    return { targets + _imp->offsets[a], targets + _imp->offsets[a + 1] };
+}
+
+auto InputGraph::neighbour_labels(int a) const -> const string *
 {
-    for (auto & [ e, l ] : _imp->edges)
-        c(e.first, e.second, l);
+    if (! _imp->has_edge_labels)
+        return nullptr;
+
+    if (! _imp->compacted)
+        _imp->compact();
+
+    return _imp->labels.data() + _imp->offsets[a];
 }
 
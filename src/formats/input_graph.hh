@@ -3,16 +3,21 @@
 #ifndef GLASGOW_SUBGRAPH_SOLVER_SOLVER_FORMATS_INPUT_GRAPH_HH
 #define GLASGOW_SUBGRAPH_SOLVER_SOLVER_FORMATS_INPUT_GRAPH_HH 1
 
-#include <functional>
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 /**
- * A graph, in a convenient format for reading in from files. We don't do any
- * performance critical operations on this: the algorithms re-encode as
- * necessary.
+ * A graph, in a convenient format for reading in from files. The algorithms
+ * re-encode as necessary, but large graphs are still queried a lot while
+ * being set up, so once loading finishes (when compact() is called, or the
+ * first time anything other than the size or labels is asked for) the edges
+ * are stored as sorted adjacency lists, plus an adjacency matrix if it isn't
+ * too big. Edge labels are only kept if has_edge_labels.
  *
  * Indices start at 0.
  */
@@ -59,6 +64,12 @@ class InputGraph
          */
         auto add_edge(int a, int b) -> void;
 
+        /**
+         * Add each of these edges, as if by add_edge(), but much more
+         * quickly when there are lots of them.
+         */
+        auto add_edges(std::vector<std::pair<int, int> > && edges) -> void;
+
         /**
          * Add a directed edge from a to b, with a label.
          */
@@ -110,7 +121,64 @@ class InputGraph
 
         auto directed() const -> bool;
 
-        auto for_each_edge(const std::function<auto (int, int, std::string_view) -> void> &) const -> void;
+        /**
+         * Switch to the compact representation now, rather than the first
+         * time it's needed. Done once a file has been read.
+         */
+        auto compact() const -> void;
+
+        /**
+         * Replace every edge with these adjacency lists, which are in the
+         * same form as neighbours() and neighbour_labels(), and so must be
+         * sorted and without duplicates. Used when loading a cache.
+         */
+        auto assign_adjacency_lists(std::vector<long> && offsets, std::vector<int> && targets,
+                std::vector<std::string> && labels, bool directed) -> void;
+
+        /**
+         * The vertices sorted by degree, largest first, breaking ties by
+         * index. This is the order the clique search uses.
+         */
+        auto degree_order() const -> std::vector<int>;
+
+        /**
+         * Remember what degree_order() returns, and optionally (if matrix
+         * isn't empty) the adjacency matrix permuted into that order, with
+         * (size() + 63) / 64 words per row. Used when loading a cache, and
+         * forgotten if any edges are added.
+         */
+        auto set_degree_order(std::vector<int> && order, std::vector<std::uint64_t> && matrix) -> void;
+
+        /**
+         * The adjacency matrix given to set_degree_order(), or null.
+         */
+        auto degree_ordered_matrix() const -> const std::uint64_t *;
+
+        /**
+         * The vertices adjacent to a, in increasing order, as a range that
+         * remains valid until another edge is added.
+         */
+        auto neighbours(int a) const -> std::pair<const int *, const int *>;
+
+        /**
+         * The labels of the edges from a, in the same order as neighbours(a),
+         * or null if we don't have edge labels.
+         */
+        auto neighbour_labels(int a) const -> const std::string *;
+
+        /**
+         * Call c(from, to, label) for every (directed) edge, in order.
+         */
+        template <typename Callback_>
+        auto for_each_edge(const Callback_ & c) const -> void
+        {
+            for (int a = 0, a_end = size() ; a < a_end ; ++a) {
+                auto [ begin, end ] = neighbours(a);
+                auto labels = neighbour_labels(a);
+                for (auto b = begin ; b != end ; ++b)
+                    c(a, *b, labels ? std::string_view{ labels[b - begin] } : std::string_view{ });
+            }
+        }
 };
 
 #endif
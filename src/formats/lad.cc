@@ -2,62 +2,184 @@
 
 #include "formats/lad.hh"
 #include "formats/input_graph.hh"
+#include "formats/mapped_file.hh"
+#include "formats/parallel_parse.hh"
 
-#include <fstream>
-#include <map>
+#include <limits>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
-using std::ifstream;
-using std::map;
+using std::move;
+using std::numeric_limits;
 using std::pair;
+using std::size_t;
 using std::string;
+using std::string_view;
 using std::stoi;
 using std::to_string;
+using std::vector;
 
 namespace
 {
-    auto read_word(ifstream & infile) -> int
+    // the same as what operator>> treats as whitespace
+    auto is_space(char c) -> bool
     {
-        int x;
-        infile >> x;
-        return x;
+        return ' ' == c || '\t' == c || '\n' == c || '\v' == c || '\f' == c || '\r' == c;
     }
 
-    auto read_any_lad(ifstream && infile, const string & filename,
+    // the whitespace separated words from part of the file, turned into
+    // numbers wherever they look like one
+    struct LadChunk
+    {
+        // one per word, with 0 for words that aren't numbers
+        vector<int> numbers;
+
+        // the words that aren't numbers, and where they are in numbers
+        vector<pair<size_t, string_view> > words;
+    };
+
+    auto tokenise(string_view text, LadChunk & chunk) -> void
+    {
+        chunk.numbers.reserve(text.size() / 8);
+
+        const char * p = text.data(), * end = text.data() + text.size();
+        while (true) {
+            while (p != end && is_space(*p))
+                ++p;
+            if (p == end)
+                break;
+
+            const char * start = p;
+            bool negative = false;
+            if ('+' == *p || '-' == *p)
+                negative = ('-' == *p++);
+
+            long long value = 0;
+            const char * digits = p;
+            while (p != end && *p >= '0' && *p <= '9') {
+                if (value <= numeric_limits<int>::max())
+                    value = value * 10 + (*p - '0');
+                ++p;
+            }
+
+            bool is_number = (p != digits) && (p == end || is_space(*p));
+            if (negative)
+                value = -value;
+            if (value < numeric_limits<int>::min() || value > numeric_limits<int>::max())
+                is_number = false;
+
+            if (is_number)
+                chunk.numbers.push_back(int(value));
+            else {
+                while (p != end && ! is_space(*p))
+                    ++p;
+                chunk.words.emplace_back(chunk.numbers.size(), string_view{ start, size_t(p - start) });
+                chunk.numbers.push_back(0);
+            }
+        }
+    }
+
+    // reads back through the words from every chunk in turn
+    class LadTokens
+    {
+        private:
+            const vector<LadChunk> & _chunks;
+            size_t _chunk = 0, _number = 0, _word = 0;
+
+            auto _skip_finished_chunks() -> bool
+            {
+                while (_chunk < _chunks.size() && _number == _chunks[_chunk].numbers.size()) {
+                    ++_chunk;
+                    _number = 0;
+                    _word = 0;
+                }
+                return _chunk < _chunks.size();
+            }
+
+            auto _at_word() const -> bool
+            {
+                auto & words = _chunks[_chunk].words;
+                return _word < words.size() && words[_word].first == _number;
+            }
+
+        public:
+            explicit LadTokens(const vector<LadChunk> & chunks) :
+                _chunks(chunks)
+            {
+            }
+
+            /// Read a number, returning false if we're at the end or if the
+            /// next word isn't a number
+            auto next_number(int & result) -> bool
+            {
+                if ((! _skip_finished_chunks()) || _at_word())
+                    return false;
+                result = _chunks[_chunk].numbers[_number++];
+                return true;
+            }
+
+            /// Read any word, returning false if we're at the end
+            auto next_word(string & result) -> bool
+            {
+                if (! _skip_finished_chunks())
+                    return false;
+                if (_at_word())
+                    result = _chunks[_chunk].words[_word++].second;
+                else
+                    result = to_string(_chunks[_chunk].numbers[_number]);
+                ++_number;
+                return true;
+            }
+    };
+
+    auto read_any_lad(const MappedFile & file, const string & filename,
             bool directed,
             bool vertex_labels,
             bool edge_labels) -> InputGraph
     {
+        // turning text into numbers is the slow part, so we do that in
+        // parallel for big files, and then go through the structure in order
+        auto pieces = split_at_lines(file.contents(), parse_chunk_count(file.contents().size()));
+        vector<LadChunk> chunks(pieces.size());
+        parse_in_parallel(pieces.size(), [&] (unsigned c) { tokenise(pieces[c], chunks[c]); });
+        LadTokens tokens{ chunks };
+
         InputGraph result{ 0, vertex_labels, edge_labels };
+        vector<pair<int, int> > undirected_edges;
 
-        result.resize(read_word(infile));
-        if (! infile)
+        int size;
+        if (! tokens.next_number(size))
             throw GraphFileError{ filename, "error reading size", true };
+        result.resize(size);
 
         for (int r = 0 ; r < result.size() ; ++r) {
             result.set_vertex_name(r, to_string(r));
 
             if (vertex_labels) {
-                int l = read_word(infile);
-                if (! infile)
+                int l;
+                if (! tokens.next_number(l))
                     throw GraphFileError{ filename, "error reading label", true };
 
                 result.set_vertex_label(r, to_string(l));
             }
 
-            int c_end = read_word(infile);
-            if (! infile)
+            int c_end;
+            if (! tokens.next_number(c_end))
                 throw GraphFileError{ filename, "error reading edges count", true };
 
             for (int c = 0 ; c < c_end ; ++c) {
-                int e = read_word(infile);
+                int e;
+                if (! tokens.next_number(e))
+                    throw GraphFileError{ filename, "error reading edge", true };
 
                 if (e < 0 || e >= result.size())
                     throw GraphFileError{ filename, "edge index out of bounds", true };
 
                 if (edge_labels) {
-                    int l = read_word(infile);
-                    if (l < 0)
+                    int l;
+                    if ((! tokens.next_number(l)) || l < 0)
                         throw GraphFileError{ filename, "edge label invalid", true };
 
                     result.add_directed_edge(r, e, to_string(l));
@@ -65,12 +187,14 @@ namespace
                 else if (directed)
                     result.add_directed_edge(r, e, "");
                 else
-                    result.add_edge(r, e);
+                    undirected_edges.emplace_back(r, e);
             }
         }
 
+        result.add_edges(move(undirected_edges));
+
         string rest;
-        while (infile >> rest) {
+        while (tokens.next_word(rest)) {
             auto equals_pos = rest.find('=');
             if (string::npos == equals_pos)
                 throw GraphFileError{ filename, "EOF not reached, next text is \"" + rest + "\"", true };
@@ -79,30 +203,27 @@ namespace
                 result.set_vertex_name(stoi(before), after);
             }
         }
-        if (! infile.eof())
-            throw GraphFileError{ filename, "EOF not reached", true };
 
         return result;
     }
 }
 
-auto read_lad(ifstream && infile, const string & filename) -> InputGraph
+auto read_lad(const MappedFile & file, const string & filename) -> InputGraph
 {
-    return read_any_lad(move(infile), filename, false, false, false);
+    return read_any_lad(file, filename, false, false, false);
 }
 
-auto read_directed_lad(ifstream && infile, const string & filename) -> InputGraph
+auto read_directed_lad(const MappedFile & file, const string & filename) -> InputGraph
 {
-    return read_any_lad(move(infile), filename, true, false, false);
+    return read_any_lad(file, filename, true, false, false);
 }
 
-auto read_labelled_lad(ifstream && infile, const string & filename) -> InputGraph
+auto read_labelled_lad(const MappedFile & file, const string & filename) -> InputGraph
 {
-    return read_any_lad(move(infile), filename, true, true, true);
+    return read_any_lad(file, filename, true, true, true);
 }
 
-auto read_vertex_labelled_lad(ifstream && infile, const string & filename) -> InputGraph
+auto read_vertex_labelled_lad(const MappedFile & file, const string & filename) -> InputGraph
 {
-    return read_any_lad(move(infile), filename, false, true, false);
+    return read_any_lad(file, filename, false, true, false);
 }
-
@@ -5,36 +5,37 @@
 
 #include "formats/input_graph.hh"
 #include "formats/graph_file_error.hh"
+#include "formats/mapped_file.hh"
 
-#include <iosfwd>
 #include <string>
 
 /**
- * Read a LAD format file into an InputGraph.
+ * Read a LAD format file into an InputGraph. Big files are split into
+ * pieces which are parsed in parallel.
  *
  * \throw GraphFileError
  */
-auto read_lad(std::ifstream && infile, const std::string & filename) -> InputGraph;
+auto read_lad(const MappedFile & file, const std::string & filename) -> InputGraph;
 
 /**
  * Read a LAD format file into an InputGraph, treating edges as directed.
  *
  * \throw GraphFileError
  */
-auto read_directed_lad(std::ifstream && infile, const std::string & filename) -> InputGraph;
+auto read_directed_lad(const MappedFile & file, const std::string & filename) -> InputGraph;
 
 /**
  * Read a Labelled LAD format file into an InputGraph.
  *
  * \throw GraphFileError
  */
-auto read_labelled_lad(std::ifstream && infile, const std::string & filename) -> InputGraph;
+auto read_labelled_lad(const MappedFile & file, const std::string & filename) -> InputGraph;
 
 /**
  * Read a Vertex-Labelled LAD format file into an InputGraph.
  *
  * \throw GraphFileError
  */
-auto read_vertex_labelled_lad(std::ifstream && infile, const std::string & filename) -> InputGraph;
+auto read_vertex_labelled_lad(const MappedFile & file, const std::string & filename) -> InputGraph;
 
 #endif
@@ -0,0 +1,215 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#include "formats/mapped_file.hh"
+#include "formats/graph_file_error.hh"
+
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/filter/bzip2.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filter/zstd.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iterator>
+
+#if !defined(_WIN32)
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+namespace bio = boost::iostreams;
+
+using std::exception;
+using std::size_t;
+using std::uint64_t;
+using std::ifstream;
+using std::ios;
+using std::istreambuf_iterator;
+using std::string;
+using std::string_view;
+
+namespace
+{
+    enum class Compression
+    {
+        none,
+        gzip,
+        bzip2,
+        zstd
+    };
+
+    auto detect_compression(string_view start) -> Compression
+    {
+        // gzip and bzip2's magic numbers are short enough that a text file
+        // could start with one, so we also check what comes next
+        if (start.substr(0, 3) == string_view{ "\x1f\x8b\x08", 3 })
+            return Compression::gzip;
+        else if (start.size() >= 10 && start.substr(0, 3) == "BZh" && start[3] >= '1' && start[3] <= '9' &&
+                (start.substr(4, 6) == "1AY&SY" || start.substr(4, 6) == string_view{ "\x17\x72\x45\x38\x50\x90", 6 }))
+            return Compression::bzip2;
+        else if (start.substr(0, 4) == string_view{ "\x28\xb5\x2f\xfd", 4 })
+            return Compression::zstd;
+        else
+            return Compression::none;
+    }
+
+    // Boost's zstd decompressor is happy to stop part way through a frame,
+    // so to notice truncated files we walk the frame and block headers, as
+    // described in RFC 8878, to check that everything is all there
+    auto zstd_frames_are_complete(string_view data) -> bool
+    {
+        auto get = [&] (size_t pos, unsigned bytes) -> uint64_t {
+            uint64_t result = 0;
+            for (unsigned i = 0 ; i < bytes ; ++i)
+                result |= uint64_t(static_cast<unsigned char>(data[pos + i])) << (8 * i);
+            return result;
+        };
+
+        size_t pos = 0;
+        while (pos < data.size()) {
+            if (data.size() - pos < 8)
+                return false;
+
+            auto magic = get(pos, 4);
+            if ((magic & 0xfffffff0u) == 0x184d2a50u) {
+                // a skippable frame
+                pos += 8 + get(pos + 4, 4);
+                continue;
+            }
+            else if (magic != 0xfd2fb528u)
+                return false;
+
+            auto descriptor = static_cast<unsigned char>(data[pos + 4]);
+            bool single_segment = descriptor & 0x20, checksum = descriptor & 0x04;
+            unsigned dictionary_id_bytes[] = { 0, 1, 2, 4 }, content_size_bytes[] = { single_segment ? 1u : 0u, 2, 4, 8 };
+            pos += 5 + (single_segment ? 0 : 1) + dictionary_id_bytes[descriptor & 0x03] + content_size_bytes[descriptor >> 6];
+
+            bool last_block = false;
+            while (! last_block) {
+                if (pos > data.size() || data.size() - pos < 3)
+                    return false;
+                auto block = get(pos, 3);
+                last_block = block & 1;
+                unsigned type = (block >> 1) & 3;
+                if (3 == type)
+                    return false;
+                pos += 3 + (1 == type ? 1 : (block >> 3));
+            }
+
+            if (checksum)
+                pos += 4;
+            if (pos > data.size())
+                return false;
+        }
+
+        return true;
+    }
+
+    // decompress a bit at a time, so we never hold more than the
+    // compressed data, the output so far, and one buffer
+    auto decompress(string_view data, Compression compression, const string & filename) -> string
+    {
+        string result;
+        try {
+            bio::filtering_istream in;
+            switch (compression) {
+                case Compression::gzip:  in.push(bio::gzip_decompressor());  break;
+                case Compression::bzip2: in.push(bio::bzip2_decompressor()); break;
+                case Compression::zstd:  in.push(bio::zstd_decompressor());  break;
+                case Compression::none:  break;
+            }
+            if (Compression::zstd == compression && ! zstd_frames_are_complete(data))
+                throw GraphFileError{ filename, "error decompressing file: zstd data is truncated or corrupt", true };
+
+            in.push(bio::array_source{ data.data(), data.size() });
+            in.exceptions(ios::badbit);
+
+            result.reserve(data.size() * 4);
+            char buffer[1 << 16];
+            while (in.read(buffer, sizeof(buffer)) || in.gcount() > 0)
+                result.append(buffer, in.gcount());
+        }
+        catch (const GraphFileError &) {
+            throw;
+        }
+        catch (const exception & e) {
+            throw GraphFileError{ filename, string{ "error decompressing file: " } + e.what(), true };
+        }
+
+        return result;
+    }
+}
+
+struct MappedFile::Imp
+{
+    const char * mapped = nullptr;
+    size_t mapped_size = 0;
+    string read;
+
+    ~Imp()
+    {
+        unmap();
+    }
+
+    auto unmap() -> void
+    {
+#if !defined(_WIN32)
+        if (mapped)
+            ::munmap(const_cast<char *>(mapped), mapped_size);
+#endif
+        mapped = nullptr;
+        mapped_size = 0;
+    }
+};
+
+MappedFile::MappedFile(const string & filename) :
+    _imp(new Imp{ })
+{
+#if !defined(_WIN32)
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (-1 == fd)
+        throw GraphFileError{ filename, "unable to open file", false };
+
+    struct stat st;
+    if (0 == ::fstat(fd, &st) && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void * addr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (MAP_FAILED != addr) {
+            ::madvise(addr, st.st_size, MADV_SEQUENTIAL);
+            _imp->mapped = static_cast<const char *>(addr);
+            _imp->mapped_size = st.st_size;
+        }
+    }
+
+    ::close(fd);
+#endif
+
+    if (! _imp->mapped) {
+        ifstream infile{ filename, ios::binary };
+        if (! infile)
+            throw GraphFileError{ filename, "unable to open file", false };
+
+        _imp->read.assign(istreambuf_iterator<char>{ infile }, istreambuf_iterator<char>{ });
+        if (infile.bad())
+            throw GraphFileError{ filename, "error reading file", true };
+    }
+
+    auto compression = detect_compression(contents());
+    if (Compression::none != compression) {
+        _imp->read = decompress(contents(), compression, filename);
+        _imp->unmap();
+    }
+}
+
+MappedFile::~MappedFile() = default;
+
+auto MappedFile::contents() const -> string_view
+{
+    if (_imp->mapped)
+        return string_view{ _imp->mapped, _imp->mapped_size };
+    else
+        return _imp->read;
+}
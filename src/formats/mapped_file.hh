@@ -0,0 +1,41 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#ifndef GLASGOW_SUBGRAPH_SOLVER_SOLVER_FORMATS_MAPPED_FILE_HH
+#define GLASGOW_SUBGRAPH_SOLVER_SOLVER_FORMATS_MAPPED_FILE_HH 1
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+/**
+ * The entire contents of a file, mapped into memory where possible, so
+ * that parsers can work on it directly without copying it line by line.
+ * If the file can't be mapped (for example, if it is empty or is a pipe),
+ * it is read into memory instead.
+ *
+ * Files which start with a gzip, bzip2 or zstd magic number are
+ * decompressed as they are read, so every format can be read compressed.
+ */
+class MappedFile
+{
+    private:
+        struct Imp;
+        std::unique_ptr<Imp> _imp;
+
+    public:
+        /**
+         * \throw GraphFileError if the file cannot be opened or read.
+         */
+        explicit MappedFile(const std::string & filename);
+
+        MappedFile(const MappedFile &) = delete;
+
+        ~MappedFile();
+
+        /**
+         * The file's (decompressed) contents, which last as long as we do.
+         */
+        auto contents() const -> std::string_view;
+};
+
+#endif
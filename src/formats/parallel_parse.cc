@@ -0,0 +1,87 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#include "formats/parallel_parse.hh"
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+
+using std::current_exception;
+using std::exception_ptr;
+using std::function;
+using std::max;
+using std::min;
+using std::rethrow_exception;
+using std::size_t;
+using std::string_view;
+using std::thread;
+using std::vector;
+
+namespace
+{
+    // below this, starting threads costs more than it saves
+    const constexpr size_t bytes_per_chunk = 8 << 20;
+
+    unsigned forced_chunk_count = 0;
+}
+
+auto parse_chunk_count(size_t bytes) -> unsigned
+{
+    if (0 != forced_chunk_count)
+        return forced_chunk_count;
+
+    size_t wanted = bytes / bytes_per_chunk;
+    return max<size_t>(1, min<size_t>(wanted, max(1u, thread::hardware_concurrency())));
+}
+
+auto force_parse_chunk_count(unsigned n) -> void
+{
+    forced_chunk_count = n;
+}
+
+auto split_at_lines(string_view contents, unsigned n) -> vector<string_view>
+{
+    vector<string_view> result;
+    result.reserve(n);
+
+    size_t start = 0;
+    for (unsigned i = 1 ; i < n ; ++i) {
+        size_t end = max(start, contents.size() / n * i);
+        end = contents.find('\n', end);
+        end = (string_view::npos == end) ? contents.size() : end + 1;
+        result.push_back(contents.substr(start, end - start));
+        start = end;
+    }
+    result.push_back(contents.substr(start));
+
+    return result;
+}
+
+auto parse_in_parallel(unsigned n, const function<void (unsigned)> & f) -> void
+{
+    if (n <= 1) {
+        if (1 == n)
+            f(0);
+        return;
+    }
+
+    vector<exception_ptr> failures(n);
+    vector<thread> threads;
+    threads.reserve(n);
+    for (unsigned i = 0 ; i < n ; ++i)
+        threads.emplace_back([&, i] {
+            try {
+                f(i);
+            }
+            catch (...) {
+                failures[i] = current_exception();
+            }
+        });
+
+    for (auto & t : threads)
+        t.join();
+
+    for (auto & e : failures)
+        if (e)
+            rethrow_exception(e);
+}
@@ -0,0 +1,40 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#ifndef GLASGOW_SUBGRAPH_SOLVER_SOLVER_FORMATS_PARALLEL_PARSE_HH
+#define GLASGOW_SUBGRAPH_SOLVER_SOLVER_FORMATS_PARALLEL_PARSE_HH 1
+
+#include <cstddef>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+/**
+ * How many pieces a text file of this many bytes should be parsed in. Small
+ * files are parsed in one piece, and big ones in up to one piece per
+ * hardware thread.
+ */
+auto parse_chunk_count(std::size_t bytes) -> unsigned;
+
+/**
+ * Make parse_chunk_count() give exactly n pieces from now on, whatever the
+ * size of the file, or go back to choosing by size if n is zero. This is
+ * mostly so that the parallel parsers can be tested on small files.
+ */
+auto force_parse_chunk_count(unsigned n) -> void;
+
+/**
+ * Split contents into n consecutive pieces of roughly equal size, each of
+ * which except the last ends just after a newline. Some pieces may be
+ * empty, if the lines are very long.
+ */
+auto split_at_lines(std::string_view contents, unsigned n) -> std::vector<std::string_view>;
+
+/**
+ * Call f(0) to f(n - 1), each on its own thread if n is more than one. If
+ * any of them throw, the exception from the lowest numbered one is
+ * rethrown once they have all finished, so that a file with several errors
+ * always reports the first one.
+ */
+auto parse_in_parallel(unsigned n, const std::function<void (unsigned)> & f) -> void;
+
+#endif
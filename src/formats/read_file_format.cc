@@ -5,27 +5,57 @@
 #include "formats/lad.hh"
 #include "formats/csv.hh"
 #include "formats/vfmcs.hh"
+#include "formats/graph_cache.hh"
+#include "formats/mapped_file.hh"
 
-#include <fstream>
 #include <regex>
 #include <sstream>
+#include <string_view>
 #include <vector>
 
-using std::ifstream;
-using std::ios;
-using std::move;
+using std::istringstream;
 using std::regex;
 using std::smatch;
 using std::stoi;
 using std::string;
+using std::string_view;
 using std::stringstream;
 using std::to_string;
 using std::vector;
 
-auto detect_format(ifstream & infile, const string & filename) -> string
+namespace
 {
+    // reads lines from the start of a file, like getline, so we only look
+    // at as much as we need to
+    class LineReader
+    {
+        private:
+            string_view _rest;
+
+        public:
+            explicit LineReader(string_view contents) :
+                _rest(contents)
+            {
+            }
+
+            auto next(string & line) -> bool
+            {
+                if (_rest.empty())
+                    return false;
+
+                auto end = _rest.find('\n');
+                line = _rest.substr(0, end);
+                _rest = (string_view::npos == end) ? string_view{ } : _rest.substr(end + 1);
+                return true;
+            }
+    };
+}
+
+auto detect_file_format(string_view contents, const string & filename) -> string
+{
+    LineReader infile{ contents };
     string line;
-    if (! getline(infile, line) || line.empty())
+    if (! infile.next(line) || line.empty())
         throw GraphFileError{ filename, "unable to read file to detect file format", true };
 
     static const regex
@@ -41,7 +71,7 @@ auto detect_format(ifstream & infile, const string & filename) -> string
     if (regex_match(line, match, dimacs_comment)) {
         while (regex_match(line, match, dimacs_comment)) {
             // looks like a DIMACS comment, ignore
-            if (! getline(infile, line) || line.empty())
+            if (! infile.next(line) || line.empty())
                 throw GraphFileError{ filename, "unable to auto-detect file format (entirely c lines?)", true };
         }
         if (! regex_match(line, match, dimacs_problem))
@@ -55,7 +85,7 @@ auto detect_format(ifstream & infile, const string & filename) -> string
             return "lad";
 
         // got to figure out whether we're labelled or not
-        if (! getline(infile, line) || line.empty())
+        if (! infile.next(line) || line.empty())
             throw GraphFileError{ filename, "unable to auto-detect file format (number followed by nothing)", true };
         if (regex_match(line, match, lad_zero_labelled_line))
             return "labelledlad";
@@ -92,41 +122,49 @@ auto detect_format(ifstream & infile, const string & filename) -> string
     throw GraphFileError{ filename, "unable to auto-detect file format (no recognisable header found)", true };
 }
 
-auto read_file_format(const string & format, const string & filename) -> InputGraph
+namespace
 {
-    ifstream infile{ filename };
-    if (! infile)
-        throw GraphFileError{ filename, "unable to open file", false };
-
-    auto actual_format = format;
-    if (actual_format == "auto") {
-        actual_format = detect_format(infile, filename);
-        infile.clear();
-        if (! infile.seekg(0, ios::beg))
-            throw GraphFileError{ filename, "unable to seek on input file (try specifying file format explicitly)", true };
-    }
+    auto read_any_file_format(const string & format, const string & filename) -> InputGraph
+    {
+        // this decompresses the file if necessary, so we detect the format
+        // from the start of what it holds, and then parse that, rather than
+        // having to rewind
+        MappedFile file{ filename };
+
+        auto actual_format = format;
+        if (actual_format == "auto")
+            actual_format = looks_like_graph_cache(file.contents()) ? "cache" : detect_file_format(file.contents(), filename);
 
-    if (actual_format == "dimacs")
-        return read_dimacs(move(infile), filename);
-    else if (actual_format == "lad")
-        return read_lad(move(infile), filename);
-    else if (actual_format == "directedlad")
-        return read_directed_lad(move(infile), filename);
-    else if (actual_format == "labelledlad")
-        return read_labelled_lad(move(infile), filename);
-    else if (actual_format == "vertexlabelledlad")
-        return read_vertex_labelled_lad(move(infile), filename);
-    else if (actual_format == "csv")
-        return read_csv(move(infile), filename);
-    else if (actual_format == "vfmcs")
-        return read_unlabelled_undirected_vfmcs(move(infile), filename);
-    else if (actual_format == "vfmcsv")
-        return read_vertex_labelled_undirected_vfmcs(move(infile), filename);
-    else if (actual_format == "vfmcsvd")
-        return read_vertex_labelled_directed_vfmcs(move(infile), filename);
-    else if (0 == actual_format.compare(0, 8, "csvname:"))
-        return read_csv_name(move(infile), filename, actual_format.substr(8));
-    else
-        throw GraphFileError{ filename, "Unknown file format '" + format + "'", true };
+        if (actual_format == "dimacs")
+            return read_dimacs(file, filename);
+        else if (actual_format == "cache")
+            return read_graph_cache(file, filename);
+        else if (actual_format == "lad")
+            return read_lad(file, filename);
+        else if (actual_format == "directedlad")
+            return read_directed_lad(file, filename);
+        else if (actual_format == "labelledlad")
+            return read_labelled_lad(file, filename);
+        else if (actual_format == "vertexlabelledlad")
+            return read_vertex_labelled_lad(file, filename);
+        else if (actual_format == "csv")
+            return read_csv(file, filename);
+        else if (actual_format == "vfmcs")
+            return read_unlabelled_undirected_vfmcs(istringstream{ string{ file.contents() } }, filename);
+        else if (actual_format == "vfmcsv")
+            return read_vertex_labelled_undirected_vfmcs(istringstream{ string{ file.contents() } }, filename);
+        else if (actual_format == "vfmcsvd")
+            return read_vertex_labelled_directed_vfmcs(istringstream{ string{ file.contents() } }, filename);
+        else if (0 == actual_format.compare(0, 8, "csvname:"))
+            return read_csv_name(file, filename, actual_format.substr(8));
+        else
+            throw GraphFileError{ filename, "Unknown file format '" + format + "'", true };
+    }
 }
 
+auto read_file_format(const string & format, const string & filename) -> InputGraph
+{
+    auto result = read_any_file_format(format, filename);
+    result.compact();
+    return result;
+}
@@ -7,16 +7,18 @@
 #include "formats/graph_file_error.hh"
 
 #include <string>
+#include <string_view>
 
 /**
- * Detect a graph file format.
+ * Detect a graph file format, from the start of its (decompressed) contents.
  *
  * \throw GraphFileError
  */
-auto detect_file_format(std::ifstream & infile, const std::string & filename) -> std::string;
+auto detect_file_format(std::string_view contents, const std::string & filename) -> std::string;
 
 /**
  * Read in a file in the specified format ("auto" to try to auto-detect).
+ * Files compressed using gzip, bzip2 or zstd are decompressed first.
  *
  * \throw GraphFileError
  */
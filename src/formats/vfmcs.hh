@@ -9,10 +9,10 @@
 #include <iosfwd>
 #include <string>
 
-auto read_unlabelled_undirected_vfmcs(std::ifstream && infile, const std::string & filename) -> InputGraph;
+auto read_unlabelled_undirected_vfmcs(std::istream && infile, const std::string & filename) -> InputGraph;
 
-auto read_vertex_labelled_undirected_vfmcs(std::ifstream && infile, const std::string & filename) -> InputGraph;
+auto read_vertex_labelled_undirected_vfmcs(std::istream && infile, const std::string & filename) -> InputGraph;
 
-auto read_vertex_labelled_directed_vfmcs(std::ifstream && infile, const std::string & filename) -> InputGraph;
+auto read_vertex_labelled_directed_vfmcs(std::istream && infile, const std::string & filename) -> InputGraph;
 
 #endif
@@ -1,9 +1,13 @@
 /* vim: set sw=4 sts=4 et foldmethod=syntax : */
 
 #include "formats/read_file_format.hh"
+#include "formats/graph_cache.hh"
+#include "formats/parallel_parse.hh"
+#include "bitset_kernels.hh"
 #include "clique.hh"
 #include "configuration.hh"
 #include "proof.hh"
+#include "parallel_compressing_stream.hh"
 
 #include <boost/program_options.hpp>
 
@@ -34,6 +38,7 @@ using std::make_unique;
 using std::put_time;
 using std::string;
 using std::string_view;
+using std::to_string;
 
 using std::chrono::duration_cast;
 using std::chrono::milliseconds;
@@ -54,6 +59,44 @@ auto colour_class_order_from_string(string_view s) -> ColourClassOrder
         throw UnsupportedConfiguration{ "Unknown colour class order '" + string(s) + "'" };
 }
 
+auto proof_format_from_string(string_view s) -> ProofFormat
+{
+    if (s == "text")
+        return ProofFormat::Text;
+    else if (s == "binary")
+        return ProofFormat::Binary;
+    else
+        throw UnsupportedConfiguration{ "Unknown proof format '" + string(s) + "'" };
+}
+
+auto proof_compression_from_string(string_view s) -> ProofCompression
+{
+    if (s == "none")
+        return ProofCompression::None;
+    else if (s == "bz2")
+        return ProofCompression::Bz2;
+    else if (s == "zstd")
+        return ProofCompression::Zstd;
+    else if (s == "lz4")
+        return ProofCompression::Lz4;
+    else
+        throw UnsupportedConfiguration{ "Unknown proof compression '" + string(s) + "'" };
+}
+
+auto proof_sink_from_string(string_view s) -> ProofSink
+{
+    if (s == "iostream-endl")
+        return ProofSink::IOStreamEndl;
+    else if (s == "iostream")
+        return ProofSink::IOStream;
+    else if (s == "fmt")
+        return ProofSink::Fmt;
+    else if (s == "raw")
+        return ProofSink::Raw;
+    else
+        throw UnsupportedConfiguration{ "Unknown proof sink '" + string(s) + "'" };
+}
+
 auto main(int argc, char * argv[]) -> int
 {
     try {
@@ -61,7 +104,9 @@ auto main(int argc, char * argv[]) -> int
         display_options.add_options()
             ("help",                                         "Display help information")
             ("timeout",            po::value<int>(),         "Abort after this many seconds")
-            ("format",             po::value<string>(),      "Specify input file format (auto, lad, labelledlad, dimacs)")
+            ("format",             po::value<string>(),      "Specify input file format (auto, lad, labelledlad, dimacs, cache)")
+            ("write-cache",        po::value<string>(),      "Write the graph to this cache file (for --format cache), and exit")
+            ("parse-pieces",       po::value<unsigned>(),    "Parse LAD and CSV files in this many pieces, in parallel (default depends upon the size)")
             ("decide",             po::value<int>(),         "Solve this decision problem");
 
         po::options_description configuration_options{ "Advanced configuration options" };
@@ -69,14 +114,36 @@ auto main(int argc, char * argv[]) -> int
             ("colour-ordering",    po::value<string>(),      "Specify colour-ordering (colour / singletons-first / sorted)")
             ("input-order",                                  "Use the input order for colouring (usually a bad idea)")
             ("restarts-constant",  po::value<int>(),         "How often to perform restarts (disabled by default)")
-            ("geometric-restarts", po::value<double>(),      "Use geometric restarts with the specified multiplier (default is Luby)");
+            ("geometric-restarts", po::value<double>(),      "Use geometric restarts with the specified multiplier (default is Luby)")
+            ("nogood-size-limit",  po::value<unsigned>(),    "Only keep nogoods (from restarts) with at most this many literals")
+            ("nogood-reduce-interval", po::value<unsigned>(), "Delete some nogoods every this many restarts (default never)")
+            ("nogood-reduce-fraction", po::value<double>(),   "Fraction of nogoods to delete each time (default 0.5)")
+            ("threads",            po::value<unsigned>(),    "Search using this many threads (default 1, 0 for one per hardware thread); with more than one, node counts vary between runs")
+            ("bitset-kernels",     po::value<string>(),      "Bitset instructions to use (auto / scalar / sse4.2 / avx2 / avx512)")
+            ("allocation-stats",                             "Report how many bitsets the search allocated")
+            ("tighten-bounds",                               "Tighten colour bounds by recolouring and with infra-chromatic conflicts (fewer nodes, but usually slower unless proof logging)")
+            ("reduce",                                       "Delete vertices that can't be in a better clique before searching")
+            ("sparse",                                       "Solve one small subproblem per vertex, for large sparse graphs (no proofs)")
+            ("warm-start",                                   "Find a good clique heuristically before searching")
+            ("warm-start-moves",   po::value<unsigned long long>(), "Local search moves per warm start thread (default 10000)")
+            ("warm-start-time-limit", po::value<int>(),      "Stop the warm start after this many milliseconds (default 1000)")
+            ("warm-start-threads", po::value<unsigned>(),    "Threads to use for the warm start (default is one per hardware thread)");
         display_options.add(configuration_options);
 
         po::options_description proof_logging_options{ "Proof logging options" };
         proof_logging_options.add_options()
             ("prove",               po::value<string>(),       "Write unsat proofs to this filename (suffixed with .opb and .veripb)")
             ("proof-names",                                    "Use 'friendly' variable names in the proof, rather than x1, x2, ...")
-            ("compress-proof",                                 "Compress the proof using bz2");
+            ("compress-proof",                                 "Compress the proof using bz2 (the same as --proof-compression=bz2)")
+            ("proof-compression",   po::value<string>(),       "Compress the proof (none / bz2 / zstd / lz4), in blocks, using several threads")
+            ("proof-compression-level", po::value<int>(),      "Compression level (default depends upon the compressor)")
+            ("proof-compression-threads", po::value<unsigned>(), "Threads to use for compression (default is one per hardware thread)")
+            ("async-proof",                                    "Write the proof log from a separate thread")
+            ("proof-format",        po::value<string>(),       "Proof log format (text / binary, expand binary logs using proof_expand)")
+            ("proof-sink",          po::value<string>(),       "How to write a text proof log (iostream-endl / iostream / fmt / raw)")
+            ("proof-no-comments",                              "Don't write comments describing bounds and backtracking in the proof")
+            ("proof-skip-singletons",                          "Don't write a sum line for colour classes with only one vertex")
+            ("proof-dense-ids",                                "Look up non-edge constraint IDs in a triangular table rather than a map");
         display_options.add(proof_logging_options);
 
         po::options_description all_options{ "All options" };
@@ -138,6 +205,41 @@ auto main(int argc, char * argv[]) -> int
             params.colour_class_order = colour_class_order_from_string(options_vars["colour-ordering"].as<string>());
         params.input_order = options_vars.count("input-order");
 
+        if (options_vars.count("nogood-size-limit"))
+            params.nogood_size_limit = options_vars["nogood-size-limit"].as<unsigned>();
+        if (options_vars.count("nogood-reduce-interval"))
+            params.nogood_reduce_interval = options_vars["nogood-reduce-interval"].as<unsigned>();
+        if (options_vars.count("nogood-reduce-fraction")) {
+            params.nogood_reduce_fraction = options_vars["nogood-reduce-fraction"].as<double>();
+            if (params.nogood_reduce_fraction < 0.0 || params.nogood_reduce_fraction > 1.0)
+                throw UnsupportedConfiguration{ "Nogood reduce fraction must be between 0 and 1" };
+        }
+        params.allocation_stats = options_vars.count("allocation-stats");
+        params.tighten_bounds = options_vars.count("tighten-bounds");
+
+        params.reduce = options_vars.count("reduce");
+        params.sparse = options_vars.count("sparse");
+        if (params.sparse && options_vars.count("prove"))
+            throw UnsupportedConfiguration{ "Proof logging isn't supported in sparse mode" };
+        params.warm_start = options_vars.count("warm-start");
+        if (options_vars.count("warm-start-moves"))
+            params.warm_start_moves = options_vars["warm-start-moves"].as<unsigned long long>();
+        if (options_vars.count("warm-start-time-limit"))
+            params.warm_start_time_limit = milliseconds{ options_vars["warm-start-time-limit"].as<int>() };
+        if (options_vars.count("warm-start-threads"))
+            params.warm_start_threads = options_vars["warm-start-threads"].as<unsigned>();
+
+        if (options_vars.count("bitset-kernels"))
+            select_bitset_kernels(options_vars["bitset-kernels"].as<string>());
+
+        if (options_vars.count("threads")) {
+            params.threads = options_vars["threads"].as<unsigned>();
+            if (params.threads != 1 && options_vars.count("prove"))
+                throw UnsupportedConfiguration{ "Proof logging needs a single thread" };
+            if (params.threads != 1 && options_vars.count("restarts-constant"))
+                throw UnsupportedConfiguration{ "Restarts need a single thread" };
+        }
+
 #if !defined(_WIN32)
         char hostname_buf[255];
         if (0 == gethostname(hostname_buf, 255))
@@ -152,19 +254,55 @@ auto main(int argc, char * argv[]) -> int
         cout << "started_at = " << put_time(localtime(&started_at), "%F %T") << ",";
 
         /* Read in the graphs */
+        if (options_vars.count("parse-pieces"))
+            force_parse_chunk_count(options_vars["parse-pieces"].as<unsigned>());
         string pattern_format_name = options_vars.count("format") ? options_vars["format"].as<string>() : "auto";
         auto graph = read_file_format(pattern_format_name, options_vars["graph-file"].as<string>());
 
+        if (options_vars.count("write-cache")) {
+            write_graph_cache(graph, options_vars["write-cache"].as<string>());
+            cout << "file = " << options_vars["graph-file"].as<string>() << ",cache = " << options_vars["write-cache"].as<string>() << endl;
+            return EXIT_SUCCESS;
+        }
+
         cout << "file = " << options_vars["graph-file"].as<string>() << ",";
 
         if (options_vars.count("prove")) {
-            bool friendly_names = options_vars.count("proof-names");
-            bool compress_proof = options_vars.count("compress-proof");
             string fn = options_vars["prove"].as<string>();
-            string suffix = compress_proof ? ".bz2" : "";
-            params.proof = make_unique<Proof>(fn + ".opb", fn + ".veripb", friendly_names, compress_proof);
-            cout << "proof_model = " << fn << ".opb" << suffix << ",";
-            cout << "proof_log = " << fn << ".veripb" << suffix << ",";
+            ProofOptions proof_options;
+            proof_options.opb_file = fn + ".opb";
+            proof_options.log_file = fn + ".veripb";
+            proof_options.friendly_names = options_vars.count("proof-names");
+            if (options_vars.count("compress-proof"))
+                proof_options.compression = ProofCompression::Bz2;
+            if (options_vars.count("proof-compression"))
+                proof_options.compression = proof_compression_from_string(options_vars["proof-compression"].as<string>());
+            if (options_vars.count("proof-compression-level")) {
+                int level = options_vars["proof-compression-level"].as<int>();
+                auto [ lowest, highest ] = compression_level_range(proof_options.compression);
+                if (0 == highest)
+                    throw UnsupportedConfiguration{ "--proof-compression-level needs a --proof-compression method" };
+                else if (0 != level && (level < lowest || level > highest))
+                    throw UnsupportedConfiguration{ "Proof compression level must be between " + to_string(lowest) + " and "
+                        + to_string(highest) + " (or 0 for the default) for this compression method" };
+                proof_options.compression_level = level;
+            }
+            if (options_vars.count("proof-compression-threads"))
+                proof_options.compression_threads = options_vars["proof-compression-threads"].as<unsigned>();
+            proof_options.async = options_vars.count("async-proof");
+            if (options_vars.count("proof-format"))
+                proof_options.format = proof_format_from_string(options_vars["proof-format"].as<string>());
+            if (proof_options.format == ProofFormat::Binary)
+                proof_options.log_file += ".bin";
+            if (options_vars.count("proof-sink"))
+                proof_options.sink = proof_sink_from_string(options_vars["proof-sink"].as<string>());
+            proof_options.bound_comments = ! options_vars.count("proof-no-comments");
+            proof_options.skip_singleton_colour_classes = options_vars.count("proof-skip-singletons");
+            proof_options.dense_constraint_ids = options_vars.count("proof-dense-ids");
+            string suffix = compressed_filename_suffix(proof_options.compression);
+            params.proof = make_unique<Proof>(proof_options);
+            cout << "proof_model = " << proof_options.opb_file << suffix << ",";
+            cout << "proof_log = " << proof_options.log_file << suffix << ",";
         }
 
         /* Prepare and start timeout */
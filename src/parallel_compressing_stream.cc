@@ -0,0 +1,362 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#include "parallel_compressing_stream.hh"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <streambuf>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/bzip2.hpp>
+#include <boost/iostreams/filter/zstd.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+
+#ifdef GLASGOW_HAVE_LZ4
+#  include <lz4frame.h>
+#endif
+
+using std::condition_variable;
+using std::deque;
+using std::make_shared;
+using std::max;
+using std::mutex;
+using std::ostream;
+using std::pair;
+using std::shared_ptr;
+using std::size_t;
+using std::streambuf;
+using std::streamsize;
+using std::string;
+using std::thread;
+using std::to_string;
+using std::unique_lock;
+using std::unique_ptr;
+using std::vector;
+
+namespace bio = boost::iostreams;
+
+namespace
+{
+    auto compress_block(ProofCompression compression, int level, const string & input, string & output) -> void
+    {
+        output.clear();
+
+        switch (compression) {
+            case ProofCompression::None:
+                output = input;
+                return;
+
+            case ProofCompression::Bz2:
+                {
+                    bio::filtering_ostream out;
+                    out.push(bio::bzip2_compressor(bio::bzip2_params(level ? level : bio::bzip2::default_block_size)));
+                    out.push(bio::back_inserter(output));
+                    out.exceptions(std::ios::badbit);
+                    out.write(input.data(), input.size());
+                    out.reset();
+                }
+                return;
+
+            case ProofCompression::Zstd:
+                {
+                    bio::filtering_ostream out;
+                    out.push(bio::zstd_compressor(bio::zstd_params(level ? level : bio::zstd::default_compression)));
+                    out.push(bio::back_inserter(output));
+                    out.exceptions(std::ios::badbit);
+                    out.write(input.data(), input.size());
+                    out.reset();
+                }
+                return;
+
+            case ProofCompression::Lz4:
+#ifdef GLASGOW_HAVE_LZ4
+                {
+                    LZ4F_preferences_t preferences{};
+                    preferences.compressionLevel = level;
+                    output.resize(LZ4F_compressFrameBound(input.size(), &preferences));
+                    auto size = LZ4F_compressFrame(output.data(), output.size(), input.data(), input.size(), &preferences);
+                    if (LZ4F_isError(size))
+                        throw ProofError{ string{ "lz4 compression failed: " } + LZ4F_getErrorName(size) };
+                    output.resize(size);
+                }
+                return;
+#else
+                break;
+#endif
+        }
+
+        throw ProofError{ "this compression method is not available" };
+    }
+
+    struct Block
+    {
+        string input, output;
+        bool done = false, failed = false;
+    };
+
+    class CompressingBuffer : public streambuf
+    {
+        private:
+            unique_ptr<ostream> _underlying;
+            ProofCompression _compression;
+            int _level;
+            size_t _block_size;
+            unsigned _max_in_flight;
+
+            mutex _mutex;
+            condition_variable _cv;
+            deque<shared_ptr<Block> > _in_flight, _to_compress;
+            bool _stopping = false, _failed = false;
+
+            string _current;
+            vector<thread> _workers;
+            thread _writer;
+
+            auto worker_loop() -> void
+            {
+                unique_lock<mutex> guard(_mutex);
+                while (true) {
+                    _cv.wait(guard, [&] { return _stopping || ! _to_compress.empty(); });
+                    if (_to_compress.empty())
+                        break;
+
+                    auto block = _to_compress.front();
+                    _to_compress.pop_front();
+
+                    guard.unlock();
+                    bool ok = true;
+                    try {
+                        compress_block(_compression, _level, block->input, block->output);
+                    }
+                    catch (...) {
+                        ok = false;
+                    }
+                    string{}.swap(block->input);
+                    guard.lock();
+
+                    block->failed = ! ok;
+                    block->done = true;
+                    _cv.notify_all();
+                }
+            }
+
+            // blocks can finish out of order, but must be written in order
+            auto writer_loop() -> void
+            {
+                unique_lock<mutex> guard(_mutex);
+                while (true) {
+                    _cv.wait(guard, [&] { return (_stopping && _in_flight.empty()) || (! _in_flight.empty() && _in_flight.front()->done); });
+                    if (_in_flight.empty())
+                        break;
+
+                    // once a block is lost, writing any later ones would
+                    // just give a stream with a hole in it
+                    auto block = _in_flight.front();
+                    if (block->failed)
+                        _failed = true;
+
+                    if (! _failed) {
+                        guard.unlock();
+                        bool ok = false;
+                        try {
+                            ok = bool(_underlying->write(block->output.data(), block->output.size()));
+                        }
+                        catch (...) {
+                        }
+                        guard.lock();
+
+                        if (! ok)
+                            _failed = true;
+                    }
+
+                    _in_flight.pop_front();
+                    _cv.notify_all();
+                }
+            }
+
+            auto start_block() -> void
+            {
+                _current.resize(_block_size);
+                setp(_current.data(), _current.data() + _block_size);
+            }
+
+            // queue up the current block for compression, waiting if too
+            // many are already in flight
+            auto hand_off() -> bool
+            {
+                unique_lock<mutex> guard(_mutex);
+                if (_stopping)
+                    return false;
+
+                if (pptr() != pbase()) {
+                    _current.resize(pptr() - pbase());
+                    _cv.wait(guard, [&] { return _in_flight.size() < _max_in_flight; });
+
+                    auto block = make_shared<Block>();
+                    block->input = std::move(_current);
+                    _in_flight.push_back(block);
+                    _to_compress.push_back(block);
+                    _cv.notify_all();
+                }
+
+                start_block();
+                return ! _failed;
+            }
+
+        protected:
+            auto overflow(int_type c) -> int_type override
+            {
+                if (! hand_off())
+                    return traits_type::eof();
+
+                if (! traits_type::eq_int_type(c, traits_type::eof())) {
+                    *pptr() = traits_type::to_char_type(c);
+                    pbump(1);
+                }
+
+                return traits_type::not_eof(c);
+            }
+
+            auto xsputn(const char * s, streamsize n) -> streamsize override
+            {
+                streamsize done = 0;
+                while (done < n) {
+                    if (pptr() == epptr() && ! hand_off())
+                        return done;
+
+                    streamsize chunk = std::min<streamsize>(n - done, epptr() - pptr());
+                    traits_type::copy(pptr(), s + done, chunk);
+                    pbump(int(chunk));
+                    done += chunk;
+                }
+
+                return done;
+            }
+
+            auto sync() -> int override
+            {
+                // as with AsyncProofStream, flushing must not cut blocks
+                return 0;
+            }
+
+        public:
+            CompressingBuffer(unique_ptr<ostream> && underlying, ProofCompression compression, int level,
+                    unsigned threads, size_t block_size) :
+                _underlying(std::move(underlying)),
+                _compression(compression),
+                _level(level),
+                _block_size(block_size)
+            {
+                check_compression(compression, level);
+
+                if (0 == threads)
+                    threads = max(1u, thread::hardware_concurrency());
+                _max_in_flight = 2 * threads;
+
+                start_block();
+                for (unsigned i = 0 ; i < threads ; ++i)
+                    _workers.emplace_back([this] { worker_loop(); });
+                _writer = thread([this] { writer_loop(); });
+            }
+
+            ~CompressingBuffer() override
+            {
+                close();
+            }
+
+            auto close() -> bool
+            {
+                if (! _writer.joinable())
+                    return ! _failed;
+
+                hand_off();
+
+                {
+                    unique_lock<mutex> guard(_mutex);
+                    setp(nullptr, nullptr);
+                    _stopping = true;
+                    _cv.notify_all();
+                }
+
+                for (auto & w : _workers)
+                    w.join();
+                _writer.join();
+
+                if (! _underlying->flush())
+                    _failed = true;
+
+                return ! _failed;
+            }
+    };
+}
+
+struct ParallelCompressingStream::Imp
+{
+    CompressingBuffer buffer;
+
+    Imp(unique_ptr<ostream> && underlying, ProofCompression compression, int level, unsigned threads, size_t block_size) :
+        buffer(std::move(underlying), compression, level, threads, block_size)
+    {
+    }
+};
+
+ParallelCompressingStream::ParallelCompressingStream(unique_ptr<ostream> && underlying,
+        ProofCompression compression, int level, unsigned threads, size_t block_size) :
+    ostream(nullptr),
+    _imp(std::make_unique<Imp>(std::move(underlying), compression, level, threads, block_size))
+{
+    rdbuf(&_imp->buffer);
+}
+
+ParallelCompressingStream::~ParallelCompressingStream()
+{
+    _imp->buffer.close();
+}
+
+auto ParallelCompressingStream::close() -> void
+{
+    if (! _imp->buffer.close())
+        setstate(badbit);
+}
+
+auto compressed_filename_suffix(ProofCompression compression) -> string
+{
+    switch (compression) {
+        case ProofCompression::None: return "";
+        case ProofCompression::Bz2:  return ".bz2";
+        case ProofCompression::Zstd: return ".zst";
+        case ProofCompression::Lz4:  return ".lz4";
+    }
+
+    return "";
+}
+
+auto compression_level_range(ProofCompression compression) -> pair<int, int>
+{
+    switch (compression) {
+        case ProofCompression::None: return { 0, 0 };
+        case ProofCompression::Bz2:  return { 1, 9 };   // the block size, in units of 100k
+        case ProofCompression::Zstd: return { 1, 22 };  // ZSTD_maxCLevel()
+        case ProofCompression::Lz4:  return { 1, 12 };  // LZ4HC_CLEVEL_MAX
+    }
+
+    return { 0, 0 };
+}
+
+auto check_compression(ProofCompression compression, int level) -> void
+{
+#ifndef GLASGOW_HAVE_LZ4
+    if (compression == ProofCompression::Lz4)
+        throw ProofError{ "lz4 compression was not available when this solver was built" };
+#endif
+
+    auto [ lowest, highest ] = compression_level_range(compression);
+    if (0 != level && (level < lowest || level > highest))
+        throw ProofError{ "compression level " + to_string(level) + " is not valid, levels go from "
+            + to_string(lowest) + " to " + to_string(highest) };
+}
@@ -0,0 +1,81 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#ifndef GLASGOW_SUBGRAPH_SOLVER_GUARD_SRC_PARALLEL_COMPRESSING_STREAM_HH
+#define GLASGOW_SUBGRAPH_SOLVER_GUARD_SRC_PARALLEL_COMPRESSING_STREAM_HH 1
+
+#include "proof.hh"
+
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+
+/**
+ * An output stream that cuts everything written to it into fixed-size
+ * blocks, and compresses each block independently on a pool of worker
+ * threads. Each block becomes a complete bz2 stream, zstd frame or lz4
+ * frame, and these are written to the underlying stream in order by a
+ * separate writer thread. The standard decompressors all accept such a
+ * concatenation, and give back exactly the bytes written here.
+ *
+ * At most twice as many blocks as there are workers are ever in flight:
+ * if compression falls behind, writing blocks until one is finished.
+ */
+class ParallelCompressingStream : public std::ostream
+{
+    private:
+        struct Imp;
+        std::unique_ptr<Imp> _imp;
+
+    public:
+        static constexpr std::size_t default_block_size = 1 << 20;
+
+        /**
+         * A level of zero means the compressor's default, and zero threads
+         * means one per hardware thread.
+         *
+         * \throw ProofError if this compression method was not built in, or
+         * if the level is outside compression_level_range().
+         */
+        ParallelCompressingStream(std::unique_ptr<std::ostream> && underlying,
+                ProofCompression compression, int level, unsigned threads,
+                std::size_t block_size = default_block_size);
+
+        ~ParallelCompressingStream() override;
+
+        ParallelCompressingStream(const ParallelCompressingStream &) = delete;
+        auto operator= (const ParallelCompressingStream &) -> ParallelCompressingStream & = delete;
+
+        /**
+         * Compress and write anything still buffered, wait for all the
+         * threads to finish, and flush the underlying stream. Sets badbit if
+         * anything could not be compressed or written, in which case nothing
+         * from that block onwards reaches the underlying stream. Safe to
+         * call more than once.
+         */
+        auto close() -> void;
+};
+
+/**
+ * The usual filename suffix for this compression method, or an empty
+ * string for none.
+ */
+auto compressed_filename_suffix(ProofCompression) -> std::string;
+
+/**
+ * The lowest and highest levels this compression method accepts. Zero, for
+ * the compressor's default, is always accepted as well. Both are zero if the
+ * method has no levels.
+ */
+auto compression_level_range(ProofCompression) -> std::pair<int, int>;
+
+/**
+ * Check that this compression method was built in, and that the level is
+ * valid for it, so that this can be done before any files are opened.
+ *
+ * \throw ProofError
+ */
+auto check_compression(ProofCompression, int level) -> void;
+
+#endif
@@ -1,1298 +1,583 @@
 /* vim: set sw=4 sts=4 et foldmethod=syntax : */
 
 #include "proof.hh"
+#include "async_proof_stream.hh"
+#include "parallel_compressing_stream.hh"
+#include "proof_sinks.hh"
 #include "do_not_print.hh"
 
 #include <algorithm>
+#include <cstdint>
 #include <iterator>
 #include <fstream>
+#include <limits>
 #include <map>
 #include <memory>
 #include <sstream>
 #include <tuple>
+#include <type_traits>
 #include <utility>
 
-#include <boost/iostreams/device/file.hpp>
-#include <boost/iostreams/filter/bzip2.hpp>
-#include <boost/iostreams/filtering_stream.hpp>
-#include <boost/iostreams/stream.hpp>
-
+using std::conditional_t;
 using std::copy;
-using std::endl;
+using std::false_type;
 using std::find;
+using std::find_if;
 using std::function;
 using std::istreambuf_iterator;
+using std::lower_bound;
 using std::make_unique;
 using std::map;
 using std::max;
 using std::min;
 using std::move;
+using std::numeric_limits;
 using std::ofstream;
 using std::optional;
 using std::ostream;
 using std::ostreambuf_iterator;
 using std::pair;
 using std::set;
+using std::size_t;
 using std::string;
 using std::stringstream;
 using std::to_string;
+using std::true_type;
 using std::tuple;
+using std::uint32_t;
 using std::unique_ptr;
 using std::vector;
 
-using boost::iostreams::bzip2_compressor;
-using boost::iostreams::file_sink;
-using boost::iostreams::filtering_ostream;
-
-#include <fmt/core.h>
-#include <fmt/os.h>
-
-/* There will be 3/4 versions of this code to reflect the different test version that will be run */
-/* Preproccessing code will be used to seperate them */
-namespace
-{
-    auto make_compressed_ostream(const string & fn) -> unique_ptr<ostream>
-    {
-        auto out = make_unique<filtering_ostream>();
-        out->push(bzip2_compressor());
-        out->push(file_sink(fn));
-        return out;
-    }
-}
-
-ProofError::ProofError(const string & m) noexcept :
-    _message("Proof error: " + m)
-{
-}
-
-auto ProofError::what() const noexcept -> const char *
-{
-    return _message.c_str();
-}
-
-#ifdef ORIGINAL
-struct Proof::Imp
-{
-    string opb_filename, log_filename;
-    stringstream model_stream, model_prelude_stream;
-    unique_ptr<ostream> proof_stream;
-    bool friendly_names;
-    bool bz2 = false;
-    bool super_extra_verbose = false;
-
-    map<pair<long, long>, string> variable_mappings;
-    map<long, string> binary_variable_mappings;
-    map<tuple<long, long, long>, string> connected_variable_mappings;
-    map<tuple<long, long, long, long>, string> connected_variable_mappings_aux;
-    map<long, long> at_least_one_value_constraints, at_most_one_value_constraints, injectivity_constraints;
-    map<tuple<long, long, long, long>, long> adjacency_lines;
-    map<pair<long, long>, long> eliminations;
-
-    #ifdef VECTOR
-    vector<vector<int>> non_edge_constraints;
-    #else
-    map<pair<long, long>, long> non_edge_constraints;
-    #endif
-    
-    long objective_line = 0;
-
-    long nb_constraints = 0;
-    long proof_line = 0;
-    int largest_level_set = 0;
-
-    bool clique_encoding = false;
-
-    bool doing_hom_colour_proof = false;
-    NamedVertex hom_colour_proof_p, hom_colour_proof_t;
-    vector<NamedVertex> p_clique;
-    map<int, NamedVertex> t_clique_neighbourhood;
-    map<pair<pair<NamedVertex, NamedVertex>, pair<NamedVertex, NamedVertex> >, long> clique_for_hom_non_edge_constraints;
-
-    vector<pair<int, int> > zero_in_proof_objectives;
-};
-
-Proof::Proof(const string & opb_file, const string & log_file, bool f, bool b, bool s) :
-    _imp(new Imp)
-{
-    _imp->opb_filename = opb_file;
-    _imp->log_filename = log_file;
-    _imp->friendly_names = f;
-    _imp->bz2 = b;
-    _imp->super_extra_verbose = s;
-}
-
-Proof::Proof(Proof &&) = default;
-
-Proof::~Proof() = default;
-
-auto Proof::operator= (Proof &&) -> Proof & = default;
-
-auto Proof::create_cp_variable(int pattern_vertex, int target_size,
-        const function<auto (int) -> string> & pattern_name,
-        const function<auto (int) -> string> & target_name) -> void
-{
-    for (int i = 0 ; i < target_size ; ++i)
-        if (_imp->friendly_names)
-            _imp->variable_mappings.emplace(pair{ pattern_vertex, i }, pattern_name(pattern_vertex) + "_" + target_name(i));
-        else
-            _imp->variable_mappings.emplace(pair{ pattern_vertex, i }, to_string(_imp->variable_mappings.size() + 1));
-
-    _imp->model_stream << "* vertex " << pattern_vertex << " domain" << endl;
-    for (int i = 0 ; i < target_size ; ++i)
-        _imp->model_stream << "1 x" << _imp->variable_mappings[{ pattern_vertex, i }] << " ";
-    _imp->model_stream << ">= 1 ;" << endl;
-    _imp->at_least_one_value_constraints.emplace(pattern_vertex, ++_imp->nb_constraints);
-
-    for (int i = 0 ; i < target_size ; ++i)
-        _imp->model_stream << "-1 x" << _imp->variable_mappings[{ pattern_vertex, i }] << " ";
-    _imp->model_stream << ">= -1 ;" << endl;
-    _imp->at_most_one_value_constraints.emplace(pattern_vertex, ++_imp->nb_constraints);
-}
-
-auto Proof::create_injectivity_constraints(int pattern_size, int target_size) -> void
-{
-    for (int v = 0 ; v < target_size ; ++v) {
-        _imp->model_stream << "* injectivity on value " << v << endl;
-
-        for (int p = 0 ; p < pattern_size ; ++p) {
-            auto x = _imp->variable_mappings.find(pair{ p, v });
-            if (x != _imp->variable_mappings.end())
-                _imp->model_stream << "-1 x" << x->second << " ";
-        }
-        _imp->model_stream << ">= -1 ;" << endl;
-        _imp->injectivity_constraints.emplace(v, ++_imp->nb_constraints);
-    }
-}
-
-auto Proof::create_forbidden_assignment_constraint(int p, int t) -> void
-{
-    _imp->model_stream << "* forbidden assignment" << endl;
-    _imp->model_stream << "1 ~x" << _imp->variable_mappings[pair{ p, t }] << " >= 1 ;" << endl;
-    ++_imp->nb_constraints;
-    _imp->eliminations.emplace(pair{ p, t }, _imp->nb_constraints);
-}
-
-auto Proof::start_adjacency_constraints_for(int p, int t) -> void
-{
-    _imp->model_stream << "* adjacency " << p << " maps to " << t << endl;
-}
-
-auto Proof::create_adjacency_constraint(int p, int q, int t, const vector<int> & uu, bool) -> void
-{
-    _imp->model_stream << "1 ~x" << _imp->variable_mappings[pair{ p, t }];
-    for (auto & u : uu)
-        _imp->model_stream << " 1 x" << _imp->variable_mappings[pair{ q, u }];
-    _imp->model_stream << " >= 1 ;" << endl;
-    _imp->adjacency_lines.emplace(tuple{ 0, p, q, t }, ++_imp->nb_constraints);
-}
-
-auto Proof::finalise_model() -> void
-{
-    unique_ptr<ostream> f = (_imp->bz2 ? make_compressed_ostream(_imp->opb_filename + ".bz2") : make_unique<ofstream>(_imp->opb_filename));
-
-    *f << "* #variable= " << (_imp->variable_mappings.size() + _imp->binary_variable_mappings.size()
-            + _imp->connected_variable_mappings.size() + _imp->connected_variable_mappings_aux.size())
-        << " #constraint= " << _imp->nb_constraints << endl;
-    copy(istreambuf_iterator<char>{ _imp->model_prelude_stream }, istreambuf_iterator<char>{}, ostreambuf_iterator<char>{ *f });
-    _imp->model_prelude_stream.clear();
-    copy(istreambuf_iterator<char>{ _imp->model_stream }, istreambuf_iterator<char>{}, ostreambuf_iterator<char>{ *f });
-    _imp->model_stream.clear();
-
-    if (! *f)
-        throw ProofError{ "Error writing opb file to '" + _imp->opb_filename + "'" };
-
-    _imp->proof_stream = (_imp->bz2 ? make_compressed_ostream(_imp->log_filename + ".bz2") : make_unique<ofstream>(_imp->log_filename));
-
-    *_imp->proof_stream << "pseudo-Boolean proof version 1.0" << endl;
-
-    *_imp->proof_stream << "f " << _imp->nb_constraints << " 0" << endl;
-    _imp->proof_line += _imp->nb_constraints;
-
-    if (! *_imp->proof_stream)
-        throw ProofError{ "Error writing proof file to '" + _imp->log_filename + "'" };
-}
-
-auto Proof::finish_unsat_proof() -> void
-{
-#ifndef COMMENTS
-    *_imp->proof_stream << "* asserting that we've proved unsat" << endl;
-#endif
-    *_imp->proof_stream << "u >= 1 ;" << endl;
-    ++_imp->proof_line;
-    *_imp->proof_stream << "c " << _imp->proof_line << " 0" << endl;
-}
-
-auto Proof::emit_hall_set_or_violator(const vector<NamedVertex> & lhs, const vector<NamedVertex> & rhs) -> void
-{
-    *_imp->proof_stream << "* hall set or violator {";
-    for (auto & l : lhs)
-        *_imp->proof_stream << " " << l.second;
-    *_imp->proof_stream << " } / {";
-    for (auto & r : rhs)
-        *_imp->proof_stream << " " << r.second;
-    *_imp->proof_stream << " }" << endl;
-    *_imp->proof_stream << "p";
-    bool first = true;
-    for (auto & l : lhs) {
-        if (first) {
-            first = false;
-            *_imp->proof_stream << " " << _imp->at_least_one_value_constraints[l.first];
-        }
-        else
-            *_imp->proof_stream << " " << _imp->at_least_one_value_constraints[l.first] << " +";
-    }
-    for (auto & r : rhs)
-        *_imp->proof_stream << " " << _imp->injectivity_constraints[r.first] << " +";
-    *_imp->proof_stream << " 0" << endl;
-    ++_imp->proof_line;
-}
-
-auto Proof::root_propagation_failed() -> void
-{
-    *_imp->proof_stream << "* root node propagation failed" << endl;
-}
-
-auto Proof::guessing(int depth, const NamedVertex & branch_v, const NamedVertex & val) -> void
-{
-    *_imp->proof_stream << "* [" << depth << "] guessing " << branch_v.second << "=" << val.second << endl;
-}
-
-auto Proof::propagation_failure(const vector<pair<int, int> > & decisions, const NamedVertex & branch_v, const NamedVertex & val) -> void
-{
-    *_imp->proof_stream << "* [" << decisions.size() << "] propagation failure on " << branch_v.second << "=" << val.second << endl;
-    *_imp->proof_stream << "u ";
-    for (auto & [ var, val ] : decisions)
-        *_imp->proof_stream << " 1 ~x" << _imp->variable_mappings[pair{ var, val }];
-    *_imp->proof_stream << " >= 1 ;" << endl;
-    ++_imp->proof_line;
-}
-
-auto Proof::incorrect_guess(const vector<pair<int, int> > & decisions, bool failure) -> void
-{
-    if (failure)
-        *_imp->proof_stream << "* [" << decisions.size() << "] incorrect guess" << endl;
-    else
-        *_imp->proof_stream << "* [" << decisions.size() << "] backtracking" << endl;
-
-    *_imp->proof_stream << "u";
-    for (auto & [ var, val ] : decisions)
-        *_imp->proof_stream << " 1 ~x" << _imp->variable_mappings[pair{ var, val }];
-    *_imp->proof_stream << " >= 1 ;" << endl;
-    ++_imp->proof_line;
-}
-
-auto Proof::out_of_guesses(const vector<pair<int, int> > &) -> void
-{
-}
-
-auto Proof::unit_propagating(const NamedVertex & var, const NamedVertex & val) -> void
-{
-    *_imp->proof_stream << "* unit propagating " << var.second << "=" << val.second << endl;
-}
-
-auto Proof::start_level(int l) -> void
-{
-    *_imp->proof_stream << "# " << l << endl;
-    _imp->largest_level_set = max(_imp->largest_level_set, l);
-}
-
-auto Proof::back_up_to_level(int l) -> void
-{
-    *_imp->proof_stream << "# " << l << endl;
-    _imp->largest_level_set = max(_imp->largest_level_set, l);
-}
-
-auto Proof::forget_level(int l) -> void
-{
-    if (_imp->largest_level_set >= l)
-        *_imp->proof_stream << "w " << l << endl;
-}
-
-auto Proof::back_up_to_top() -> void
-{
-    *_imp->proof_stream << "# " << 0 << endl;
-}
-
-auto Proof::post_restart_nogood(const vector<pair<int, int> > & decisions) -> void
-{
-    *_imp->proof_stream << "* [" << decisions.size() << "] restart nogood" << endl;
-    *_imp->proof_stream << "u";
-    for (auto & [ var, val ] : decisions)
-        *_imp->proof_stream << " 1 ~x" << _imp->variable_mappings[pair{ var, val }];
-    *_imp->proof_stream << " >= 1 ;" << endl;
-    ++_imp->proof_line;
-}
-
-auto Proof::post_solution(const vector<pair<NamedVertex, NamedVertex> > & decisions) -> void
-{
-    *_imp->proof_stream << "* found solution";
-    for (auto & [ var, val ] : decisions)
-        *_imp->proof_stream << " " << var.second << "=" << val.second;
-    *_imp->proof_stream << endl;
-
-    *_imp->proof_stream << "v";
-    for (auto & [ var, val ] : decisions)
-        *_imp->proof_stream << " x" << _imp->variable_mappings[pair{ var.first, val.first }];
-    *_imp->proof_stream << endl;
-    ++_imp->proof_line;
-}
-
-auto Proof::post_solution(const vector<int> & solution) -> void
-{
-    *_imp->proof_stream << "v";
-    for (auto & v : solution)
-        *_imp->proof_stream << " x" << _imp->binary_variable_mappings[v];
-    *_imp->proof_stream << endl;
-    ++_imp->proof_line;
-}
-
-auto Proof::new_incumbent(const vector<pair<int, bool> > & solution) -> void
-{
-    *_imp->proof_stream << "o";
-    for (auto & [ v, t ] : solution)
-        *_imp->proof_stream << " " << (t ? "" : "~") << "x" << _imp->binary_variable_mappings[v];
-    for (auto & [ v, w ] : _imp->zero_in_proof_objectives)
-        *_imp->proof_stream << " ~" << "x" << _imp->variable_mappings[pair{ v, w }];
-    *_imp->proof_stream << endl;
-    _imp->objective_line = ++_imp->proof_line;
-}
-
-auto Proof::new_incumbent(const vector<tuple<NamedVertex, NamedVertex, bool> > & decisions) -> void
-{
-    *_imp->proof_stream << "o";
-    for (auto & [ var, val, t ] : decisions)
-        *_imp->proof_stream << " " << (t ? "" : "~") << "x" << _imp->variable_mappings[pair{ var.first, val.first }];
-    *_imp->proof_stream << endl;
-    _imp->objective_line = ++_imp->proof_line;
-}
-
-auto Proof::create_binary_variable(int vertex,
-                const function<auto (int) -> string> & name) -> void
-{
-    if (_imp->friendly_names)
-        _imp->binary_variable_mappings.emplace(vertex, name(vertex));
-    else
-        _imp->binary_variable_mappings.emplace(vertex, to_string(_imp->binary_variable_mappings.size() + 1));
-}
-
-auto Proof::create_objective(int n, optional<int> d) -> void
-{
-    if (d) {
-        _imp->model_stream << "* objective" << endl;
-        for (int v = 0 ; v < n ; ++ v)
-            _imp->model_stream << "1 x" << _imp->binary_variable_mappings[v] << " ";
-        _imp->model_stream << ">= " << *d << ";" << endl;
-        _imp->objective_line = ++_imp->nb_constraints;
-    }
-    else {
-        _imp->model_prelude_stream << "min:";
-        for (int v = 0 ; v < n ; ++ v)
-            _imp->model_prelude_stream << " -1 x" << _imp->binary_variable_mappings[v];
-        _imp->model_prelude_stream << " ;" << endl;
-    }
-}
-
-#ifdef VECTOR
-auto Proof::create_non_edge_constraint_vector(int size) -> void
-{
-    vector<vector<int>> non_edges;
-    for (int i=0; i<size; i++) {
-        vector<int> single_row;
-        single_row.assign(size,0);
-        non_edges.push_back(single_row); 
-    }
-    _imp->non_edge_constraints = non_edges;
-}
-#endif
-
-auto Proof::create_non_edge_constraint(int p, int q) -> void
-{
-    _imp->model_stream << "-1 x" << _imp->binary_variable_mappings[p] << " -1 x" << _imp->binary_variable_mappings[q] << " >= -1 ;" << endl;
-
-    ++_imp->nb_constraints;
-    #ifdef VECTOR
-    _imp->non_edge_constraints[p][q] = _imp->nb_constraints;
-    _imp->non_edge_constraints[q][p] = _imp->nb_constraints;
-    #else
-    _imp->non_edge_constraints.emplace(pair{ p, q }, _imp->nb_constraints);
-    _imp->non_edge_constraints.emplace(pair{ q, p }, _imp->nb_constraints);
-    #endif
-}
-
-auto Proof::backtrack_from_binary_variables(const vector<int> & v) -> void
-{
-    if (! _imp->doing_hom_colour_proof) {
-        *_imp->proof_stream << "u";
-        for (auto & w : v)
-            *_imp->proof_stream << " 1 ~x" << _imp->binary_variable_mappings[w];
-        *_imp->proof_stream << " >= 1 ;" << endl;
-        ++_imp->proof_line;
-    }
-    else {
-#ifndef COMMENTS
-        *_imp->proof_stream << "* backtrack shenanigans, depth " << v.size() << endl;
-#endif
-        function<auto (unsigned, const vector<pair<int, int> > &) -> void> f;
-        f = [&] (unsigned d, const vector<pair<int, int> > & trail) -> void {
-            if (d == v.size()) {
-                *_imp->proof_stream << "u 1 ~x" << _imp->variable_mappings[pair{ _imp->hom_colour_proof_p.first, _imp->hom_colour_proof_t.first }];
-                for (auto & t : trail)
-                    *_imp->proof_stream << " 1 ~x" << _imp->variable_mappings[t];
-                *_imp->proof_stream << " >= 1 ;" << endl;
-                ++_imp->proof_line;
-            }
-            else {
-                for (auto & p : _imp->p_clique) {
-                    vector<pair<int, int> > new_trail{ trail };
-                    new_trail.emplace_back(pair{ p.first, _imp->t_clique_neighbourhood.find(v[d])->second.first });
-                    f(d + 1, new_trail);
-                }
-            }
-        };
-        f(0, {});
-    }
-}
-
-auto Proof::colour_bound(const vector<vector<int> > & ccs) -> void
-{
-#ifndef COMMENTS
-    *_imp->proof_stream << "* bound, ccs";
-    for (auto & cc : ccs) {
-        *_imp->proof_stream << " [";
-        for (auto & c : cc)
-            *_imp->proof_stream << " " << c;
-        *_imp->proof_stream << " ]";
-    }
-    *_imp->proof_stream << endl;
-#endif
-
-    vector<long> to_sum;
-    auto do_one_cc = [&] (const auto & cc, const auto & non_edge_constraint) {
-        if (cc.size() > 2) {
-            *_imp->proof_stream << "p " << non_edge_constraint(cc[0], cc[1]);
-
-            for (unsigned i = 2 ; i < cc.size() ; ++i) {
-                *_imp->proof_stream << " " << i << " *";
-                for (unsigned j = 0 ; j < i ; ++j)
-                    *_imp->proof_stream << " " << non_edge_constraint(cc[i], cc[j]) << " +";
-                *_imp->proof_stream << " " << (i + 1) << " d";
-            }
-
-            *_imp->proof_stream << endl;
-            to_sum.push_back(++_imp->proof_line);
-        }
-        else if (cc.size() == 2) {
-            to_sum.push_back(non_edge_constraint(cc[0], cc[1]));
-        }
-    };
-
-    for (auto & cc : ccs) {
-        if (_imp->doing_hom_colour_proof) {
-            vector<pair<NamedVertex, NamedVertex> > bigger_cc;
-            for (auto & c : cc)
-                for (auto & v : _imp->p_clique)
-                    bigger_cc.push_back(pair{ v, _imp->t_clique_neighbourhood.find(c)->second });
-
-            *_imp->proof_stream << "* colour class [";
-            for (auto & c : bigger_cc)
-                *_imp->proof_stream << " " << c.first.second << "/" << c.second.second;
-            *_imp->proof_stream << " ]" << endl;
-
-            do_one_cc(bigger_cc, [&] (const pair<NamedVertex, NamedVertex> & a, const pair<NamedVertex, NamedVertex> & b) -> long {
-                    return _imp->clique_for_hom_non_edge_constraints[pair{ a, b }];
-                    });
-        }
-        else {
-#ifdef VECTOR
-            do_one_cc(cc, [&] (int a, int b) -> long { return _imp->non_edge_constraints[a][b]; });
-#else
-            do_one_cc(cc, [&] (int a, int b) -> long { return _imp->non_edge_constraints[pair{ a, b }]; });
-#endif
-        }
-
-#ifdef COLOUR
-        if (cc.size() != 1) {
-            *_imp->proof_stream << "p " << _imp->objective_line;
-            for (auto & t : to_sum)
-                *_imp->proof_stream << " " << t << " +";
-            *_imp->proof_stream << endl;
-            ++_imp->proof_line;
-        }
-#else
-        *_imp->proof_stream << "p " << _imp->objective_line;
-        for (auto & t : to_sum)
-            *_imp->proof_stream << " " << t << " +";
-        *_imp->proof_stream << endl;
-        ++_imp->proof_line;
-#endif
-    }
-}
-
-auto Proof::prepare_hom_clique_proof(const NamedVertex & p, const NamedVertex & t, unsigned size) -> void
-{
-    *_imp->proof_stream << "* clique of size " << size << " around neighbourhood of " << p.second << " but not " << t.second << endl;
-    *_imp->proof_stream << "# 1" << endl;
-    _imp->doing_hom_colour_proof = true;
-    _imp->hom_colour_proof_p = p;
-    _imp->hom_colour_proof_t = t;
-}
-
-auto Proof::start_hom_clique_proof(const NamedVertex & p, vector<NamedVertex> && p_clique, const NamedVertex & t, map<int, NamedVertex> && t_clique_neighbourhood) -> void
-{
-    _imp->p_clique = move(p_clique);
-    _imp->t_clique_neighbourhood = move(t_clique_neighbourhood);
-
-    *_imp->proof_stream << "* hom clique objective" << endl;
-    vector<long> to_sum;
-    for (auto & q : _imp->p_clique) {
-        *_imp->proof_stream << "u 1 ~x" << _imp->variable_mappings[pair{ p.first, t.first }];
-        for (auto & u : _imp->t_clique_neighbourhood)
-            *_imp->proof_stream << " 1 x" << _imp->variable_mappings[pair{ q.first, u.second.first }];
-        *_imp->proof_stream << " >= 1 ;" << endl;
-        to_sum.push_back(++_imp->proof_line);
-    }
-
-    *_imp->proof_stream << "p";
-    bool first = true;
-    for (auto & t : to_sum) {
-        *_imp->proof_stream << " " << t;
-        if (! first)
-            *_imp->proof_stream << " +";
-        first = false;
-    }
-    *_imp->proof_stream << endl;
-    _imp->objective_line = ++_imp->proof_line;
-
-    *_imp->proof_stream << "* hom clique non edges for injectivity" << endl;
-
-    for (auto & p : _imp->p_clique)
-        for (auto & q : _imp->p_clique)
-            if (p != q) {
-                for (auto & [ _, t ] : _imp->t_clique_neighbourhood) {
-                    *_imp->proof_stream << "u 1 ~x" << _imp->variable_mappings[pair{ p.first, t.first }] << " 1 ~x" << _imp->variable_mappings[pair{ q.first, t.first }] << " >= 1 ;" << endl;
-                    ++_imp->proof_line;
-                    _imp->clique_for_hom_non_edge_constraints.emplace(pair{ pair{ p, t }, pair{ q, t } }, _imp->proof_line);
-                    _imp->clique_for_hom_non_edge_constraints.emplace(pair{ pair{ q, t }, pair{ p, t } }, _imp->proof_line);
-                }
-            }
-
-    *_imp->proof_stream << "* hom clique non edges for variables" << endl;
-
-    for (auto & p : _imp->p_clique)
-        for (auto & [ _, t ] : _imp->t_clique_neighbourhood) {
-            for (auto & [ _, u ] : _imp->t_clique_neighbourhood) {
-                if (t != u) {
-                    *_imp->proof_stream << "u 1 ~x" << _imp->variable_mappings[pair{ p.first, t.first }] << " 1 ~x" << _imp->variable_mappings[pair{ p.first, u.first }] << " >= 1 ;" << endl;
-                    ++_imp->proof_line;
-                    _imp->clique_for_hom_non_edge_constraints.emplace(pair{ pair{ p, t }, pair{ p, u } }, _imp->proof_line);
-                    _imp->clique_for_hom_non_edge_constraints.emplace(pair{ pair{ p, u }, pair{ p, t } }, _imp->proof_line);
-                }
-            }
-        }
-}
-
-auto Proof::finish_hom_clique_proof(const NamedVertex & p, const NamedVertex & t, unsigned size) -> void
-{
-    *_imp->proof_stream << "* end clique of size " << size << " around neighbourhood of " << p.second << " but not " << t.second << endl;
-    *_imp->proof_stream << "# 0" << endl;
-    *_imp->proof_stream << "u 1 ~x" << _imp->variable_mappings[pair{ p.first, t.first }] << " >= 1 ;" << endl;
-    *_imp->proof_stream << "w 1" << endl;
-    ++_imp->proof_line;
-    _imp->doing_hom_colour_proof = false;
-    _imp->clique_for_hom_non_edge_constraints.clear();
-}
-
-auto Proof::add_hom_clique_non_edge(
-        const NamedVertex & pp,
-        const NamedVertex & tt,
-        const std::vector<NamedVertex> & p_clique,
-        const NamedVertex & t,
-        const NamedVertex & u) -> void
-{
-    *_imp->proof_stream << "* hom clique non edges for " << t.second << " " << u.second << endl;
-    for (auto & p : p_clique) {
-        for (auto & q : p_clique) {
-            if (p != q) {
-                *_imp->proof_stream << "u 1 ~x" << _imp->variable_mappings[pair{ pp.first, tt.first }]
-                    << " 1 ~x" << _imp->variable_mappings[pair{ p.first, t.first }]
-                    << " 1 ~x" << _imp->variable_mappings[pair{ q.first, u.first }] << " >= 1 ;" << endl;
-                ++_imp->proof_line;
-                _imp->clique_for_hom_non_edge_constraints.emplace(pair{ pair{ p, t }, pair{ q, u } }, _imp->proof_line);
-                _imp->clique_for_hom_non_edge_constraints.emplace(pair{ pair{ q, u }, pair{ p, t } }, _imp->proof_line);
-            }
-        }
-    }
-}
-
-auto Proof::not_connected_in_underlying_graph(const std::vector<int> & x, int y) -> void
-{
-    *_imp->proof_stream << "u 1 ~x" << _imp->binary_variable_mappings[y];
-    for (auto & v : x)
-        *_imp->proof_stream << " 1 ~x" << _imp->binary_variable_mappings[v];
-    *_imp->proof_stream << " >= 1 ;" << endl;
-    ++_imp->proof_line;
-}
-
-auto Proof::has_clique_model() const -> bool
-{
-    return _imp->clique_encoding;
-}
-
-auto Proof::create_clique_encoding(
-        const vector<pair<int, int> > & enc,
-        const vector<pair<int, int> > & zero_in_proof_objectives) -> void
-{
-    _imp->clique_encoding = true;
-    for (unsigned i = 0 ; i < enc.size() ; ++i)
-        _imp->binary_variable_mappings.emplace(i, _imp->variable_mappings[enc[i]]);
-
-    _imp->zero_in_proof_objectives = zero_in_proof_objectives;
-}
-
-auto Proof::super_extra_verbose() const -> bool
-{
-    return _imp->super_extra_verbose;
-}
-
-auto Proof::show_domains(const string & s, const std::vector<std::pair<NamedVertex, std::vector<NamedVertex> > > & domains) -> void
-{
-    *_imp->proof_stream << "* " << s << ", domains follow" << endl;
-    for (auto & [ p, ts ] : domains) {
-        *_imp->proof_stream << "*    " << p.second << " size " << ts.size() << " = {";
-        for (auto & t : ts)
-            *_imp->proof_stream << " " << t.second;
-        *_imp->proof_stream << " }" << endl;
-    }
-}
-
-auto Proof::propagated(const NamedVertex & p, const NamedVertex & t, int g, int n_values, const NamedVertex & q) -> void
-{
-    *_imp->proof_stream << "* adjacency propagation from " << p.second << " -> " << t.second << " in graph pairs " << g << " deleted " << n_values << " values from " << q.second << endl;
-}
-#endif
-
-#ifdef NEWLINE
-struct Proof::Imp
-{
-    string opb_filename, log_filename;
-    stringstream model_stream, model_prelude_stream;
-    unique_ptr<ostream> proof_stream;
-    bool friendly_names;
-    bool bz2 = false;
-    bool super_extra_verbose = false;
-
-    map<pair<long, long>, string> variable_mappings;
-    map<long, string> binary_variable_mappings;
-    map<tuple<long, long, long>, string> connected_variable_mappings;
-    map<tuple<long, long, long, long>, string> connected_variable_mappings_aux;
-    map<long, long> at_least_one_value_constraints, at_most_one_value_constraints, injectivity_constraints;
-    map<tuple<long, long, long, long>, long> adjacency_lines;
-    map<pair<long, long>, long> eliminations;
-
-    map<pair<long, long>, long> non_edge_constraints;
-
-    long objective_line = 0;
-
-    long nb_constraints = 0;
-    long proof_line = 0;
-    int largest_level_set = 0;
-
-    bool clique_encoding = false;
-
-    bool doing_hom_colour_proof = false;
-    NamedVertex hom_colour_proof_p, hom_colour_proof_t;
-    vector<NamedVertex> p_clique;
-    map<int, NamedVertex> t_clique_neighbourhood;
-    map<pair<pair<NamedVertex, NamedVertex>, pair<NamedVertex, NamedVertex> >, long> clique_for_hom_non_edge_constraints;
-
-    vector<pair<int, int> > zero_in_proof_objectives;
-};
-
-Proof::Proof(const string & opb_file, const string & log_file, bool f, bool b, bool s) :
-    _imp(new Imp)
-{
-    _imp->opb_filename = opb_file;
-    _imp->log_filename = log_file;
-    _imp->friendly_names = f;
-    _imp->bz2 = b;
-    _imp->super_extra_verbose = s;
-}
-
-Proof::Proof(Proof &&) = default;
-
-Proof::~Proof() = default;
-
-auto Proof::operator= (Proof &&) -> Proof & = default;
-
-auto Proof::create_cp_variable(int pattern_vertex, int target_size,
-        const function<auto (int) -> string> & pattern_name,
-        const function<auto (int) -> string> & target_name) -> void
-{
-    for (int i = 0 ; i < target_size ; ++i)
-        if (_imp->friendly_names)
-            _imp->variable_mappings.emplace(pair{ pattern_vertex, i }, pattern_name(pattern_vertex) + "_" + target_name(i));
-        else
-            _imp->variable_mappings.emplace(pair{ pattern_vertex, i }, to_string(_imp->variable_mappings.size() + 1));
-
-    _imp->model_stream << "* vertex " << pattern_vertex << " domain" << "\n";
-    for (int i = 0 ; i < target_size ; ++i)
-        _imp->model_stream << "1 x" << _imp->variable_mappings[{ pattern_vertex, i }] << " ";
-    _imp->model_stream << ">= 1 ;" << "\n";
-    _imp->at_least_one_value_constraints.emplace(pattern_vertex, ++_imp->nb_constraints);
-
-    for (int i = 0 ; i < target_size ; ++i)
-        _imp->model_stream << "-1 x" << _imp->variable_mappings[{ pattern_vertex, i }] << " ";
-    _imp->model_stream << ">= -1 ;" << "\n";
-    _imp->at_most_one_value_constraints.emplace(pattern_vertex, ++_imp->nb_constraints);
-}
-
-auto Proof::create_injectivity_constraints(int pattern_size, int target_size) -> void
-{
-    for (int v = 0 ; v < target_size ; ++v) {
-        _imp->model_stream << "* injectivity on value " << v << "\n";
-
-        for (int p = 0 ; p < pattern_size ; ++p) {
-            auto x = _imp->variable_mappings.find(pair{ p, v });
-            if (x != _imp->variable_mappings.end())
-                _imp->model_stream << "-1 x" << x->second << " ";
-        }
-        _imp->model_stream << ">= -1 ;" << "\n";
-        _imp->injectivity_constraints.emplace(v, ++_imp->nb_constraints);
-    }
-}
-
-auto Proof::create_forbidden_assignment_constraint(int p, int t) -> void
-{
-    _imp->model_stream << "* forbidden assignment" << "\n";
-    _imp->model_stream << "1 ~x" << _imp->variable_mappings[pair{ p, t }] << " >= 1 ;" << "\n";
-    ++_imp->nb_constraints;
-    _imp->eliminations.emplace(pair{ p, t }, _imp->nb_constraints);
-}
-
-auto Proof::start_adjacency_constraints_for(int p, int t) -> void
-{
-    _imp->model_stream << "* adjacency " << p << " maps to " << t << "\n";
-}
-
-auto Proof::create_adjacency_constraint(int p, int q, int t, const vector<int> & uu, bool) -> void
-{
-    _imp->model_stream << "1 ~x" << _imp->variable_mappings[pair{ p, t }];
-    for (auto & u : uu)
-        _imp->model_stream << " 1 x" << _imp->variable_mappings[pair{ q, u }];
-    _imp->model_stream << " >= 1 ;" << "\n";
-    _imp->adjacency_lines.emplace(tuple{ 0, p, q, t }, ++_imp->nb_constraints);
-}
-
-auto Proof::finalise_model() -> void
-{
-    unique_ptr<ostream> f = (_imp->bz2 ? make_compressed_ostream(_imp->opb_filename + ".bz2") : make_unique<ofstream>(_imp->opb_filename));
-
-    *f << "* #variable= " << (_imp->variable_mappings.size() + _imp->binary_variable_mappings.size()
-            + _imp->connected_variable_mappings.size() + _imp->connected_variable_mappings_aux.size())
-        << " #constraint= " << _imp->nb_constraints << "\n";
-    copy(istreambuf_iterator<char>{ _imp->model_prelude_stream }, istreambuf_iterator<char>{}, ostreambuf_iterator<char>{ *f });
-    _imp->model_prelude_stream.clear();
-    copy(istreambuf_iterator<char>{ _imp->model_stream }, istreambuf_iterator<char>{}, ostreambuf_iterator<char>{ *f });
-    _imp->model_stream.clear();
-
-    if (! *f)
-        throw ProofError{ "Error writing opb file to '" + _imp->opb_filename + "'" };
-
-    _imp->proof_stream = (_imp->bz2 ? make_compressed_ostream(_imp->log_filename + ".bz2") : make_unique<ofstream>(_imp->log_filename));
-
-    *_imp->proof_stream << "pseudo-Boolean proof version 1.0" << "\n";
-
-    *_imp->proof_stream << "f " << _imp->nb_constraints << " 0" << "\n";
-    _imp->proof_line += _imp->nb_constraints;
-
-    if (! *_imp->proof_stream)
-        throw ProofError{ "Error writing proof file to '" + _imp->log_filename + "'" };
-}
-
-auto Proof::finish_unsat_proof() -> void
-{
-#ifndef MAX
-    *_imp->proof_stream << "* asserting that we've proved unsat" << "\n";
-#endif
-    *_imp->proof_stream << "u >= 1 ;" << "\n";
-    ++_imp->proof_line;
-    *_imp->proof_stream << "c " << _imp->proof_line << " 0" << "\n";
-}
-
-auto Proof::emit_hall_set_or_violator(const vector<NamedVertex> & lhs, const vector<NamedVertex> & rhs) -> void
-{
-    *_imp->proof_stream << "* hall set or violator {";
-    for (auto & l : lhs)
-        *_imp->proof_stream << " " << l.second;
-    *_imp->proof_stream << " } / {";
-    for (auto & r : rhs)
-        *_imp->proof_stream << " " << r.second;
-    *_imp->proof_stream << " }" << "\n";
-    *_imp->proof_stream << "p";
-    bool first = true;
-    for (auto & l : lhs) {
-        if (first) {
-            first = false;
-            *_imp->proof_stream << " " << _imp->at_least_one_value_constraints[l.first];
-        }
-        else
-            *_imp->proof_stream << " " << _imp->at_least_one_value_constraints[l.first] << " +";
-    }
-    for (auto & r : rhs)
-        *_imp->proof_stream << " " << _imp->injectivity_constraints[r.first] << " +";
-    *_imp->proof_stream << " 0" << "\n";
-    ++_imp->proof_line;
-}
-
-auto Proof::root_propagation_failed() -> void
-{
-    *_imp->proof_stream << "* root node propagation failed" << "\n";
-}
-
-auto Proof::guessing(int depth, const NamedVertex & branch_v, const NamedVertex & val) -> void
-{
-    *_imp->proof_stream << "* [" << depth << "] guessing " << branch_v.second << "=" << val.second << "\n";
-}
-
-auto Proof::propagation_failure(const vector<pair<int, int> > & decisions, const NamedVertex & branch_v, const NamedVertex & val) -> void
-{
-    *_imp->proof_stream << "* [" << decisions.size() << "] propagation failure on " << branch_v.second << "=" << val.second << "\n";
-    *_imp->proof_stream << "u ";
-    for (auto & [ var, val ] : decisions)
-        *_imp->proof_stream << " 1 ~x" << _imp->variable_mappings[pair{ var, val }];
-    *_imp->proof_stream << " >= 1 ;" << "\n";
-    ++_imp->proof_line;
-}
-
-auto Proof::incorrect_guess(const vector<pair<int, int> > & decisions, bool failure) -> void
-{
-    if (failure)
-        *_imp->proof_stream << "* [" << decisions.size() << "] incorrect guess" << "\n";
-    else
-        *_imp->proof_stream << "* [" << decisions.size() << "] backtracking" << "\n";
-
-    *_imp->proof_stream << "u";
-    for (auto & [ var, val ] : decisions)
-        *_imp->proof_stream << " 1 ~x" << _imp->variable_mappings[pair{ var, val }];
-    *_imp->proof_stream << " >= 1 ;" << "\n";
-    ++_imp->proof_line;
-}
-
-auto Proof::out_of_guesses(const vector<pair<int, int> > &) -> void
-{
-}
-
-auto Proof::unit_propagating(const NamedVertex & var, const NamedVertex & val) -> void
-{
-    *_imp->proof_stream << "* unit propagating " << var.second << "=" << val.second << "\n";
-}
-
-auto Proof::start_level(int l) -> void
+namespace
 {
-    *_imp->proof_stream << "# " << l << "\n";
-    _imp->largest_level_set = max(_imp->largest_level_set, l);
-}
+    struct ProofState
+    {
+        string opb_filename, log_filename;
+        stringstream model_stream, model_prelude_stream;
+        unique_ptr<ostream> model_file;
+        long declared_variables = 0, declared_constraints = 0;
+        bool friendly_names = false;
+        ProofCompression compression = ProofCompression::None;
+        int compression_level = 0;
+        unsigned compression_threads = 0;
+        bool async = false;
+        ProofSink sink = ProofSink::IOStreamEndl;
+        bool super_extra_verbose = false;
+
+        map<pair<long, long>, string> variable_mappings;
+        map<long, string> binary_variable_mappings;
+        LiteralTokens literal_tokens;
+        map<tuple<long, long, long>, string> connected_variable_mappings;
+        map<tuple<long, long, long, long>, string> connected_variable_mappings_aux;
+        map<long, long> at_least_one_value_constraints, at_most_one_value_constraints, injectivity_constraints;
+        map<tuple<long, long, long, long>, long> adjacency_lines;
+        map<pair<long, long>, long> eliminations;
+
+        long objective_line = 0;
+
+        long nb_constraints = 0;
+        long proof_line = 0;
+        int largest_level_set = 0;
+
+        bool clique_encoding = false;
+
+        bool doing_hom_colour_proof = false;
+        NamedVertex hom_colour_proof_p, hom_colour_proof_t;
+        vector<NamedVertex> p_clique;
+        map<int, NamedVertex> t_clique_neighbourhood;
+        map<pair<pair<NamedVertex, NamedVertex>, pair<NamedVertex, NamedVertex> >, long> clique_for_hom_non_edge_constraints;
+
+        vector<pair<int, int> > zero_in_proof_objectives;
+
+        auto number_of_variables() const -> long
+        {
+            return variable_mappings.size() + binary_variable_mappings.size()
+                + connected_variable_mappings.size() + connected_variable_mappings_aux.size();
+        }
 
-auto Proof::back_up_to_level(int l) -> void
-{
-    *_imp->proof_stream << "# " << l << "\n";
-    _imp->largest_level_set = max(_imp->largest_level_set, l);
-}
+        /// Where model constraints go: straight to the file if start_model()
+        /// has been called, and otherwise to a buffer until finalise_model()
+        auto model() -> ostream &
+        {
+            return model_file ? *model_file : model_stream;
+        }
 
-auto Proof::forget_level(int l) -> void
-{
-    if (_imp->largest_level_set >= l)
-        *_imp->proof_stream << "w " << l << "\n";
-}
+        /// Where the objective goes, which must come before any constraints
+        auto model_prelude() -> ostream &
+        {
+            if (! model_file)
+                return model_prelude_stream;
+            else if (0 != nb_constraints)
+                throw ProofError{ "the objective must be written before any constraints when streaming the model" };
+            else
+                return *model_file;
+        }
 
-auto Proof::back_up_to_top() -> void
-{
-    *_imp->proof_stream << "# " << 0 << "\n";
-}
+        auto open_output(const string & filename, bool raw) -> unique_ptr<ostream>
+        {
+            unique_ptr<ostream> result;
+            if (compression != ProofCompression::None)
+                result = make_unique<ParallelCompressingStream>(make_unique<ofstream>(filename + compressed_filename_suffix(compression)),
+                        compression, compression_level, compression_threads);
+            else if (raw)
+                result = make_unique<FileDescriptorStream>(filename);
+            else
+                result = make_unique<ofstream>(filename);
+
+            if (async)
+                result = make_unique<AsyncProofStream>(move(result));
+            return result;
+        }
+    };
 
-auto Proof::post_restart_nogood(const vector<pair<int, int> > & decisions) -> void
-{
-    *_imp->proof_stream << "* [" << decisions.size() << "] restart nogood" << "\n";
-    *_imp->proof_stream << "u";
-    for (auto & [ var, val ] : decisions)
-        *_imp->proof_stream << " 1 ~x" << _imp->variable_mappings[pair{ var, val }];
-    *_imp->proof_stream << " >= 1 ;" << "\n";
-    ++_imp->proof_line;
-}
+    // push everything through to the file, so that any errors show up now
+    auto close_output(ostream & s) -> void
+    {
+        if (auto a = dynamic_cast<AsyncProofStream *>(&s))
+            a->close();
+        else if (auto c = dynamic_cast<ParallelCompressingStream *>(&s))
+            c->close();
+        else
+            s.flush();
+    }
 
-auto Proof::post_solution(const vector<pair<NamedVertex, NamedVertex> > & decisions) -> void
-{
-    *_imp->proof_stream << "* found solution";
-    for (auto & [ var, val ] : decisions)
-        *_imp->proof_stream << " " << var.second << "=" << val.second;
-    *_imp->proof_stream << "\n";
+    class NonEdgeConstraintMap
+    {
+        private:
+            map<pair<long, long>, long> _lines;
+
+        public:
+            auto add(int p, int q, long line, int) -> void
+            {
+                _lines.emplace(pair{ p, q }, line);
+                _lines.emplace(pair{ q, p }, line);
+            }
 
-    *_imp->proof_stream << "v";
-    for (auto & [ var, val ] : decisions)
-        *_imp->proof_stream << " x" << _imp->variable_mappings[pair{ var.first, val.first }];
-    *_imp->proof_stream << "\n";
-    ++_imp->proof_line;
-}
+            auto operator() (int a, int b) -> long
+            {
+                return _lines[pair{ a, b }];
+            }
+    };
 
-auto Proof::post_solution(const vector<int> & solution) -> void
-{
-    *_imp->proof_stream << "v";
-    for (auto & v : solution)
-        *_imp->proof_stream << " x" << _imp->binary_variable_mappings[v];
-    *_imp->proof_stream << "\n";
-    ++_imp->proof_line;
-}
+    /**
+     * Non-edge constraint IDs, looked up in O(1) from a flat lower triangle
+     * of 32-bit IDs, indexed by i(i-1)/2 + j for i > j, with zero for edges.
+     *
+     * If the triangle would be too big, we instead rely upon the constraints
+     * being created row by row (as solve_clique_problem does), with
+     * consecutive IDs within each row. Then we only need each row's base ID,
+     * and a sorted list of the columns skipped in that row (that is, the
+     * edges), giving O(n + m) space and a binary search per lookup.
+     */
+    class NonEdgeConstraintTable
+    {
+        private:
+            static constexpr size_t max_dense_entries = size_t(1) << 26;
 
-auto Proof::new_incumbent(const vector<pair<int, bool> > & solution) -> void
-{
-    *_imp->proof_stream << "o";
-    for (auto & [ v, t ] : solution)
-        *_imp->proof_stream << " " << (t ? "" : "~") << "x" << _imp->binary_variable_mappings[v];
-    for (auto & [ v, w ] : _imp->zero_in_proof_objectives)
-        *_imp->proof_stream << " ~" << "x" << _imp->variable_mappings[pair{ v, w }];
-    *_imp->proof_stream << "\n";
-    _imp->objective_line = ++_imp->proof_line;
-}
+            bool _dense = true;
+            vector<uint32_t> _triangle;
 
-auto Proof::new_incumbent(const vector<tuple<NamedVertex, NamedVertex, bool> > & decisions) -> void
-{
-    *_imp->proof_stream << "o";
-    for (auto & [ var, val, t ] : decisions)
-        *_imp->proof_stream << " " << (t ? "" : "~") << "x" << _imp->variable_mappings[pair{ var.first, val.first }];
-    *_imp->proof_stream << "\n";
-    _imp->objective_line = ++_imp->proof_line;
-}
+            vector<long> _row_base;
+            vector<size_t> _row_skipped_start;
+            vector<uint32_t> _skipped;
+            int _current_row = -1, _next_column = 0;
 
-auto Proof::create_binary_variable(int vertex,
-                const function<auto (int) -> string> & name) -> void
-{
-    if (_imp->friendly_names)
-        _imp->binary_variable_mappings.emplace(vertex, name(vertex));
-    else
-        _imp->binary_variable_mappings.emplace(vertex, to_string(_imp->binary_variable_mappings.size() + 1));
-}
+            static auto triangle_index(size_t i, size_t j) -> size_t
+            {
+                return i * (i - 1) / 2 + j;
+            }
 
-auto Proof::create_objective(int n, optional<int> d) -> void
-{
-    if (d) {
-        _imp->model_stream << "* objective" << "\n";
-        for (int v = 0 ; v < n ; ++ v)
-            _imp->model_stream << "1 x" << _imp->binary_variable_mappings[v] << " ";
-        _imp->model_stream << ">= " << *d << ";" << "\n";
-        _imp->objective_line = ++_imp->nb_constraints;
-    }
-    else {
-        _imp->model_prelude_stream << "min:";
-        for (int v = 0 ; v < n ; ++ v)
-            _imp->model_prelude_stream << " -1 x" << _imp->binary_variable_mappings[v];
-        _imp->model_prelude_stream << " ;" << "\n";
-    }
-}
+            auto skip_to(int j) -> void
+            {
+                for ( ; _next_column < j ; ++_next_column)
+                    _skipped.push_back(_next_column);
+            }
 
-auto Proof::create_non_edge_constraint(int p, int q) -> void
-{
-    _imp->model_stream << "-1 x" << _imp->binary_variable_mappings[p] << " -1 x" << _imp->binary_variable_mappings[q] << " >= -1 ;" << "\n";
+            auto add_sparse(int i, int j, long line) -> void
+            {
+                if (i < _current_row || (i == _current_row && j < _next_column))
+                    throw ProofError{ "non-edge constraints for large graphs must be created in order" };
+
+                while (_current_row < i) {
+                    if (_current_row >= 0)
+                        skip_to(_current_row);
+                    ++_current_row;
+                    _next_column = 0;
+                    _row_base.push_back(0);
+                    _row_skipped_start.push_back(_skipped.size());
+                }
 
-    ++_imp->nb_constraints;
-    _imp->non_edge_constraints.emplace(pair{ p, q }, _imp->nb_constraints);
-    _imp->non_edge_constraints.emplace(pair{ q, p }, _imp->nb_constraints);
-}
+                bool first_in_row = (_row_skipped_start[i] == _skipped.size() && _next_column == 0);
+                skip_to(j);
+                long rank = j - long(_skipped.size() - _row_skipped_start[i]);
+                if (first_in_row)
+                    _row_base[i] = line - rank;
+                else if (_row_base[i] + rank != line)
+                    throw ProofError{ "non-edge constraints for large graphs must have consecutive IDs" };
+                _next_column = j + 1;
+            }
 
-auto Proof::backtrack_from_binary_variables(const vector<int> & v) -> void
-{
-    if (! _imp->doing_hom_colour_proof) {
-        *_imp->proof_stream << "u";
-        for (auto & w : v)
-            *_imp->proof_stream << " 1 ~x" << _imp->binary_variable_mappings[w];
-        *_imp->proof_stream << " >= 1 ;" << "\n";
-        ++_imp->proof_line;
-    }
-    else {
-#ifndef MAX
-        *_imp->proof_stream << "* backtrack shenanigans, depth " << v.size() << "\n";
-#endif
-        function<auto (unsigned, const vector<pair<int, int> > &) -> void> f;
-        f = [&] (unsigned d, const vector<pair<int, int> > & trail) -> void {
-            if (d == v.size()) {
-                *_imp->proof_stream << "u 1 ~x" << _imp->variable_mappings[pair{ _imp->hom_colour_proof_p.first, _imp->hom_colour_proof_t.first }];
-                for (auto & t : trail)
-                    *_imp->proof_stream << " 1 ~x" << _imp->variable_mappings[t];
-                *_imp->proof_stream << " >= 1 ;" << "\n";
-                ++_imp->proof_line;
+            auto get_sparse(int i, int j) const -> long
+            {
+                if (i >= int(_row_base.size()) || (i == _current_row && j >= _next_column))
+                    return 0;
+
+                auto begin = _skipped.begin() + _row_skipped_start[i];
+                auto end = (i + 1 < int(_row_base.size())) ? _skipped.begin() + _row_skipped_start[i + 1] : _skipped.end();
+                auto s = lower_bound(begin, end, uint32_t(j));
+                if (s != end && *s == uint32_t(j))
+                    return 0;
+                return _row_base[i] + j - (s - begin);
             }
-            else {
-                for (auto & p : _imp->p_clique) {
-                    vector<pair<int, int> > new_trail{ trail };
-                    new_trail.emplace_back(pair{ p.first, _imp->t_clique_neighbourhood.find(v[d])->second.first });
-                    f(d + 1, new_trail);
+
+        public:
+            auto add(int p, int q, long line, int size) -> void
+            {
+                int i = max(p, q), j = min(p, q);
+
+                if (_triangle.empty() && _row_base.empty()) {
+                    size_t entries = triangle_index(size, 0);
+                    _dense = entries <= max_dense_entries;
+                    if (_dense)
+                        _triangle.assign(entries, 0);
                 }
-            }
-        };
-        f(0, {});
-    }
-}
 
-auto Proof::colour_bound(const vector<vector<int> > & ccs) -> void
-{
-#ifndef MAX
-    *_imp->proof_stream << "* bound, ccs";
-    for (auto & cc : ccs) {
-        *_imp->proof_stream << " [";
-        for (auto & c : cc)
-            *_imp->proof_stream << " " << c;
-        *_imp->proof_stream << " ]";
-    }
-    *_imp->proof_stream << "\n";
-#endif
+                if (! _dense)
+                    add_sparse(i, j, line);
+                else if (line > long(numeric_limits<uint32_t>::max()))
+                    throw ProofError{ "too many constraints for a 32-bit non-edge constraint table" };
+                else
+                    _triangle[triangle_index(i, j)] = line;
+            }
 
-    vector<long> to_sum;
-    auto do_one_cc = [&] (const auto & cc, const auto & non_edge_constraint) {
-        if (cc.size() > 2) {
-            *_imp->proof_stream << "p " << non_edge_constraint(cc[0], cc[1]);
-
-            for (unsigned i = 2 ; i < cc.size() ; ++i) {
-                *_imp->proof_stream << " " << i << " *";
-                for (unsigned j = 0 ; j < i ; ++j)
-                    *_imp->proof_stream << " " << non_edge_constraint(cc[i], cc[j]) << " +";
-                *_imp->proof_stream << " " << (i + 1) << " d";
+            auto operator() (int a, int b) const -> long
+            {
+                int i = max(a, b), j = min(a, b);
+                if (_dense)
+                    return _triangle[triangle_index(i, j)];
+                else
+                    return get_sparse(i, j);
             }
+    };
 
-            *_imp->proof_stream << "\n";
-            to_sum.push_back(++_imp->proof_line);
-        }
-        else if (cc.size() == 2) {
-            to_sum.push_back(non_edge_constraint(cc[0], cc[1]));
-        }
+    template <bool comments_, bool skip_singleton_colour_classes_, bool dense_constraint_ids_>
+    struct ProofTraits
+    {
+        static constexpr bool comments = comments_;
+        static constexpr bool skip_singleton_colour_classes = skip_singleton_colour_classes_;
+        using NonEdgeConstraints = conditional_t<dense_constraint_ids_, NonEdgeConstraintTable, NonEdgeConstraintMap>;
     };
 
-    for (auto & cc : ccs) {
-        if (_imp->doing_hom_colour_proof) {
-            vector<pair<NamedVertex, NamedVertex> > bigger_cc;
-            for (auto & c : cc)
-                for (auto & v : _imp->p_clique)
-                    bigger_cc.push_back(pair{ v, _imp->t_clique_neighbourhood.find(c)->second });
-
-            *_imp->proof_stream << "* colour class [";
-            for (auto & c : bigger_cc)
-                *_imp->proof_stream << " " << c.first.second << "/" << c.second.second;
-            *_imp->proof_stream << " ]" << "\n";
-
-            do_one_cc(bigger_cc, [&] (const pair<NamedVertex, NamedVertex> & a, const pair<NamedVertex, NamedVertex> & b) -> long {
-                    return _imp->clique_for_hom_non_edge_constraints[pair{ a, b }];
-                    });
-        }
-        else
-            do_one_cc(cc, [&] (int a, int b) -> long { return _imp->non_edge_constraints[pair{ a, b }]; });
-
-#ifdef MAX
-        if (cc.size() != 1) {
-            *_imp->proof_stream << "p " << _imp->objective_line;
-            for (auto & t : to_sum)
-                *_imp->proof_stream << " " << t << " +";
-            *_imp->proof_stream << "\n";
-            ++_imp->proof_line;
-        }
-#else
-        *_imp->proof_stream << "p " << _imp->objective_line;
-        for (auto & t : to_sum)
-            *_imp->proof_stream << " " << t << " +";
-        *_imp->proof_stream << "\n";
-        ++_imp->proof_line;
-#endif
-    }
-}
+    /**
+     * Writes the parts of the proof that happen at every search node. There
+     * is one instantiation for each combination of sink and traits, chosen
+     * once when the Proof is constructed, so each of these costs one virtual
+     * call and nothing else is decided per line. Everything else is written
+     * by Proof directly, using text().
+     */
+    class ProofLogger
+    {
+        public:
+            virtual ~ProofLogger() = default;
 
-auto Proof::prepare_hom_clique_proof(const NamedVertex & p, const NamedVertex & t, unsigned size) -> void
-{
-    *_imp->proof_stream << "* clique of size " << size << " around neighbourhood of " << p.second << " but not " << t.second << "\n";
-    *_imp->proof_stream << "# 1" << "\n";
-    _imp->doing_hom_colour_proof = true;
-    _imp->hom_colour_proof_p = p;
-    _imp->hom_colour_proof_t = t;
-}
+            virtual auto open(unique_ptr<ostream> && out) -> void = 0;
+            virtual auto text() -> ostream & = 0;
 
-auto Proof::start_hom_clique_proof(const NamedVertex & p, vector<NamedVertex> && p_clique, const NamedVertex & t, map<int, NamedVertex> && t_clique_neighbourhood) -> void
-{
-    _imp->p_clique = move(p_clique);
-    _imp->t_clique_neighbourhood = move(t_clique_neighbourhood);
+            virtual auto add_non_edge_constraint(int p, int q) -> void = 0;
 
-    *_imp->proof_stream << "* hom clique objective" << "\n";
-    vector<long> to_sum;
-    for (auto & q : _imp->p_clique) {
-        *_imp->proof_stream << "u 1 ~x" << _imp->variable_mappings[pair{ p.first, t.first }];
-        for (auto & u : _imp->t_clique_neighbourhood)
-            *_imp->proof_stream << " 1 x" << _imp->variable_mappings[pair{ q.first, u.second.first }];
-        *_imp->proof_stream << " >= 1 ;" << "\n";
-        to_sum.push_back(++_imp->proof_line);
-    }
+            virtual auto finish_unsat_proof() -> void = 0;
+            virtual auto level(int l) -> void = 0;
+            virtual auto forget_level(int l) -> void = 0;
+            virtual auto backtrack_from_binary_variables(const vector<int> &) -> void = 0;
+            virtual auto colour_bound(const vector<vector<int> > &, const vector<InfraChromaticConflict> &) -> void = 0;
+            virtual auto new_incumbent(const vector<pair<int, bool> > &) -> void = 0;
+            virtual auto post_solution(const vector<int> &) -> void = 0;
+    };
 
-    *_imp->proof_stream << "p";
-    bool first = true;
-    for (auto & t : to_sum) {
-        *_imp->proof_stream << " " << t;
-        if (! first)
-            *_imp->proof_stream << " +";
-        first = false;
-    }
-    *_imp->proof_stream << "\n";
-    _imp->objective_line = ++_imp->proof_line;
+    template <typename Sink_, typename Traits_>
+    class ProofLoggerFor final : public ProofLogger
+    {
+        private:
+            ProofState & _state;
+            optional<Sink_> _sink;
+            typename Traits_::NonEdgeConstraints _non_edge_constraints;
+            vector<long> _to_sum;
+
+        public:
+            explicit ProofLoggerFor(ProofState & state) :
+                _state(state)
+            {
+            }
+
+            auto open(unique_ptr<ostream> && out) -> void override
+            {
+                _sink.emplace(move(out));
+            }
 
-    *_imp->proof_stream << "* hom clique non edges for injectivity" << "\n";
+            auto text() -> ostream & override
+            {
+                return _sink->text();
+            }
 
-    for (auto & p : _imp->p_clique)
-        for (auto & q : _imp->p_clique)
-            if (p != q) {
-                for (auto & [ _, t ] : _imp->t_clique_neighbourhood) {
-                    *_imp->proof_stream << "u 1 ~x" << _imp->variable_mappings[pair{ p.first, t.first }] << " 1 ~x" << _imp->variable_mappings[pair{ q.first, t.first }] << " >= 1 ;" << "\n";
-                    ++_imp->proof_line;
-                    _imp->clique_for_hom_non_edge_constraints.emplace(pair{ pair{ p, t }, pair{ q, t } }, _imp->proof_line);
-                    _imp->clique_for_hom_non_edge_constraints.emplace(pair{ pair{ q, t }, pair{ p, t } }, _imp->proof_line);
-                }
+            auto add_non_edge_constraint(int p, int q) -> void override
+            {
+                _non_edge_constraints.add(p, q, _state.nb_constraints, _state.binary_variable_mappings.size());
             }
 
-    *_imp->proof_stream << "* hom clique non edges for variables" << "\n";
+            auto finish_unsat_proof() -> void override
+            {
+                auto & out = _sink->text();
+                if constexpr (Traits_::comments)
+                    out << "* asserting that we've proved unsat\n";
+                out << "u >= 1 ;\n";
+                ++_state.proof_line;
+                out << "c " << _state.proof_line << " 0\n";
+            }
 
-    for (auto & p : _imp->p_clique)
-        for (auto & [ _, t ] : _imp->t_clique_neighbourhood) {
-            for (auto & [ _, u ] : _imp->t_clique_neighbourhood) {
-                if (t != u) {
-                    *_imp->proof_stream << "u 1 ~x" << _imp->variable_mappings[pair{ p.first, t.first }] << " 1 ~x" << _imp->variable_mappings[pair{ p.first, u.first }] << " >= 1 ;" << "\n";
-                    ++_imp->proof_line;
-                    _imp->clique_for_hom_non_edge_constraints.emplace(pair{ pair{ p, t }, pair{ p, u } }, _imp->proof_line);
-                    _imp->clique_for_hom_non_edge_constraints.emplace(pair{ pair{ p, u }, pair{ p, t } }, _imp->proof_line);
+            auto level(int l) -> void override
+            {
+                _sink->level(l);
+            }
+
+            auto forget_level(int l) -> void override
+            {
+                _sink->forget_level(l);
+            }
+
+            auto backtrack_from_binary_variables(const vector<int> & v) -> void override
+            {
+                if (! _state.doing_hom_colour_proof) {
+                    _sink->negated_rup(v, _state.literal_tokens);
+                    ++_state.proof_line;
+                }
+                else {
+                    auto & out = _sink->text();
+                    if constexpr (Traits_::comments)
+                        out << "* backtrack shenanigans, depth " << v.size() << "\n";
+                    function<auto (unsigned, const vector<pair<int, int> > &) -> void> f;
+                    f = [&] (unsigned d, const vector<pair<int, int> > & trail) -> void {
+                        if (d == v.size()) {
+                            out << "u 1 ~x" << _state.variable_mappings[pair{ _state.hom_colour_proof_p.first, _state.hom_colour_proof_t.first }];
+                            for (auto & t : trail)
+                                out << " 1 ~x" << _state.variable_mappings[t];
+                            out << " >= 1 ;\n";
+                            ++_state.proof_line;
+                        }
+                        else {
+                            for (auto & p : _state.p_clique) {
+                                vector<pair<int, int> > new_trail{ trail };
+                                new_trail.emplace_back(pair{ p.first, _state.t_clique_neighbourhood.find(v[d])->second.first });
+                                f(d + 1, new_trail);
+                            }
+                        }
+                    };
+                    f(0, {});
                 }
             }
-        }
-}
 
-auto Proof::finish_hom_clique_proof(const NamedVertex & p, const NamedVertex & t, unsigned size) -> void
-{
-    *_imp->proof_stream << "* end clique of size " << size << " around neighbourhood of " << p.second << " but not " << t.second << "\n";
-    *_imp->proof_stream << "# 0" << "\n";
-    *_imp->proof_stream << "u 1 ~x" << _imp->variable_mappings[pair{ p.first, t.first }] << " >= 1 ;" << "\n";
-    *_imp->proof_stream << "w 1" << "\n";
-    ++_imp->proof_line;
-    _imp->doing_hom_colour_proof = false;
-    _imp->clique_for_hom_non_edge_constraints.clear();
-}
+            // derive that the vertex and the two classes in a conflict
+            // contain at most two vertices of a clique. the vertex with its
+            // non-neighbours in each class, its neighbours in both classes
+            // (which are pairwise non-adjacent), and each class are all
+            // independent sets, so summing their at most one constraints
+            // counts every vertex twice, and is at most five. dividing by
+            // two then gives at most two.
+            auto conflict_bound(const vector<vector<int> > & ccs, const InfraChromaticConflict & conflict) -> long
+            {
+                auto & first = ccs[conflict.first_class];
+                auto & second = ccs[conflict.second_class];
+
+                vector<int> first_others{ conflict.vertex }, second_others{ conflict.vertex }, neighbours;
+                for (auto & w : first)
+                    if (conflict.first_neighbours.end() == find(conflict.first_neighbours.begin(), conflict.first_neighbours.end(), w))
+                        first_others.push_back(w);
+                for (auto & w : second)
+                    if (conflict.second_neighbours.end() == find(conflict.second_neighbours.begin(), conflict.second_neighbours.end(), w))
+                        second_others.push_back(w);
+                neighbours = conflict.first_neighbours;
+                neighbours.insert(neighbours.end(), conflict.second_neighbours.begin(), conflict.second_neighbours.end());
+
+                // an empty set contributes nothing, and a single vertex is
+                // a literal axiom
+                vector<string> terms;
+                auto at_most_one = [&] (const vector<int> & s) {
+                    if (s.size() == 1)
+                        terms.emplace_back(_state.literal_tokens.negated(s[0]).substr(1));
+                    else if (s.size() == 2)
+                        terms.push_back(to_string(_non_edge_constraints(s[0], s[1])));
+                    else if (s.size() > 2) {
+                        _sink->colour_class(s.size(), [&] (unsigned i, unsigned j) { return _non_edge_constraints(s[i], s[j]); });
+                        terms.push_back(to_string(++_state.proof_line));
+                    }
+                };
+
+                at_most_one(first);
+                at_most_one(second);
+                at_most_one(first_others);
+                at_most_one(second_others);
+                at_most_one(neighbours);
+
+                auto & out = _sink->text();
+                if constexpr (Traits_::comments)
+                    out << "* infra-chromatic conflict, vertex " << conflict.vertex << " with ccs "
+                        << conflict.first_class << " and " << conflict.second_class << "\n";
+                out << "p " << terms[0];
+                for (unsigned i = 1 ; i < terms.size() ; ++i)
+                    out << " " << terms[i] << " +";
+                out << " 2 d\n";
+                return ++_state.proof_line;
+            }
 
-auto Proof::add_hom_clique_non_edge(
-        const NamedVertex & pp,
-        const NamedVertex & tt,
-        const std::vector<NamedVertex> & p_clique,
-        const NamedVertex & t,
-        const NamedVertex & u) -> void
-{
-    *_imp->proof_stream << "* hom clique non edges for " << t.second << " " << u.second << "\n";
-    for (auto & p : p_clique) {
-        for (auto & q : p_clique) {
-            if (p != q) {
-                *_imp->proof_stream << "u 1 ~x" << _imp->variable_mappings[pair{ pp.first, tt.first }]
-                    << " 1 ~x" << _imp->variable_mappings[pair{ p.first, t.first }]
-                    << " 1 ~x" << _imp->variable_mappings[pair{ q.first, u.first }] << " >= 1 ;" << "\n";
-                ++_imp->proof_line;
-                _imp->clique_for_hom_non_edge_constraints.emplace(pair{ pair{ p, t }, pair{ q, u } }, _imp->proof_line);
-                _imp->clique_for_hom_non_edge_constraints.emplace(pair{ pair{ q, u }, pair{ p, t } }, _imp->proof_line);
+            auto colour_bound(const vector<vector<int> > & ccs, const vector<InfraChromaticConflict> & conflicts) -> void override
+            {
+                if constexpr (Traits_::comments)
+                    _sink->bound_comment(ccs);
+
+                // reused across calls, so we don't allocate on every bound
+                auto & to_sum = _to_sum;
+                to_sum.clear();
+                auto do_one_cc = [&] (const auto & cc, auto && non_edge_constraint) {
+                    if (cc.size() > 2) {
+                        _sink->colour_class(cc.size(), [&] (unsigned i, unsigned j) { return non_edge_constraint(cc[i], cc[j]); });
+                        to_sum.push_back(++_state.proof_line);
+                    }
+                    else if (cc.size() == 2) {
+                        to_sum.push_back(non_edge_constraint(cc[0], cc[1]));
+                    }
+                };
+
+                for (unsigned k = 0 ; k < ccs.size() ; ++k) {
+                    auto & cc = ccs[k];
+
+                    // a class in a conflict is counted along with the other
+                    // class and the vertex, once we reach whichever class
+                    // comes later
+                    auto conflict = find_if(conflicts.begin(), conflicts.end(), [&] (const InfraChromaticConflict & c) {
+                            return c.first_class == k || c.second_class == k; });
+                    if (conflict != conflicts.end()) {
+                        if (k != max(conflict->first_class, conflict->second_class))
+                            continue;
+                        to_sum.push_back(conflict_bound(ccs, *conflict));
+                    }
+                    else if (_state.doing_hom_colour_proof) {
+                        vector<pair<NamedVertex, NamedVertex> > bigger_cc;
+                        for (auto & c : cc)
+                            for (auto & v : _state.p_clique)
+                                bigger_cc.push_back(pair{ v, _state.t_clique_neighbourhood.find(c)->second });
+
+                        auto & out = _sink->text();
+                        out << "* colour class [";
+                        for (auto & c : bigger_cc)
+                            out << " " << c.first.second << "/" << c.second.second;
+                        out << " ]\n";
+
+                        do_one_cc(bigger_cc, [&] (const pair<NamedVertex, NamedVertex> & a, const pair<NamedVertex, NamedVertex> & b) -> long {
+                                return _state.clique_for_hom_non_edge_constraints[pair{ a, b }];
+                                });
+                    }
+                    else
+                        do_one_cc(cc, _non_edge_constraints);
+
+                    // a singleton class adds nothing, so its sum repeats the previous one
+                    if (! Traits_::skip_singleton_colour_classes || cc.size() != 1 || conflict != conflicts.end()) {
+                        _sink->sum(_state.objective_line, to_sum);
+                        ++_state.proof_line;
+                    }
+                }
             }
-        }
-    }
-}
 
-auto Proof::not_connected_in_underlying_graph(const std::vector<int> & x, int y) -> void
-{
-    *_imp->proof_stream << "u 1 ~x" << _imp->binary_variable_mappings[y];
-    for (auto & v : x)
-        *_imp->proof_stream << " 1 ~x" << _imp->binary_variable_mappings[v];
-    *_imp->proof_stream << " >= 1 ;" << "\n";
-    ++_imp->proof_line;
-}
+            auto new_incumbent(const vector<pair<int, bool> > & solution) -> void override
+            {
+                if (_state.zero_in_proof_objectives.empty())
+                    _sink->objective(solution, _state.literal_tokens);
+                else {
+                    auto & out = _sink->text();
+                    out << "o";
+                    for (auto & [ v, t ] : solution)
+                        out << " " << (t ? "" : "~") << "x" << _state.binary_variable_mappings[v];
+                    for (auto & [ v, w ] : _state.zero_in_proof_objectives)
+                        out << " ~" << "x" << _state.variable_mappings[pair{ v, w }];
+                    out << "\n";
+                }
+                _state.objective_line = ++_state.proof_line;
+            }
 
-auto Proof::has_clique_model() const -> bool
-{
-    return _imp->clique_encoding;
-}
+            auto post_solution(const vector<int> & solution) -> void override
+            {
+                _sink->solution(solution, _state.literal_tokens);
+                ++_state.proof_line;
+            }
+    };
 
-auto Proof::create_clique_encoding(
-        const vector<pair<int, int> > & enc,
-        const vector<pair<int, int> > & zero_in_proof_objectives) -> void
-{
-    _imp->clique_encoding = true;
-    for (unsigned i = 0 ; i < enc.size() ; ++i)
-        _imp->binary_variable_mappings.emplace(i, _imp->variable_mappings[enc[i]]);
+    template <typename Sink_>
+    auto make_proof_logger_with_sink(const ProofOptions & options, ProofState & state) -> unique_ptr<ProofLogger>
+    {
+        // turn each runtime option into a template argument, one at a time
+        auto with = [] (bool b, auto f) {
+            if (b)
+                return f(true_type{});
+            else
+                return f(false_type{});
+        };
 
-    _imp->zero_in_proof_objectives = zero_in_proof_objectives;
-}
+        return with(options.bound_comments, [&] (auto comments) {
+            return with(options.skip_singleton_colour_classes, [&] (auto skip_singletons) {
+                return with(options.dense_constraint_ids, [&] (auto dense) -> unique_ptr<ProofLogger> {
+                    using Traits = ProofTraits<decltype(comments)::value, decltype(skip_singletons)::value, decltype(dense)::value>;
+                    return make_unique<ProofLoggerFor<Sink_, Traits> >(state);
+                });
+            });
+        });
+    }
 
-auto Proof::super_extra_verbose() const -> bool
-{
-    return _imp->super_extra_verbose;
+    auto make_proof_logger(const ProofOptions & options, ProofState & state) -> unique_ptr<ProofLogger>
+    {
+        if (options.format == ProofFormat::Binary)
+            return make_proof_logger_with_sink<BinaryProofSink>(options, state);
+
+        switch (options.sink) {
+            case ProofSink::IOStreamEndl: return make_proof_logger_with_sink<IOStreamProofSink<true> >(options, state);
+            case ProofSink::IOStream:     return make_proof_logger_with_sink<IOStreamProofSink<false> >(options, state);
+            case ProofSink::Fmt:          return make_proof_logger_with_sink<FmtProofSink>(options, state);
+            case ProofSink::Raw:          return make_proof_logger_with_sink<RawProofSink>(options, state);
+        }
+
+        throw ProofError{ "Unknown proof sink" };
+    }
 }
 
-auto Proof::show_domains(const string & s, const std::vector<std::pair<NamedVertex, std::vector<NamedVertex> > > & domains) -> void
+ProofError::ProofError(const string & m) noexcept :
+    _message("Proof error: " + m)
 {
-    *_imp->proof_stream << "* " << s << ", domains follow" << "\n";
-    for (auto & [ p, ts ] : domains) {
-        *_imp->proof_stream << "*    " << p.second << " size " << ts.size() << " = {";
-        for (auto & t : ts)
-            *_imp->proof_stream << " " << t.second;
-        *_imp->proof_stream << " }" << "\n";
-    }
 }
 
-auto Proof::propagated(const NamedVertex & p, const NamedVertex & t, int g, int n_values, const NamedVertex & q) -> void
+auto ProofError::what() const noexcept -> const char *
 {
-    *_imp->proof_stream << "* adjacency propagation from " << p.second << " -> " << t.second << " in graph pairs " << g << " deleted " << n_values << " values from " << q.second << "\n";
+    return _message.c_str();
 }
-#endif
 
-#ifdef FMT
-struct Proof::Imp
+struct Proof::Imp : ProofState
 {
-    string opb_filename, log_filename;
-    stringstream model_stream, model_prelude_stream;
-    /* fmt::ostream proof_stream; */
-    FILE* proof_file;
-    bool friendly_names;
-    bool bz2 = false;
-    bool super_extra_verbose = false;
-
-    map<pair<long, long>, string> variable_mappings;
-    map<long, string> binary_variable_mappings;
-    map<tuple<long, long, long>, string> connected_variable_mappings;
-    map<tuple<long, long, long, long>, string> connected_variable_mappings_aux;
-    map<long, long> at_least_one_value_constraints, at_most_one_value_constraints, injectivity_constraints;
-    map<tuple<long, long, long, long>, long> adjacency_lines;
-    map<pair<long, long>, long> eliminations;
-    map<pair<long, long>, long> non_edge_constraints;
-    long objective_line = 0;
-
-    long nb_constraints = 0;
-    long proof_line = 0;
-    int largest_level_set = 0;
-
-    bool clique_encoding = false;
-
-    bool doing_hom_colour_proof = false;
-    NamedVertex hom_colour_proof_p, hom_colour_proof_t;
-    vector<NamedVertex> p_clique;
-    map<int, NamedVertex> t_clique_neighbourhood;
-    map<pair<pair<NamedVertex, NamedVertex>, pair<NamedVertex, NamedVertex> >, long> clique_for_hom_non_edge_constraints;
-
-    vector<pair<int, int> > zero_in_proof_objectives;
+    unique_ptr<ProofLogger> logger;
 };
 
-Proof::Proof(const string & opb_file, const string & log_file, bool f, bool b, bool s) :
+Proof::Proof(const ProofOptions & options) :
     _imp(new Imp)
 {
-    _imp->opb_filename = opb_file;
-    _imp->log_filename = log_file;
-    _imp->friendly_names = f;
-    _imp->bz2 = b;
-    _imp->super_extra_verbose = s;
-    _imp->proof_file = fopen(log_file.c_str(),"w");
-    auto stream = fmt::output_file(log_file);
-    fmt::print("{}",typeid(stream).name());
-    /* _imp->proof_stream = fmt::output_file(log_file); */
+    // check this now, rather than leaving an empty file behind when the
+    // first compressed stream is created
+    check_compression(options.compression, options.compression_level);
+
+    _imp->opb_filename = options.opb_file;
+    _imp->log_filename = options.log_file;
+    _imp->friendly_names = options.friendly_names;
+    _imp->compression = options.compression;
+    _imp->compression_level = options.compression_level;
+    _imp->compression_threads = options.compression_threads;
+    _imp->async = options.async;
+    _imp->sink = options.sink;
+    _imp->super_extra_verbose = options.super_extra_verbose;
+    _imp->logger = make_proof_logger(options, *_imp);
 }
 
 Proof::Proof(Proof &&) = default;
@@ -1311,145 +596,173 @@ auto Proof::create_cp_variable(int pattern_vertex, int target_size,
         else
             _imp->variable_mappings.emplace(pair{ pattern_vertex, i }, to_string(_imp->variable_mappings.size() + 1));
 
-    _imp->model_stream << "* vertex " << pattern_vertex << " domain" << endl;
+    _imp->model() << "* vertex " << pattern_vertex << " domain\n";
     for (int i = 0 ; i < target_size ; ++i)
-        _imp->model_stream << "1 x" << _imp->variable_mappings[{ pattern_vertex, i }] << " ";
-    _imp->model_stream << ">= 1 ;" << endl;
+        _imp->model() << "1 x" << _imp->variable_mappings[{ pattern_vertex, i }] << " ";
+    _imp->model() << ">= 1 ;\n";
     _imp->at_least_one_value_constraints.emplace(pattern_vertex, ++_imp->nb_constraints);
 
     for (int i = 0 ; i < target_size ; ++i)
-        _imp->model_stream << "-1 x" << _imp->variable_mappings[{ pattern_vertex, i }] << " ";
-    _imp->model_stream << ">= -1 ;" << endl;
+        _imp->model() << "-1 x" << _imp->variable_mappings[{ pattern_vertex, i }] << " ";
+    _imp->model() << ">= -1 ;\n";
     _imp->at_most_one_value_constraints.emplace(pattern_vertex, ++_imp->nb_constraints);
 }
 
 auto Proof::create_injectivity_constraints(int pattern_size, int target_size) -> void
 {
     for (int v = 0 ; v < target_size ; ++v) {
-        _imp->model_stream << "* injectivity on value " << v << endl;
+        _imp->model() << "* injectivity on value " << v << "\n";
 
         for (int p = 0 ; p < pattern_size ; ++p) {
             auto x = _imp->variable_mappings.find(pair{ p, v });
             if (x != _imp->variable_mappings.end())
-                _imp->model_stream << "-1 x" << x->second << " ";
+                _imp->model() << "-1 x" << x->second << " ";
         }
-        _imp->model_stream << ">= -1 ;" << endl;
+        _imp->model() << ">= -1 ;\n";
         _imp->injectivity_constraints.emplace(v, ++_imp->nb_constraints);
     }
 }
 
 auto Proof::create_forbidden_assignment_constraint(int p, int t) -> void
 {
-    _imp->model_stream << "* forbidden assignment" << endl;
-    _imp->model_stream << "1 ~x" << _imp->variable_mappings[pair{ p, t }] << " >= 1 ;" << endl;
+    _imp->model() << "* forbidden assignment\n";
+    _imp->model() << "1 ~x" << _imp->variable_mappings[pair{ p, t }] << " >= 1 ;\n";
     ++_imp->nb_constraints;
     _imp->eliminations.emplace(pair{ p, t }, _imp->nb_constraints);
 }
 
 auto Proof::start_adjacency_constraints_for(int p, int t) -> void
 {
-    _imp->model_stream << "* adjacency " << p << " maps to " << t << endl;
+    _imp->model() << "* adjacency " << p << " maps to " << t << "\n";
 }
 
 auto Proof::create_adjacency_constraint(int p, int q, int t, const vector<int> & uu, bool) -> void
 {
-    _imp->model_stream << "1 ~x" << _imp->variable_mappings[pair{ p, t }];
+    _imp->model() << "1 ~x" << _imp->variable_mappings[pair{ p, t }];
     for (auto & u : uu)
-        _imp->model_stream << " 1 x" << _imp->variable_mappings[pair{ q, u }];
-    _imp->model_stream << " >= 1 ;" << endl;
+        _imp->model() << " 1 x" << _imp->variable_mappings[pair{ q, u }];
+    _imp->model() << " >= 1 ;\n";
     _imp->adjacency_lines.emplace(tuple{ 0, p, q, t }, ++_imp->nb_constraints);
 }
 
-auto Proof::finalise_model() -> void
+auto Proof::start_model(int number_of_variables, long number_of_constraints) -> void
 {
-    unique_ptr<ostream> f = /* fmt::output_file(_imp->log_filename) */ (_imp->bz2 ? make_compressed_ostream(_imp->opb_filename + ".bz2") : make_unique<ofstream>(_imp->opb_filename));
-
-    *f << "* #variable= " << (_imp->variable_mappings.size() + _imp->binary_variable_mappings.size()
-            + _imp->connected_variable_mappings.size() + _imp->connected_variable_mappings_aux.size())
-        << " #constraint= " << _imp->nb_constraints << endl;
-    copy(istreambuf_iterator<char>{ _imp->model_prelude_stream }, istreambuf_iterator<char>{}, ostreambuf_iterator<char>{ *f });
-    _imp->model_prelude_stream.clear();
-    copy(istreambuf_iterator<char>{ _imp->model_stream }, istreambuf_iterator<char>{}, ostreambuf_iterator<char>{ *f });
-    _imp->model_stream.clear();
+    _imp->declared_variables = number_of_variables;
+    _imp->declared_constraints = number_of_constraints;
 
-    if (! *f)
+    _imp->model_file = _imp->open_output(_imp->opb_filename, true);
+    *_imp->model_file << "* #variable= " << number_of_variables << " #constraint= " << number_of_constraints << "\n";
+    if (! *_imp->model_file)
         throw ProofError{ "Error writing opb file to '" + _imp->opb_filename + "'" };
+}
+
+auto Proof::finalise_model() -> void
+{
+    if (_imp->model_file) {
+        if (_imp->number_of_variables() != _imp->declared_variables || _imp->nb_constraints != _imp->declared_constraints)
+            throw ProofError{ "opb file '" + _imp->opb_filename + "' was started with #variable= " + to_string(_imp->declared_variables)
+                + " #constraint= " + to_string(_imp->declared_constraints) + ", but has " + to_string(_imp->number_of_variables())
+                + " and " + to_string(_imp->nb_constraints) };
+
+        // if we're writing asynchronously, let the model finish writing
+        // while we get on with the search, and close it in the destructor
+        if (! _imp->async)
+            close_output(*_imp->model_file);
+        if (! *_imp->model_file)
+            throw ProofError{ "Error writing opb file to '" + _imp->opb_filename + "'" };
+    }
+    else {
+        unique_ptr<ostream> f = make_unique<ofstream>(_imp->opb_filename + compressed_filename_suffix(_imp->compression));
+        if (_imp->compression != ProofCompression::None)
+            f = make_unique<ParallelCompressingStream>(move(f), _imp->compression, _imp->compression_level, _imp->compression_threads);
+
+        *f << "* #variable= " << _imp->number_of_variables() << " #constraint= " << _imp->nb_constraints << "\n";
+        copy(istreambuf_iterator<char>{ _imp->model_prelude_stream }, istreambuf_iterator<char>{}, ostreambuf_iterator<char>{ *f });
+        _imp->model_prelude_stream.clear();
+        copy(istreambuf_iterator<char>{ _imp->model_stream }, istreambuf_iterator<char>{}, ostreambuf_iterator<char>{ *f });
+        _imp->model_stream.clear();
+
+        close_output(*f);
+        if (! *f)
+            throw ProofError{ "Error writing opb file to '" + _imp->opb_filename + "'" };
+    }
 
-    /* _imp->proof_stream = fmt::output_file(_imp->log_filename); (_imp->bz2 ? make_compressed_ostream(_imp->log_filename + ".bz2") : make_unique<ofstream>(_imp->log_filename)); */
+    _imp->logger->open(_imp->open_output(_imp->log_filename, _imp->sink == ProofSink::Raw));
 
-    fmt::println(_imp->proof_file, "pseudo-Boolean proof version 1.0");
+    auto & out = _imp->logger->text();
+    out << "pseudo-Boolean proof version 1.0\n";
 
-    fmt::println(_imp->proof_file, "f {} 0",_imp->nb_constraints);
+    out << "f " << _imp->nb_constraints << " 0\n";
     _imp->proof_line += _imp->nb_constraints;
 
-    /* if (! *_imp->proof_stream)
-        throw ProofError{ "Error writing proof file to '" + _imp->log_filename + "'" }; */
+    if (! out)
+        throw ProofError{ "Error writing proof file to '" + _imp->log_filename + "'" };
 }
 
 auto Proof::finish_unsat_proof() -> void
 {
-    fmt::println(_imp->proof_file, "* asserting that we've proved unsat");
-    fmt::println(_imp->proof_file, "u >= 1 ;");
-    ++_imp->proof_line;
-    fmt::println(_imp->proof_file, "c {} 0", _imp->proof_line);
+    _imp->logger->finish_unsat_proof();
 }
 
 auto Proof::emit_hall_set_or_violator(const vector<NamedVertex> & lhs, const vector<NamedVertex> & rhs) -> void
 {
-    fmt::print(_imp->proof_file, "* hall set or violator {");
+    auto & out = _imp->logger->text();
+    out << "* hall set or violator {";
     for (auto & l : lhs)
-        fmt::print(_imp->proof_file, " {}", l.second);
-    fmt::print(_imp->proof_file, " } / {");
+        out << " " << l.second;
+    out << " } / {";
     for (auto & r : rhs)
-        fmt::print(_imp->proof_file, " {}", r.second);
-    fmt::println(_imp->proof_file, " }");
-    fmt::print(_imp->proof_file, "p");
+        out << " " << r.second;
+    out << " }\n";
+    out << "p";
     bool first = true;
     for (auto & l : lhs) {
         if (first) {
             first = false;
-            fmt::println(_imp->proof_file, " {}", _imp->at_least_one_value_constraints[l.first]);
+            out << " " << _imp->at_least_one_value_constraints[l.first];
         }
         else
-            fmt::println(_imp->proof_file, " {} +", _imp->at_least_one_value_constraints[l.first]);
+            out << " " << _imp->at_least_one_value_constraints[l.first] << " +";
     }
     for (auto & r : rhs)
-        fmt::print(_imp->proof_file, " {} +", _imp->injectivity_constraints[r.first]);
-    fmt::println(_imp->proof_file, " 0");
+        out << " " << _imp->injectivity_constraints[r.first] << " +";
+    out << " 0\n";
     ++_imp->proof_line;
 }
 
 auto Proof::root_propagation_failed() -> void
 {
-    fmt::println(_imp->proof_file, "* root node propagation failed");
+    _imp->logger->text() << "* root node propagation failed\n";
 }
 
 auto Proof::guessing(int depth, const NamedVertex & branch_v, const NamedVertex & val) -> void
 {
-    fmt::println(_imp->proof_file, "* [{}] guessing {}={}", depth, branch_v.second, val.second);
+    _imp->logger->text() << "* [" << depth << "] guessing " << branch_v.second << "=" << val.second << "\n";
 }
 
 auto Proof::propagation_failure(const vector<pair<int, int> > & decisions, const NamedVertex & branch_v, const NamedVertex & val) -> void
 {
-    fmt::println(_imp->proof_file, "* [{}] propagation failure on {}={}", decisions.size(), branch_v.second, val.second);
-    fmt::print(_imp->proof_file, "u ");
+    auto & out = _imp->logger->text();
+    out << "* [" << decisions.size() << "] propagation failure on " << branch_v.second << "=" << val.second << "\n";
+    out << "u ";
     for (auto & [ var, val ] : decisions)
-        fmt::print(_imp->proof_file, " 1 ~x{}", _imp->variable_mappings[pair{ var, val }]);
-    fmt::println(_imp->proof_file, " >= 1 ;");
+        out << " 1 ~x" << _imp->variable_mappings[pair{ var, val }];
+    out << " >= 1 ;\n";
     ++_imp->proof_line;
 }
 
 auto Proof::incorrect_guess(const vector<pair<int, int> > & decisions, bool failure) -> void
 {
+    auto & out = _imp->logger->text();
     if (failure)
-        fmt::println(_imp->proof_file, "* [{}] incorrect guess", decisions.size());
+        out << "* [" << decisions.size() << "] incorrect guess\n";
     else
-        fmt::println(_imp->proof_file, "* [{}] backtracking", decisions.size());
+        out << "* [" << decisions.size() << "] backtracking\n";
 
-    fmt::print(_imp->proof_file, "u");
+    out << "u";
     for (auto & [ var, val ] : decisions)
-        fmt::print(_imp->proof_file, " 1 ~x{}", _imp->variable_mappings[pair{ var, val }]);
-    fmt::println(_imp->proof_file, " >= 1 ;");
+        out << " 1 ~x" << _imp->variable_mappings[pair{ var, val }];
+    out << " >= 1 ;\n";
     ++_imp->proof_line;
 }
 
@@ -1459,214 +772,134 @@ auto Proof::out_of_guesses(const vector<pair<int, int> > &) -> void
 
 auto Proof::unit_propagating(const NamedVertex & var, const NamedVertex & val) -> void
 {
-    fmt::println(_imp->proof_file, "* unit propagating {}={}", var.second, val.second);
+    _imp->logger->text() << "* unit propagating " << var.second << "=" << val.second << "\n";
 }
 
 auto Proof::start_level(int l) -> void
 {
-    fmt::println(_imp->proof_file, "# {}", l);
+    _imp->logger->level(l);
     _imp->largest_level_set = max(_imp->largest_level_set, l);
 }
 
 auto Proof::back_up_to_level(int l) -> void
 {
-    fmt::println(_imp->proof_file, "# {}", l);
+    _imp->logger->level(l);
     _imp->largest_level_set = max(_imp->largest_level_set, l);
 }
 
 auto Proof::forget_level(int l) -> void
 {
     if (_imp->largest_level_set >= l)
-        fmt::println(_imp->proof_file, "w {}", l);
+        _imp->logger->forget_level(l);
 }
 
 auto Proof::back_up_to_top() -> void
 {
-    fmt::println(_imp->proof_file, "# {}", 0);
+    _imp->logger->level(0);
 }
 
 auto Proof::post_restart_nogood(const vector<pair<int, int> > & decisions) -> void
 {
-    fmt::println(_imp->proof_file, "* [{}] restart nogood", decisions.size());
-    fmt::print(_imp->proof_file, "u");
+    auto & out = _imp->logger->text();
+    out << "* [" << decisions.size() << "] restart nogood\n";
+    out << "u";
     for (auto & [ var, val ] : decisions)
-        fmt::print(_imp->proof_file, " 1 ~x{}", _imp->variable_mappings[pair{ var, val }]);
-    fmt::println(_imp->proof_file, " >= 1 ;");
+        out << " 1 ~x" << _imp->variable_mappings[pair{ var, val }];
+    out << " >= 1 ;\n";
     ++_imp->proof_line;
 }
 
 auto Proof::post_solution(const vector<pair<NamedVertex, NamedVertex> > & decisions) -> void
 {
-    fmt::print(_imp->proof_file, "* found solution");
+    auto & out = _imp->logger->text();
+    out << "* found solution";
     for (auto & [ var, val ] : decisions)
-        fmt::print(_imp->proof_file, " {}={}", var.second, val.second);
-    fmt::println(_imp->proof_file, "");
+        out << " " << var.second << "=" << val.second;
+    out << "\n";
 
-    fmt::print(_imp->proof_file, "v");
+    out << "v";
     for (auto & [ var, val ] : decisions)
-        fmt::print(_imp->proof_file, " x{}", _imp->variable_mappings[pair{ var.first, val.first }]);
-    fmt::println(_imp->proof_file, "");
+        out << " x" << _imp->variable_mappings[pair{ var.first, val.first }];
+    out << "\n";
     ++_imp->proof_line;
 }
 
 auto Proof::post_solution(const vector<int> & solution) -> void
 {
-    fmt::print(_imp->proof_file, "v");
-    for (auto & v : solution)
-        fmt::print(_imp->proof_file, " x", _imp->binary_variable_mappings[v]);
-    fmt::println(_imp->proof_file, "");
-    ++_imp->proof_line;
+    _imp->logger->post_solution(solution);
 }
 
 auto Proof::new_incumbent(const vector<pair<int, bool> > & solution) -> void
 {
-    fmt::print(_imp->proof_file, "o");
-    for (auto & [ v, t ] : solution)
-        fmt::print(_imp->proof_file, " {}x{}", (t ? "" : "~"), _imp->binary_variable_mappings[v]);
-    for (auto & [ v, w ] : _imp->zero_in_proof_objectives)
-        fmt::print(_imp->proof_file, " ~x{}", _imp->variable_mappings[pair{ v, w }]);
-    fmt::println(_imp->proof_file, "");
-    _imp->objective_line = ++_imp->proof_line;
+    _imp->logger->new_incumbent(solution);
 }
 
 auto Proof::new_incumbent(const vector<tuple<NamedVertex, NamedVertex, bool> > & decisions) -> void
 {
-    fmt::print(_imp->proof_file, "o");
+    auto & out = _imp->logger->text();
+    out << "o";
     for (auto & [ var, val, t ] : decisions)
-        fmt::print(_imp->proof_file, " {}x{}", (t ? "" : "~"), _imp->variable_mappings[pair{ var.first, val.first }]);
-    fmt::println(_imp->proof_file, "");
+        out << " " << (t ? "" : "~") << "x" << _imp->variable_mappings[pair{ var.first, val.first }];
+    out << "\n";
     _imp->objective_line = ++_imp->proof_line;
 }
 
 auto Proof::create_binary_variable(int vertex,
                 const function<auto (int) -> string> & name) -> void
 {
-    if (_imp->friendly_names)
-        _imp->binary_variable_mappings.emplace(vertex, name(vertex));
-    else
+    auto [ mapping, inserted ] = _imp->friendly_names ?
+        _imp->binary_variable_mappings.emplace(vertex, name(vertex)) :
         _imp->binary_variable_mappings.emplace(vertex, to_string(_imp->binary_variable_mappings.size() + 1));
+    if (inserted)
+        _imp->literal_tokens.add(vertex, mapping->second);
 }
 
 auto Proof::create_objective(int n, optional<int> d) -> void
 {
     if (d) {
-        _imp->model_stream << "* objective" << endl;
+        _imp->model() << "* objective\n";
         for (int v = 0 ; v < n ; ++ v)
-            _imp->model_stream << "1 x" << _imp->binary_variable_mappings[v] << " ";
-        _imp->model_stream << ">= " << *d << ";" << endl;
+            _imp->model() << "1 x" << _imp->binary_variable_mappings[v] << " ";
+        _imp->model() << ">= " << *d << ";\n";
         _imp->objective_line = ++_imp->nb_constraints;
     }
     else {
-        _imp->model_prelude_stream << "min:";
+        _imp->model_prelude() << "min:";
         for (int v = 0 ; v < n ; ++ v)
-            _imp->model_prelude_stream << " -1 x" << _imp->binary_variable_mappings[v];
-        _imp->model_prelude_stream << " ;" << endl;
+            _imp->model_prelude() << " -1 x" << _imp->binary_variable_mappings[v];
+        _imp->model_prelude() << " ;\n";
     }
 }
 
 auto Proof::create_non_edge_constraint(int p, int q) -> void
 {
-    _imp->model_stream << "-1 x" << _imp->binary_variable_mappings[p] << " -1 x" << _imp->binary_variable_mappings[q] << " >= -1 ;" << endl;
+    _imp->model() << "-1 x" << _imp->literal_tokens.name(p) << " -1 x" << _imp->literal_tokens.name(q) << " >= -1 ;\n";
 
     ++_imp->nb_constraints;
-    _imp->non_edge_constraints.emplace(pair{ p, q }, _imp->nb_constraints);
-    _imp->non_edge_constraints.emplace(pair{ q, p }, _imp->nb_constraints);
+    _imp->logger->add_non_edge_constraint(p, q);
 }
 
 auto Proof::backtrack_from_binary_variables(const vector<int> & v) -> void
 {
-    if (! _imp->doing_hom_colour_proof) {
-        fmt::print(_imp->proof_file, "u");
-        for (auto & w : v)
-            fmt::print(_imp->proof_file, " 1 ~x{}", _imp->binary_variable_mappings[w]);
-        fmt::println(_imp->proof_file, " >= 1 ;");
-        ++_imp->proof_line;
-    }
-    else {
-        fmt::println(_imp->proof_file, "* backtrack shenanigans, depth {}", v.size());
-        function<auto (unsigned, const vector<pair<int, int> > &) -> void> f;
-        f = [&] (unsigned d, const vector<pair<int, int> > & trail) -> void {
-            if (d == v.size()) {
-                fmt::print(_imp->proof_file, "u 1 ~x{}", _imp->variable_mappings[pair{ _imp->hom_colour_proof_p.first, _imp->hom_colour_proof_t.first }]);
-                for (auto & t : trail)
-                    fmt::print(_imp->proof_file, " 1 ~x{}", _imp->variable_mappings[t]);
-                fmt::println(_imp->proof_file, " >= 1 ;");
-                ++_imp->proof_line;
-            }
-            else {
-                for (auto & p : _imp->p_clique) {
-                    vector<pair<int, int> > new_trail{ trail };
-                    new_trail.emplace_back(pair{ p.first, _imp->t_clique_neighbourhood.find(v[d])->second.first });
-                    f(d + 1, new_trail);
-                }
-            }
-        };
-        f(0, {});
-    }
+    _imp->logger->backtrack_from_binary_variables(v);
 }
 
 auto Proof::colour_bound(const vector<vector<int> > & ccs) -> void
 {
-    fmt::print(_imp->proof_file, "* bound, ccs");
-    for (auto & cc : ccs) {
-        fmt::print(_imp->proof_file, " [");
-        for (auto & c : cc)
-            fmt::print(_imp->proof_file, " {}", c);
-        fmt::print(_imp->proof_file, " ]");
-    }
-    fmt::println(_imp->proof_file, "");
-
-    vector<long> to_sum;
-    auto do_one_cc = [&] (const auto & cc, const auto & non_edge_constraint) {
-        if (cc.size() > 2) {
-            fmt::print(_imp->proof_file, "p {}", non_edge_constraint(cc[0], cc[1]));
-
-            for (unsigned i = 2 ; i < cc.size() ; ++i) {
-                fmt::print(_imp->proof_file, " {} *", i);
-                for (unsigned j = 0 ; j < i ; ++j)
-                    fmt::print(_imp->proof_file, " {} +", non_edge_constraint(cc[i], cc[j]));
-                fmt::print(_imp->proof_file, " {} d", (i + 1));
-            }
-
-            fmt::println(_imp->proof_file, "");
-            to_sum.push_back(++_imp->proof_line);
-        }
-        else if (cc.size() == 2) {
-            to_sum.push_back(non_edge_constraint(cc[0], cc[1]));
-        }
-    };
-
-    for (auto & cc : ccs) {
-        if (_imp->doing_hom_colour_proof) {
-            vector<pair<NamedVertex, NamedVertex> > bigger_cc;
-            for (auto & c : cc)
-                for (auto & v : _imp->p_clique)
-                    bigger_cc.push_back(pair{ v, _imp->t_clique_neighbourhood.find(c)->second });
-
-            fmt::print(_imp->proof_file, "* colour class [");
-            for (auto & c : bigger_cc)
-                fmt::print(_imp->proof_file, " {}/{}", c.first.second, c.second.second);
-            fmt::println(_imp->proof_file, " ]");
-
-            do_one_cc(bigger_cc, [&] (const pair<NamedVertex, NamedVertex> & a, const pair<NamedVertex, NamedVertex> & b) -> long {
-                    return _imp->clique_for_hom_non_edge_constraints[pair{ a, b }];
-                    });
-        }
-        else
-            do_one_cc(cc, [&] (int a, int b) -> long { return _imp->non_edge_constraints[pair{ a, b }]; });
+    static const vector<InfraChromaticConflict> no_conflicts;
+    _imp->logger->colour_bound(ccs, no_conflicts);
+}
 
-        fmt::print(_imp->proof_file, "p {}", _imp->objective_line);
-        for (auto & t : to_sum)
-            fmt::print(_imp->proof_file, " {} +", t);
-        fmt::println(_imp->proof_file, "");
-        ++_imp->proof_line;
-    }
+auto Proof::colour_bound(const vector<vector<int> > & ccs, const vector<InfraChromaticConflict> & conflicts) -> void
+{
+    _imp->logger->colour_bound(ccs, conflicts);
 }
 
 auto Proof::prepare_hom_clique_proof(const NamedVertex & p, const NamedVertex & t, unsigned size) -> void
 {
-    fmt::println(_imp->proof_file, "* clique of size {} around neighbourhood of {} but not {}", size, p.second, t.second);
-    fmt::println(_imp->proof_file, "# 1");
+    auto & out = _imp->logger->text();
+    out << "* clique of size " << size << " around neighbourhood of " << p.second << " but not " << t.second << "\n";
+    out << "# 1\n";
     _imp->doing_hom_colour_proof = true;
     _imp->hom_colour_proof_p = p;
     _imp->hom_colour_proof_t = t;
@@ -1677,47 +910,48 @@ auto Proof::start_hom_clique_proof(const NamedVertex & p, vector<NamedVertex> &&
     _imp->p_clique = move(p_clique);
     _imp->t_clique_neighbourhood = move(t_clique_neighbourhood);
 
-    fmt::println(_imp->proof_file, "* hom clique objective");
+    auto & out = _imp->logger->text();
+    out << "* hom clique objective\n";
     vector<long> to_sum;
     for (auto & q : _imp->p_clique) {
-        fmt::print(_imp->proof_file, "u 1 ~x{}", _imp->variable_mappings[pair{ p.first, t.first }]);
+        out << "u 1 ~x" << _imp->variable_mappings[pair{ p.first, t.first }];
         for (auto & u : _imp->t_clique_neighbourhood)
-            fmt::print(_imp->proof_file, " 1 x{}", _imp->variable_mappings[pair{ q.first, u.second.first }]);
-        fmt::println(_imp->proof_file, " >= 1 ;");
+            out << " 1 x" << _imp->variable_mappings[pair{ q.first, u.second.first }];
+        out << " >= 1 ;\n";
         to_sum.push_back(++_imp->proof_line);
     }
 
-    fmt::print(_imp->proof_file, "p");
+    out << "p";
     bool first = true;
     for (auto & t : to_sum) {
-        fmt::print(_imp->proof_file, " {}", t);
+        out << " " << t;
         if (! first)
-            fmt::print(_imp->proof_file, " +");
+            out << " +";
         first = false;
     }
-    fmt::println(_imp->proof_file, "");
+    out << "\n";
     _imp->objective_line = ++_imp->proof_line;
 
-    fmt::println(_imp->proof_file, "* hom clique non edges for injectivity");
+    out << "* hom clique non edges for injectivity\n";
 
     for (auto & p : _imp->p_clique)
         for (auto & q : _imp->p_clique)
             if (p != q) {
                 for (auto & [ _, t ] : _imp->t_clique_neighbourhood) {
-                    fmt::println(_imp->proof_file, "u 1 ~x{} 1 ~x{} >= 1 ;", _imp->variable_mappings[pair{ p.first, t.first }], _imp->variable_mappings[pair{ q.first, t.first }]);
+                    out << "u 1 ~x" << _imp->variable_mappings[pair{ p.first, t.first }] << " 1 ~x" << _imp->variable_mappings[pair{ q.first, t.first }] << " >= 1 ;\n";
                     ++_imp->proof_line;
                     _imp->clique_for_hom_non_edge_constraints.emplace(pair{ pair{ p, t }, pair{ q, t } }, _imp->proof_line);
                     _imp->clique_for_hom_non_edge_constraints.emplace(pair{ pair{ q, t }, pair{ p, t } }, _imp->proof_line);
                 }
             }
 
-    fmt::println(_imp->proof_file, "* hom clique non edges for variables");
+    out << "* hom clique non edges for variables\n";
 
     for (auto & p : _imp->p_clique)
         for (auto & [ _, t ] : _imp->t_clique_neighbourhood) {
             for (auto & [ _, u ] : _imp->t_clique_neighbourhood) {
                 if (t != u) {
-                    fmt::println(_imp->proof_file, "u 1 ~x{} 1 ~x{} >= 1 ;", _imp->variable_mappings[pair{ p.first, t.first }], _imp->variable_mappings[pair{ p.first, u.first }]);
+                    out << "u 1 ~x" << _imp->variable_mappings[pair{ p.first, t.first }] << " 1 ~x" << _imp->variable_mappings[pair{ p.first, u.first }] << " >= 1 ;\n";
                     ++_imp->proof_line;
                     _imp->clique_for_hom_non_edge_constraints.emplace(pair{ pair{ p, t }, pair{ p, u } }, _imp->proof_line);
                     _imp->clique_for_hom_non_edge_constraints.emplace(pair{ pair{ p, u }, pair{ p, t } }, _imp->proof_line);
@@ -1728,10 +962,11 @@ auto Proof::start_hom_clique_proof(const NamedVertex & p, vector<NamedVertex> &&
 
 auto Proof::finish_hom_clique_proof(const NamedVertex & p, const NamedVertex & t, unsigned size) -> void
 {
-    fmt::println(_imp->proof_file, "* end clique of size {} around neighbourhood of {} but not {}", size, p.second, t.second);
-    fmt::println(_imp->proof_file, "# 0");
-    fmt::println(_imp->proof_file, "u 1 ~x{} >= 1 ;", _imp->variable_mappings[pair{ p.first, t.first }]);
-    fmt::println(_imp->proof_file, "w 1");
+    auto & out = _imp->logger->text();
+    out << "* end clique of size " << size << " around neighbourhood of " << p.second << " but not " << t.second << "\n";
+    out << "# 0\n";
+    out << "u 1 ~x" << _imp->variable_mappings[pair{ p.first, t.first }] << " >= 1 ;\n";
+    out << "w 1\n";
     ++_imp->proof_line;
     _imp->doing_hom_colour_proof = false;
     _imp->clique_for_hom_non_edge_constraints.clear();
@@ -1744,11 +979,14 @@ auto Proof::add_hom_clique_non_edge(
         const NamedVertex & t,
         const NamedVertex & u) -> void
 {
-    fmt::println(_imp->proof_file, "* hom clique non edges for {} {}", t.second, u.second);
+    auto & out = _imp->logger->text();
+    out << "* hom clique non edges for " << t.second << " " << u.second << "\n";
     for (auto & p : p_clique) {
         for (auto & q : p_clique) {
             if (p != q) {
-                fmt::println(_imp->proof_file, "u 1 ~x{} 1 ~x{} 1 ~x{} >= 1 ;", _imp->variable_mappings[pair{ pp.first, tt.first }], _imp->variable_mappings[pair{ p.first, t.first }], _imp->variable_mappings[pair{ q.first, u.first }]);
+                out << "u 1 ~x" << _imp->variable_mappings[pair{ pp.first, tt.first }]
+                    << " 1 ~x" << _imp->variable_mappings[pair{ p.first, t.first }]
+                    << " 1 ~x" << _imp->variable_mappings[pair{ q.first, u.first }] << " >= 1 ;\n";
                 ++_imp->proof_line;
                 _imp->clique_for_hom_non_edge_constraints.emplace(pair{ pair{ p, t }, pair{ q, u } }, _imp->proof_line);
                 _imp->clique_for_hom_non_edge_constraints.emplace(pair{ pair{ q, u }, pair{ p, t } }, _imp->proof_line);
@@ -1759,10 +997,11 @@ auto Proof::add_hom_clique_non_edge(
 
 auto Proof::not_connected_in_underlying_graph(const std::vector<int> & x, int y) -> void
 {
-    fmt::print(_imp->proof_file, "u 1 ~x{}", _imp->binary_variable_mappings[y]);
+    auto & out = _imp->logger->text();
+    out << "u 1 ~x" << _imp->binary_variable_mappings[y];
     for (auto & v : x)
-        fmt::print(_imp->proof_file, " 1 ~x{}", _imp->binary_variable_mappings[v]);
-    fmt::println(_imp->proof_file, " >= 1 ;");
+        out << " 1 ~x" << _imp->binary_variable_mappings[v];
+    out << " >= 1 ;\n";
     ++_imp->proof_line;
 }
 
@@ -1776,8 +1015,11 @@ auto Proof::create_clique_encoding(
         const vector<pair<int, int> > & zero_in_proof_objectives) -> void
 {
     _imp->clique_encoding = true;
-    for (unsigned i = 0 ; i < enc.size() ; ++i)
-        _imp->binary_variable_mappings.emplace(i, _imp->variable_mappings[enc[i]]);
+    for (unsigned i = 0 ; i < enc.size() ; ++i) {
+        auto [ mapping, inserted ] = _imp->binary_variable_mappings.emplace(i, _imp->variable_mappings[enc[i]]);
+        if (inserted)
+            _imp->literal_tokens.add(i, mapping->second);
+    }
 
     _imp->zero_in_proof_objectives = zero_in_proof_objectives;
 }
@@ -1789,17 +1031,17 @@ auto Proof::super_extra_verbose() const -> bool
 
 auto Proof::show_domains(const string & s, const std::vector<std::pair<NamedVertex, std::vector<NamedVertex> > > & domains) -> void
 {
-    fmt::println(_imp->proof_file, "* {} domains follow", s);
+    auto & out = _imp->logger->text();
+    out << "* " << s << ", domains follow\n";
     for (auto & [ p, ts ] : domains) {
-        fmt::print(_imp->proof_file, "*    {} size {} = {", p.second, ts.size());
+        out << "*    " << p.second << " size " << ts.size() << " = {";
         for (auto & t : ts)
-            fmt::print(_imp->proof_file, " {}", t.second);
-        fmt::println(_imp->proof_file, " }");
+            out << " " << t.second;
+        out << " }\n";
     }
 }
 
 auto Proof::propagated(const NamedVertex & p, const NamedVertex & t, int g, int n_values, const NamedVertex & q) -> void
 {
-    fmt::println(_imp->proof_file, "* adjacency propagation from {} -> {} in graph pairs {} deleted {} values from {}", p.second, t.second, g, n_values, q.second);
+    _imp->logger->text() << "* adjacency propagation from " << p.second << " -> " << t.second << " in graph pairs " << g << " deleted " << n_values << " values from " << q.second << "\n";
 }
-#endif
\ No newline at end of file
@@ -29,6 +29,89 @@ class ProofError : public std::exception
 
 using NamedVertex = std::pair<int, std::string>;
 
+/**
+ * A vertex that doesn't form a triangle with any vertex from one colour
+ * class and any vertex from another, so that the vertex and the two
+ * classes together contribute at most two vertices to a clique.
+ */
+struct InfraChromaticConflict
+{
+    /// The extra vertex, which isn't in any of the colour classes
+    int vertex;
+
+    /// Which two colour classes it conflicts with
+    unsigned first_class, second_class;
+
+    /// The members of each of the two classes that are adjacent to vertex
+    std::vector<int> first_neighbours, second_neighbours;
+};
+
+enum class ProofFormat
+{
+    Text,
+    Binary
+};
+
+enum class ProofCompression
+{
+    None,
+    Bz2,
+    Zstd,
+    Lz4
+};
+
+enum class ProofSink
+{
+    IOStreamEndl,
+    IOStream,
+    Fmt,
+    Raw
+};
+
+struct ProofOptions
+{
+    /// Where to write the OPB model
+    std::string opb_file;
+
+    /// Where to write the proof log
+    std::string log_file;
+
+    /// Use 'friendly' variable names, rather than x1, x2, ...
+    bool friendly_names = false;
+
+    /// Compress the model and the log, in blocks, using a pool of threads
+    ProofCompression compression = ProofCompression::None;
+
+    /// Compression level, or zero for the compressor's default
+    int compression_level = 0;
+
+    /// Threads to compress with, or zero for one per hardware thread
+    unsigned compression_threads = 0;
+
+    /// Write the log from a separate thread, rather than from the search thread
+    bool async = false;
+
+    /// Write a VeriPB text log, or a compact binary log for proof_expand
+    ProofFormat format = ProofFormat::Text;
+
+    /// How to write a text log: iostreams flushing every line (as the solver
+    /// originally did), iostreams, fmt, or our own buffer and write(2)
+    ProofSink sink = ProofSink::IOStreamEndl;
+
+    /// Write comments describing each colour bound and backtrack
+    bool bound_comments = true;
+
+    /// Don't write the (repeated) sum line for a colour class of size one
+    bool skip_singleton_colour_classes = false;
+
+    /// Look up non-edge constraint IDs in a flat triangular table (or a
+    /// sparse version of it for very large graphs), rather than a map
+    bool dense_constraint_ids = false;
+
+    /// Log lots of extra detail
+    bool super_extra_verbose = false;
+};
+
 class Proof
 {
     private:
@@ -36,7 +119,7 @@ class Proof
         std::unique_ptr<Imp> _imp;
 
     public:
-        Proof(const std::string & opb_file, const std::string & log_file, bool friendly_names, bool bz2, bool super_extra_verbose = false);
+        explicit Proof(const ProofOptions &);
         Proof(Proof &&);
         ~Proof();
         auto operator= (Proof &&) -> Proof &;
@@ -56,6 +139,16 @@ class Proof
         auto start_adjacency_constraints_for(int p, int t) -> void;
         auto create_adjacency_constraint(int p, int q, int t, const std::vector<int> & u, bool induced) -> void;
 
+        /**
+         * Start writing the model straight to the OPB file, rather than
+         * buffering it until finalise_model(). The counts in the header
+         * must be known up front, and finalise_model() will check that the
+         * model ended up with exactly this many variables and constraints.
+         * Variables must already have been created, and the objective must
+         * be created before any constraints.
+         */
+        auto start_model(int number_of_variables, long number_of_constraints) -> void;
+
         auto finalise_model() -> void;
 
         // when we're done
@@ -83,12 +176,10 @@ class Proof
         auto create_binary_variable(int vertex,
                 const std::function<auto (int) -> std::string> & name) -> void;
         auto create_objective(int n, std::optional<int> d) -> void;
-#ifdef VECTOR
-        auto create_non_edge_constraint_vector(int n) -> void;
-#endif
         auto create_non_edge_constraint(int p, int q) -> void;
         auto backtrack_from_binary_variables(const std::vector<int> &) -> void;
         auto colour_bound(const std::vector<std::vector<int> > &) -> void;
+        auto colour_bound(const std::vector<std::vector<int> > &, const std::vector<InfraChromaticConflict> &) -> void;
 
         // clique for hom
         auto prepare_hom_clique_proof(const NamedVertex & p,
@@ -0,0 +1,288 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#include "proof_binary.hh"
+
+#include <istream>
+#include <string>
+
+using std::istream;
+using std::ostream;
+using std::streambuf;
+using std::streamsize;
+using std::string;
+using std::string_view;
+using std::to_string;
+using std::unique_ptr;
+using std::vector;
+
+using binary_proof::Opcode;
+
+BinaryProofError::BinaryProofError(const string & m) noexcept :
+    _message("Binary proof error: " + m)
+{
+}
+
+auto BinaryProofError::what() const noexcept -> const char *
+{
+    return _message.c_str();
+}
+
+BinaryProofWriter::LineBuffer::LineBuffer(BinaryProofWriter & w) :
+    _writer(w)
+{
+}
+
+auto BinaryProofWriter::LineBuffer::overflow(int_type c) -> int_type
+{
+    if (traits_type::eq_int_type(c, traits_type::eof()))
+        return traits_type::not_eof(c);
+
+    char ch = traits_type::to_char_type(c);
+    xsputn(&ch, 1);
+    return c;
+}
+
+auto BinaryProofWriter::LineBuffer::xsputn(const char * s, streamsize n) -> streamsize
+{
+    string_view rest{ s, size_t(n) };
+    for (auto nl = rest.find('\n') ; nl != string_view::npos ; nl = rest.find('\n')) {
+        _writer._line.append(rest.substr(0, nl));
+        _writer.text_line(_writer._line);
+        _writer._line.clear();
+        rest.remove_prefix(nl + 1);
+    }
+    _writer._line.append(rest);
+    return n;
+}
+
+BinaryProofWriter::BinaryProofWriter(unique_ptr<ostream> && underlying) :
+    std::ostream(nullptr),
+    _underlying(std::move(underlying)),
+    _line_buffer(*this)
+{
+    rdbuf(&_line_buffer);
+    _out.reserve(2 * write_threshold);
+    _out.append(binary_proof::magic);
+}
+
+BinaryProofWriter::~BinaryProofWriter()
+{
+    if (_underlying)
+        close();
+}
+
+auto BinaryProofWriter::text_line(string_view s) -> void
+{
+    put_opcode(Opcode::Text);
+    put_bytes(s);
+    end_record();
+}
+
+auto BinaryProofWriter::write_out() -> void
+{
+    if (! _underlying->write(_out.data(), _out.size()))
+        setstate(badbit);
+    _out.clear();
+}
+
+auto BinaryProofWriter::level(int l) -> void
+{
+    put_opcode(Opcode::Level);
+    put_varint(l);
+    end_record();
+}
+
+auto BinaryProofWriter::forget_level(int l) -> void
+{
+    put_opcode(Opcode::ForgetLevel);
+    put_varint(l);
+    end_record();
+}
+
+auto BinaryProofWriter::sum(long first, const vector<long> & rest) -> void
+{
+    put_opcode(Opcode::Sum);
+    put_varint(first);
+    put_varint(rest.size());
+    for (auto & t : rest)
+        put_varint(t);
+    end_record();
+}
+
+auto BinaryProofWriter::bound_comment(const vector<vector<int> > & ccs) -> void
+{
+    put_opcode(Opcode::BoundComment);
+    put_varint(ccs.size());
+    for (auto & cc : ccs) {
+        put_varint(cc.size());
+        for (auto & c : cc)
+            put_varint(c);
+    }
+    end_record();
+}
+
+auto BinaryProofWriter::close() -> void
+{
+    if (! _line.empty()) {
+        text_line(_line);
+        _line.clear();
+    }
+
+    write_out();
+    if (! _underlying->flush())
+        setstate(badbit);
+    _underlying.reset();
+}
+
+namespace
+{
+    class Reader
+    {
+        private:
+            streambuf & _in;
+
+        public:
+            explicit Reader(istream & in) :
+                _in(*in.rdbuf())
+            {
+            }
+
+            auto at_end() -> bool
+            {
+                return std::char_traits<char>::eq_int_type(_in.sgetc(), std::char_traits<char>::eof());
+            }
+
+            auto byte() -> unsigned char
+            {
+                auto c = _in.sbumpc();
+                if (std::char_traits<char>::eq_int_type(c, std::char_traits<char>::eof()))
+                    throw BinaryProofError{ "unexpected end of file" };
+                return std::char_traits<char>::to_char_type(c);
+            }
+
+            auto varint() -> unsigned long long
+            {
+                unsigned long long result = 0;
+                for (int shift = 0 ; ; shift += 7) {
+                    if (shift > 63)
+                        throw BinaryProofError{ "varint too long" };
+                    unsigned char b = byte();
+                    result |= (static_cast<unsigned long long>(b & 0x7f) << shift);
+                    if (! (b & 0x80))
+                        return result;
+                }
+            }
+
+            auto bytes() -> string
+            {
+                string result(varint(), '\0');
+                if (streamsize(result.size()) != _in.sgetn(result.data(), result.size()))
+                    throw BinaryProofError{ "unexpected end of file" };
+                return result;
+            }
+    };
+}
+
+auto expand_binary_proof(istream & in, ostream & out) -> void
+{
+    if (! in.rdbuf())
+        throw BinaryProofError{ "cannot read input" };
+
+    Reader reader{ in };
+
+    for (auto c : binary_proof::magic)
+        if (char(reader.byte()) != c)
+            throw BinaryProofError{ "not a binary proof log (bad header)" };
+
+    vector<string> names;
+    auto name = [&] (unsigned long long v) -> const string & {
+        if (v >= names.size() || names[v].empty())
+            throw BinaryProofError{ "literal " + to_string(v) + " used before being named" };
+        return names[v];
+    };
+
+    string line;
+    while (! reader.at_end()) {
+        line.clear();
+        auto op = reader.varint();
+        switch (static_cast<Opcode>(op)) {
+            case Opcode::Text:
+                line = reader.bytes();
+                break;
+
+            case Opcode::VariableName:
+                {
+                    auto v = reader.varint();
+                    if (v >= names.size())
+                        names.resize(v + 1);
+                    names[v] = reader.bytes();
+                }
+                continue;
+
+            case Opcode::Level:
+                line = "# " + to_string(reader.varint());
+                break;
+
+            case Opcode::ForgetLevel:
+                line = "w " + to_string(reader.varint());
+                break;
+
+            case Opcode::NegatedRUP:
+                line = "u";
+                for (auto k = reader.varint() ; k > 0 ; --k)
+                    line.append(" 1 ~x").append(name(reader.varint()));
+                line.append(" >= 1 ;");
+                break;
+
+            case Opcode::Objective:
+                line = "o";
+                for (auto k = reader.varint() ; k > 0 ; --k) {
+                    auto l = reader.varint();
+                    line.append((l & 1) ? " ~x" : " x").append(name(l >> 1));
+                }
+                break;
+
+            case Opcode::Solution:
+                line = "v";
+                for (auto k = reader.varint() ; k > 0 ; --k)
+                    line.append(" x").append(name(reader.varint()));
+                break;
+
+            case Opcode::ColourClass:
+                {
+                    auto k = reader.varint();
+                    line = "p " + to_string(reader.varint());
+                    for (unsigned long long i = 2 ; i < k ; ++i) {
+                        line.append(" ").append(to_string(i)).append(" *");
+                        for (unsigned long long j = 0 ; j < i ; ++j)
+                            line.append(" ").append(to_string(reader.varint())).append(" +");
+                        line.append(" ").append(to_string(i + 1)).append(" d");
+                    }
+                }
+                break;
+
+            case Opcode::Sum:
+                line = "p " + to_string(reader.varint());
+                for (auto k = reader.varint() ; k > 0 ; --k)
+                    line.append(" ").append(to_string(reader.varint())).append(" +");
+                break;
+
+            case Opcode::BoundComment:
+                line = "* bound, ccs";
+                for (auto n = reader.varint() ; n > 0 ; --n) {
+                    line.append(" [");
+                    for (auto k = reader.varint() ; k > 0 ; --k)
+                        line.append(" ").append(to_string(reader.varint()));
+                    line.append(" ]");
+                }
+                break;
+
+            default:
+                throw BinaryProofError{ "unknown opcode " + to_string(op) };
+        }
+
+        line.push_back('\n');
+        if (! out.write(line.data(), line.size()))
+            throw BinaryProofError{ "error writing output" };
+    }
+}
@@ -0,0 +1,206 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#ifndef GLASGOW_SUBGRAPH_SOLVER_GUARD_SRC_PROOF_BINARY_HH
+#define GLASGOW_SUBGRAPH_SOLVER_GUARD_SRC_PROOF_BINARY_HH 1
+
+#include <cassert>
+#include <cstddef>
+#include <exception>
+#include <iosfwd>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * The compact binary proof log is a magic line followed by a sequence of
+ * records. Each record is a varint opcode followed by varint operands. The
+ * commonest proof lines get their own record, so constraint IDs and
+ * literals are never turned into text on the search thread. Anything else
+ * is carried verbatim in a Text record. Literals are vertex indices; a
+ * VariableName record gives the name for an index before its first use.
+ */
+namespace binary_proof
+{
+    inline constexpr std::string_view magic = "glasgow binary pseudo-Boolean proof 1\n";
+
+    enum class Opcode : unsigned
+    {
+        Text = 1,           // length, bytes: a line, without its newline
+        VariableName,       // index, length, bytes
+        Level,              // l: "# l"
+        ForgetLevel,        // l: "w l"
+        NegatedRUP,         // k, k literals: "u 1 ~x.. >= 1 ;"
+        Objective,          // k, k of (literal << 1 | negated): "o x.. ~x.."
+        Solution,           // k, k literals: "v x.."
+        ColourClass,        // k, then k(k-1)/2 constraint IDs: "p a 2 * b + c + 3 d ..."
+        Sum,                // first, k, k constraint IDs: "p first a + b + ..."
+        BoundComment        // number of classes, then size and vertices of each
+    };
+}
+
+class BinaryProofError : public std::exception
+{
+    private:
+        std::string _message;
+
+    public:
+        BinaryProofError(const std::string & message) noexcept;
+
+        virtual auto what() const noexcept -> const char *;
+};
+
+/**
+ * Writes a binary proof log. Anything written using the ostream interface
+ * is treated as text, and is stored one line per Text record.
+ */
+class BinaryProofWriter : public std::ostream
+{
+    private:
+        class LineBuffer : public std::streambuf
+        {
+            private:
+                BinaryProofWriter & _writer;
+
+            protected:
+                auto overflow(int_type c) -> int_type override;
+                auto xsputn(const char * s, std::streamsize n) -> std::streamsize override;
+
+            public:
+                explicit LineBuffer(BinaryProofWriter &);
+        };
+
+        static constexpr std::size_t write_threshold = 1 << 16;
+
+        std::unique_ptr<std::ostream> _underlying;
+        LineBuffer _line_buffer;
+        std::string _line, _out;
+        std::vector<bool> _named;
+
+        auto put_varint(unsigned long long v) -> void
+        {
+            while (v >= 0x80) {
+                _out.push_back(char((v & 0x7f) | 0x80));
+                v >>= 7;
+            }
+            _out.push_back(char(v));
+        }
+
+        auto put_opcode(binary_proof::Opcode op) -> void
+        {
+            put_varint(static_cast<unsigned>(op));
+        }
+
+        auto put_bytes(std::string_view s) -> void
+        {
+            put_varint(s.size());
+            _out.append(s);
+        }
+
+        auto end_record() -> void
+        {
+            if (_out.size() >= write_threshold)
+                write_out();
+        }
+
+        template <typename Name_>
+        auto name(int v, const Name_ & n) -> void
+        {
+            if (unsigned(v) >= _named.size())
+                _named.resize(v + 1, false);
+
+            if (! _named[v]) {
+                _named[v] = true;
+                put_opcode(binary_proof::Opcode::VariableName);
+                put_varint(v);
+                put_bytes(n(v));
+            }
+        }
+
+        auto text_line(std::string_view) -> void;
+        auto write_out() -> void;
+
+    public:
+        explicit BinaryProofWriter(std::unique_ptr<std::ostream> && underlying);
+        ~BinaryProofWriter() override;
+
+        BinaryProofWriter(const BinaryProofWriter &) = delete;
+        auto operator= (const BinaryProofWriter &) -> BinaryProofWriter & = delete;
+
+        auto level(int l) -> void;
+        auto forget_level(int l) -> void;
+        auto sum(long first, const std::vector<long> & rest) -> void;
+        auto bound_comment(const std::vector<std::vector<int> > & ccs) -> void;
+
+        template <typename Name_>
+        auto negated_rup(const std::vector<int> & literals, const Name_ & n) -> void
+        {
+            for (auto & l : literals)
+                name(l, n);
+            put_opcode(binary_proof::Opcode::NegatedRUP);
+            put_varint(literals.size());
+            for (auto & l : literals)
+                put_varint(l);
+            end_record();
+        }
+
+        template <typename Name_>
+        auto objective(const std::vector<std::pair<int, bool> > & literals, const Name_ & n) -> void
+        {
+            for (auto & [ l, _ ] : literals)
+                name(l, n);
+            put_opcode(binary_proof::Opcode::Objective);
+            put_varint(literals.size());
+            for (auto & [ l, t ] : literals)
+                put_varint((static_cast<unsigned long long>(l) << 1) | (t ? 0 : 1));
+            end_record();
+        }
+
+        template <typename Name_>
+        auto solution(const std::vector<int> & literals, const Name_ & n) -> void
+        {
+            for (auto & l : literals)
+                name(l, n);
+            put_opcode(binary_proof::Opcode::Solution);
+            put_varint(literals.size());
+            for (auto & l : literals)
+                put_varint(l);
+            end_record();
+        }
+
+        /**
+         * Cutting planes derivation of an at-most-one constraint over a
+         * colour class of the given size, which must be at least two, where
+         * non_edge_constraint(i, j) gives the constraint ID for the i'th and
+         * j'th members.
+         */
+        template <typename NonEdgeConstraint_>
+        auto colour_class(unsigned size, const NonEdgeConstraint_ & non_edge_constraint) -> void
+        {
+            assert(size >= 2);
+            put_opcode(binary_proof::Opcode::ColourClass);
+            put_varint(size);
+            put_varint(non_edge_constraint(0, 1));
+            for (unsigned i = 2 ; i < size ; ++i)
+                for (unsigned j = 0 ; j < i ; ++j)
+                    put_varint(non_edge_constraint(i, j));
+            end_record();
+        }
+
+        /**
+         * Write everything we have so far, and close the underlying stream.
+         */
+        auto close() -> void;
+};
+
+/**
+ * Turn a binary proof log back into a VeriPB text proof log.
+ *
+ * \throw BinaryProofError
+ */
+auto expand_binary_proof(std::istream & in, std::ostream & out) -> void;
+
+#endif
@@ -0,0 +1,85 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#include "proof_binary.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <boost/iostreams/device/file.hpp>
+#include <boost/iostreams/filter/bzip2.hpp>
+#include <boost/iostreams/filter/zstd.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::exception;
+using std::ios;
+using std::ofstream;
+using std::string;
+
+using boost::iostreams::bzip2_decompressor;
+using boost::iostreams::file_source;
+using boost::iostreams::filtering_istream;
+using boost::iostreams::zstd_decompressor;
+
+namespace
+{
+    auto ends_with(const string & s, const string & suffix) -> bool
+    {
+        return s.size() >= suffix.size() && 0 == s.compare(s.size() - suffix.size(), suffix.size(), suffix);
+    }
+}
+
+auto main(int argc, char * argv[]) -> int
+{
+    if (argc < 2 || argc > 3) {
+        cerr << "Usage: " << argv[0] << " binary-proof-file [output-file]" << endl;
+        cerr << "Expands a proof written using --proof-format=binary back into a VeriPB proof log." << endl;
+        cerr << "If no output file is given, foo.veripb.bin(.bz2 / .zst) is expanded to foo.veripb, and" << endl;
+        cerr << "anything else is written to standard output. Use - for standard output." << endl;
+        return EXIT_FAILURE;
+    }
+
+    try {
+        string in_name = argv[1];
+        bool bz2 = ends_with(in_name, ".bz2"), zstd = ends_with(in_name, ".zst");
+        string stripped = bz2 || zstd ? in_name.substr(0, in_name.size() - 4) : in_name;
+
+        filtering_istream in;
+        if (bz2)
+            in.push(bzip2_decompressor());
+        else if (zstd)
+            in.push(zstd_decompressor());
+        in.push(file_source(in_name, ios::in | ios::binary));
+        if (! in.component<file_source>(bz2 || zstd ? 1 : 0)->is_open()) {
+            cerr << "Error: cannot open '" << in_name << "'" << endl;
+            return EXIT_FAILURE;
+        }
+
+        string out_name = argc == 3 ? argv[2] : ends_with(stripped, ".bin") ? stripped.substr(0, stripped.size() - 4) : "-";
+        if (out_name == "-")
+            expand_binary_proof(in, cout);
+        else {
+            ofstream out{ out_name, ios::out | ios::binary };
+            if (! out) {
+                cerr << "Error: cannot write to '" << out_name << "'" << endl;
+                return EXIT_FAILURE;
+            }
+            expand_binary_proof(in, out);
+            if (! out.flush()) {
+                cerr << "Error: error writing to '" << out_name << "'" << endl;
+                return EXIT_FAILURE;
+            }
+        }
+
+        return EXIT_SUCCESS;
+    }
+    catch (const exception & e) {
+        cerr << "Error: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,97 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#include "proof_sinks.hh"
+
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using std::size_t;
+using std::streamsize;
+using std::string;
+
+FileDescriptorStream::Buffer::Buffer(int fd) :
+    _fd(fd),
+    _buffer(new char[buffer_size])
+{
+    setp(_buffer.get(), _buffer.get() + buffer_size);
+}
+
+FileDescriptorStream::Buffer::~Buffer()
+{
+    if (_fd >= 0) {
+        drain();
+        ::close(_fd);
+    }
+}
+
+auto FileDescriptorStream::Buffer::is_open() const -> bool
+{
+    return _fd >= 0;
+}
+
+auto FileDescriptorStream::Buffer::write_all(const char * s, size_t n) -> bool
+{
+    while (n > 0) {
+        auto written = ::write(_fd, s, n);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        s += written;
+        n -= written;
+    }
+
+    return true;
+}
+
+auto FileDescriptorStream::Buffer::drain() -> bool
+{
+    bool ok = write_all(pbase(), pptr() - pbase());
+    setp(_buffer.get(), _buffer.get() + buffer_size);
+    return ok;
+}
+
+auto FileDescriptorStream::Buffer::overflow(int_type c) -> int_type
+{
+    if (! drain())
+        return traits_type::eof();
+
+    if (! traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+
+    return traits_type::not_eof(c);
+}
+
+auto FileDescriptorStream::Buffer::xsputn(const char * s, streamsize n) -> streamsize
+{
+    if (n > epptr() - pptr()) {
+        if (! drain())
+            return 0;
+
+        if (size_t(n) >= buffer_size)
+            return write_all(s, n) ? n : 0;
+    }
+
+    traits_type::copy(pptr(), s, n);
+    pbump(int(n));
+    return n;
+}
+
+auto FileDescriptorStream::Buffer::sync() -> int
+{
+    return drain() ? 0 : -1;
+}
+
+FileDescriptorStream::FileDescriptorStream(const string & filename) :
+    std::ostream(nullptr),
+    _buffer(::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666))
+{
+    rdbuf(&_buffer);
+    if (! _buffer.is_open())
+        setstate(failbit);
+}
@@ -0,0 +1,441 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#ifndef GLASGOW_SUBGRAPH_SOLVER_GUARD_SRC_PROOF_SINKS_HH
+#define GLASGOW_SUBGRAPH_SOLVER_GUARD_SRC_PROOF_SINKS_HH 1
+
+#include "proof_binary.hh"
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+/**
+ * An output stream writing straight to a file descriptor using write(2),
+ * with a modest buffer for small writes. Large writes skip the buffer.
+ */
+class FileDescriptorStream : public std::ostream
+{
+    private:
+        class Buffer : public std::streambuf
+        {
+            private:
+                int _fd;
+                std::unique_ptr<char[]> _buffer;
+
+                auto write_all(const char * s, std::size_t n) -> bool;
+                auto drain() -> bool;
+
+            protected:
+                auto overflow(int_type c) -> int_type override;
+                auto xsputn(const char * s, std::streamsize n) -> std::streamsize override;
+                auto sync() -> int override;
+
+            public:
+                static constexpr std::size_t buffer_size = 1 << 16;
+
+                explicit Buffer(int fd);
+                ~Buffer() override;
+
+                auto is_open() const -> bool;
+        };
+
+        Buffer _buffer;
+
+    public:
+        explicit FileDescriptorStream(const std::string & filename);
+
+        FileDescriptorStream(const FileDescriptorStream &) = delete;
+        auto operator= (const FileDescriptorStream &) -> FileDescriptorStream & = delete;
+};
+
+/**
+ * The text of each binary variable's literals, rendered once when the
+ * variable is created, so that writing a literal never involves a map
+ * lookup or any formatting. Each vertex gets " 1 ~x<name>" in one flat
+ * buffer, and the other forms we need are suffixes of this.
+ */
+class LiteralTokens
+{
+    private:
+        std::string _text;
+        std::vector<std::pair<std::uint32_t, std::uint32_t> > _tokens;
+
+        auto token(int v) const -> std::string_view
+        {
+            return std::string_view{ _text.data() + _tokens[v].first, _tokens[v].second };
+        }
+
+    public:
+        auto add(int v, std::string_view name) -> void
+        {
+            if (unsigned(v) >= _tokens.size())
+                _tokens.resize(v + 1);
+            _tokens[v] = { std::uint32_t(_text.size()), std::uint32_t(name.size() + 5) };
+            _text.append(" 1 ~x").append(name);
+        }
+
+        /// " 1 ~x<name>", for a term in a negated clause
+        auto negated_term(int v) const -> std::string_view
+        {
+            return token(v);
+        }
+
+        /// " ~x<name>"
+        auto negated(int v) const -> std::string_view
+        {
+            return token(v).substr(2);
+        }
+
+        /// "<name>"
+        auto name(int v) const -> std::string_view
+        {
+            return token(v).substr(5);
+        }
+};
+
+/**
+ * Proof sinks turn proof lines into bytes. The text sinks share the line
+ * layouts in TextProofSink, and differ only in how they write strings,
+ * numbers and newlines. Everything not worth a dedicated operation goes
+ * through text(), after any pending output has been handed on.
+ */
+template <typename Derived_>
+class TextProofSink
+{
+    private:
+        auto derived() -> Derived_ &
+        {
+            return static_cast<Derived_ &>(*this);
+        }
+
+    public:
+        auto level(int l) -> void
+        {
+            derived().put("# ");
+            derived().put_number(l);
+            derived().end_line();
+        }
+
+        auto forget_level(int l) -> void
+        {
+            derived().put("w ");
+            derived().put_number(l);
+            derived().end_line();
+        }
+
+        auto negated_rup(const std::vector<int> & literals, const LiteralTokens & tokens) -> void
+        {
+            derived().put("u");
+            for (auto & l : literals)
+                derived().put(tokens.negated_term(l));
+            derived().put(" >= 1 ;");
+            derived().end_line();
+        }
+
+        auto objective(const std::vector<std::pair<int, bool> > & literals, const LiteralTokens & tokens) -> void
+        {
+            derived().put("o");
+            for (auto & [ l, t ] : literals) {
+                if (t) {
+                    derived().put(" x");
+                    derived().put(tokens.name(l));
+                }
+                else
+                    derived().put(tokens.negated(l));
+            }
+            derived().end_line();
+        }
+
+        auto solution(const std::vector<int> & literals, const LiteralTokens & tokens) -> void
+        {
+            derived().put("v");
+            for (auto & l : literals) {
+                derived().put(" x");
+                derived().put(tokens.name(l));
+            }
+            derived().end_line();
+        }
+
+        template <typename NonEdgeConstraint_>
+        auto colour_class(unsigned size, const NonEdgeConstraint_ & non_edge_constraint) -> void
+        {
+            derived().put("p ");
+            derived().put_number(non_edge_constraint(0, 1));
+
+            for (unsigned i = 2 ; i < size ; ++i) {
+                derived().put(" ");
+                derived().put_number(i);
+                derived().put(" *");
+                for (unsigned j = 0 ; j < i ; ++j) {
+                    derived().put(" ");
+                    derived().put_number(non_edge_constraint(i, j));
+                    derived().put(" +");
+                }
+                derived().put(" ");
+                derived().put_number(i + 1);
+                derived().put(" d");
+            }
+
+            derived().end_line();
+        }
+
+        auto sum(long first, const std::vector<long> & rest) -> void
+        {
+            derived().put("p ");
+            derived().put_number(first);
+            for (auto & t : rest) {
+                derived().put(" ");
+                derived().put_number(t);
+                derived().put(" +");
+            }
+            derived().end_line();
+        }
+
+        auto bound_comment(const std::vector<std::vector<int> > & ccs) -> void
+        {
+            derived().put("* bound, ccs");
+            for (auto & cc : ccs) {
+                derived().put(" [");
+                for (auto & c : cc) {
+                    derived().put(" ");
+                    derived().put_number(c);
+                }
+                derived().put(" ]");
+            }
+            derived().end_line();
+        }
+};
+
+/**
+ * Writes using operator<< on the underlying stream, optionally with
+ * std::endl rather than '\n' (which is what the original proof logging
+ * code did).
+ */
+template <bool flush_every_line_>
+class IOStreamProofSink : public TextProofSink<IOStreamProofSink<flush_every_line_> >
+{
+    private:
+        std::unique_ptr<std::ostream> _out;
+
+    public:
+        explicit IOStreamProofSink(std::unique_ptr<std::ostream> && out) :
+            _out(std::move(out))
+        {
+        }
+
+        auto put(std::string_view s) -> void
+        {
+            *_out << s;
+        }
+
+        auto put_number(long n) -> void
+        {
+            *_out << n;
+        }
+
+        auto end_line() -> void
+        {
+            if constexpr (flush_every_line_)
+                *_out << std::endl;
+            else
+                *_out << '\n';
+        }
+
+        auto text() -> std::ostream &
+        {
+            return *_out;
+        }
+};
+
+/**
+ * Formats using fmt into a memory buffer, which is handed to the underlying
+ * stream in large chunks.
+ */
+class FmtProofSink : public TextProofSink<FmtProofSink>
+{
+    private:
+        static constexpr std::size_t write_threshold = 1 << 16;
+
+        std::unique_ptr<std::ostream> _out;
+        fmt::memory_buffer _buffer;
+
+        auto write_out() -> void
+        {
+            _out->write(_buffer.data(), _buffer.size());
+            _buffer.clear();
+        }
+
+    public:
+        explicit FmtProofSink(std::unique_ptr<std::ostream> && out) :
+            _out(std::move(out))
+        {
+        }
+
+        ~FmtProofSink()
+        {
+            write_out();
+        }
+
+        auto put(std::string_view s) -> void
+        {
+            _buffer.append(s.data(), s.data() + s.size());
+        }
+
+        auto put_number(long n) -> void
+        {
+            fmt::format_to(std::back_inserter(_buffer), "{}", n);
+        }
+
+        auto end_line() -> void
+        {
+            _buffer.push_back('\n');
+            if (_buffer.size() >= write_threshold)
+                write_out();
+        }
+
+        auto text() -> std::ostream &
+        {
+            write_out();
+            return *_out;
+        }
+};
+
+/**
+ * Formats numbers using std::to_chars into a fixed buffer, which is handed
+ * to the underlying stream (usually a FileDescriptorStream) when full.
+ */
+class RawProofSink : public TextProofSink<RawProofSink>
+{
+    private:
+        static constexpr std::size_t buffer_size = 1 << 16;
+
+        std::unique_ptr<std::ostream> _out;
+        std::unique_ptr<char[]> _buffer;
+        std::size_t _used = 0;
+
+        auto write_out() -> void
+        {
+            _out->write(_buffer.get(), _used);
+            _used = 0;
+        }
+
+    public:
+        explicit RawProofSink(std::unique_ptr<std::ostream> && out) :
+            _out(std::move(out)),
+            _buffer(new char[buffer_size])
+        {
+        }
+
+        ~RawProofSink()
+        {
+            write_out();
+        }
+
+        auto put(std::string_view s) -> void
+        {
+            if (_used + s.size() > buffer_size) {
+                write_out();
+                if (s.size() > buffer_size) {
+                    _out->write(s.data(), s.size());
+                    return;
+                }
+            }
+
+            std::memcpy(_buffer.get() + _used, s.data(), s.size());
+            _used += s.size();
+        }
+
+        auto put_number(long n) -> void
+        {
+            // 20 characters is enough for any long, including the sign
+            if (_used + 20 > buffer_size)
+                write_out();
+            _used = std::to_chars(_buffer.get() + _used, _buffer.get() + buffer_size, n).ptr - _buffer.get();
+        }
+
+        auto end_line() -> void
+        {
+            if (_used == buffer_size)
+                write_out();
+            _buffer[_used++] = '\n';
+        }
+
+        auto text() -> std::ostream &
+        {
+            write_out();
+            return *_out;
+        }
+};
+
+/**
+ * Writes the compact binary format, see proof_binary.hh.
+ */
+class BinaryProofSink
+{
+    private:
+        BinaryProofWriter _writer;
+
+    public:
+        explicit BinaryProofSink(std::unique_ptr<std::ostream> && out) :
+            _writer(std::move(out))
+        {
+        }
+
+        auto level(int l) -> void
+        {
+            _writer.level(l);
+        }
+
+        auto forget_level(int l) -> void
+        {
+            _writer.forget_level(l);
+        }
+
+        auto negated_rup(const std::vector<int> & literals, const LiteralTokens & tokens) -> void
+        {
+            _writer.negated_rup(literals, [&] (int v) { return tokens.name(v); });
+        }
+
+        auto objective(const std::vector<std::pair<int, bool> > & literals, const LiteralTokens & tokens) -> void
+        {
+            _writer.objective(literals, [&] (int v) { return tokens.name(v); });
+        }
+
+        auto solution(const std::vector<int> & literals, const LiteralTokens & tokens) -> void
+        {
+            _writer.solution(literals, [&] (int v) { return tokens.name(v); });
+        }
+
+        template <typename NonEdgeConstraint_>
+        auto colour_class(unsigned size, const NonEdgeConstraint_ & non_edge_constraint) -> void
+        {
+            _writer.colour_class(size, non_edge_constraint);
+        }
+
+        auto sum(long first, const std::vector<long> & rest) -> void
+        {
+            _writer.sum(first, rest);
+        }
+
+        auto bound_comment(const std::vector<std::vector<int> > & ccs) -> void
+        {
+            _writer.bound_comment(ccs);
+        }
+
+        auto text() -> std::ostream &
+        {
+            return _writer;
+        }
+};
+
+#endif
@@ -3,16 +3,21 @@
 #ifndef GLASGOW_SUBGRAPH_SOLVER_GUARD_SRC_SVO_BITSET_HH
 #define GLASGOW_SUBGRAPH_SOLVER_GUARD_SRC_SVO_BITSET_HH 1
 
+#include "bitset_kernels.hh"
+
 #include <algorithm>
 #include <array>
+#include <cstdint>
 #include <cstring>
 #include <limits>
 
 class SVOBitset
 {
-    private:
+    public:
         using BitWord = unsigned long long;
         static const constexpr int bits_per_word = sizeof(BitWord) * 8;
+
+    private:
         static const constexpr int svo_size = 16;
 
         union
@@ -23,11 +28,39 @@ class SVOBitset
 
         unsigned n_words;
 
+        // how many words long_data has room for, when we're long
+        unsigned n_capacity = 0;
+
         constexpr auto _is_long() const -> bool
         {
             return n_words > svo_size;
         }
 
+        auto _release() -> void
+        {
+            if (_is_long())
+                delete[] _data.long_data;
+        }
+
+        // become the same size as other, keeping our heap storage if it's
+        // big enough. the contents are left unspecified.
+        auto _resize_like(const SVOBitset & other) -> void
+        {
+            if (other._is_long()) {
+                if (! _is_long() || n_capacity < other.n_words) {
+                    _release();
+                    _data.long_data = new BitWord[other.n_words];
+                    n_capacity = other.n_words;
+                }
+            }
+            else {
+                _release();
+                n_capacity = 0;
+            }
+
+            n_words = other.n_words;
+        }
+
     public:
         static constexpr const unsigned npos = std::numeric_limits<unsigned>::max();
 
@@ -40,21 +73,22 @@ class SVOBitset
 
         SVOBitset(const SVOBitset & other)
         {
-            if (other._is_long()) {
-                n_words = other.n_words;
-                _data.long_data = new BitWord[n_words];
-                std::copy(other._data.long_data, other._data.long_data + other.n_words, _data.long_data);
-            }
-            else {
-                n_words = other.n_words;
-                std::copy(&other._data.short_data[0], &other._data.short_data[svo_size], &_data.short_data[0]);
-            }
+            n_words = 0;
+            *this = other;
+        }
+
+        SVOBitset(SVOBitset && other) noexcept :
+            _data(other._data),
+            n_words(other.n_words),
+            n_capacity(other.n_capacity)
+        {
+            other.n_words = 0;
+            other.n_capacity = 0;
         }
 
         ~SVOBitset()
         {
-            if (_is_long())
-                delete[] _data.long_data;
+            _release();
         }
 
         auto operator= (const SVOBitset & other) -> SVOBitset &
@@ -62,28 +96,29 @@ class SVOBitset
             if (&other == this)
                 return *this;
 
-            if (other._is_long()) {
-                if (! _is_long()) {
-                    n_words = other.n_words;
-                    _data.long_data = new BitWord[n_words];
-                }
-                else if (n_words != other.n_words) {
-                    delete[] _data.long_data;
-                    _data.long_data = new BitWord[n_words];
-                }
-
-                std::copy(other._data.long_data, other._data.long_data + other.n_words, _data.long_data);
-            }
-            else {
-                if (_is_long())
-                    delete[] _data.long_data;
-                n_words = other.n_words;
+            _resize_like(other);
+            if (_is_long())
+                std::copy(other._data.long_data, other._data.long_data + n_words, _data.long_data);
+            else
                 std::copy(&other._data.short_data[0], &other._data.short_data[svo_size], &_data.short_data[0]);
-            }
 
             return *this;
         }
 
+        auto operator= (SVOBitset && other) noexcept -> SVOBitset &
+        {
+            if (&other == this)
+                return *this;
+
+            _release();
+            _data = other._data;
+            n_words = other.n_words;
+            n_capacity = other.n_capacity;
+            other.n_words = 0;
+            other.n_capacity = 0;
+
+            return *this;
+        }
 
         auto any() const -> bool
         {
@@ -94,13 +129,8 @@ class SVOBitset
 
                 return false;
             }
-            else {
-                for (unsigned i = 0, i_end = n_words ; i < i_end ; ++i)
-                    if (0 != _data.long_data[i])
-                        return true;
-
-                return false;
-            }
+            else
+                return bitset_kernels.any(_data.long_data, n_words);
         }
 
         auto find_first() const -> unsigned
@@ -113,14 +143,8 @@ class SVOBitset
                 }
                 return npos;
             }
-            else {
-                for (unsigned i = 0, i_end = n_words ; i < i_end ; ++i) {
-                    int x = __builtin_ffsll(_data.long_data[i]);
-                    if (0 != x)
-                        return i * bits_per_word + x - 1;
-                }
-                return npos;
-            }
+            else
+                return bitset_kernels.find_first(_data.long_data, n_words);
         }
 
         auto reset(int a) -> void
@@ -152,13 +176,11 @@ class SVOBitset
         auto operator&= (const SVOBitset & other) -> SVOBitset &
         {
             if (! _is_long()) {
-                for (unsigned i = 0 ; i < svo_size ; ++i)
-                    _data.short_data[i] &= other._data.short_data[i];
-            }
-            else {
                 for (unsigned i = 0 ; i < n_words ; ++i)
-                    _data.long_data[i] &= other._data.long_data[i];
+                    _data.short_data[i] &= other._data.short_data[i];
             }
+            else
+                bitset_kernels.and_with(_data.long_data, other._data.long_data, n_words);
 
             return *this;
         }
@@ -166,13 +188,11 @@ class SVOBitset
         auto operator|= (const SVOBitset & other) -> SVOBitset &
         {
             if (! _is_long()) {
-                for (unsigned i = 0 ; i < svo_size ; ++i)
-                    _data.short_data[i] |= other._data.short_data[i];
-            }
-            else {
                 for (unsigned i = 0 ; i < n_words ; ++i)
-                    _data.long_data[i] |= other._data.long_data[i];
+                    _data.short_data[i] |= other._data.short_data[i];
             }
+            else
+                bitset_kernels.or_with(_data.long_data, other._data.long_data, n_words);
 
             return *this;
         }
@@ -180,23 +200,84 @@ class SVOBitset
         auto intersect_with_complement(const SVOBitset & other) -> void
         {
             if (! _is_long()) {
-                for (unsigned i = 0 ; i < svo_size ; ++i)
+                for (unsigned i = 0 ; i < n_words ; ++i)
                     _data.short_data[i] &= ~other._data.short_data[i];
             }
-            else {
+            else
+                bitset_kernels.and_not_with(_data.long_data, other._data.long_data, n_words);
+        }
+
+        /// Intersect with other, and then return whether anything is left,
+        /// in one pass
+        auto intersect_with_and_any(const SVOBitset & other) -> bool
+        {
+            if (! _is_long()) {
+                BitWord seen = 0;
                 for (unsigned i = 0 ; i < n_words ; ++i)
-                    _data.long_data[i] &= ~other._data.long_data[i];
+                    seen |= (_data.short_data[i] &= other._data.short_data[i]);
+                return 0 != seen;
             }
+            else
+                return bitset_kernels.and_any(_data.long_data, other._data.long_data, n_words);
         }
 
-        auto count() const -> unsigned
+        /// How many bits are in both this and other?
+        auto count_intersection(const SVOBitset & other) const -> unsigned
         {
-            unsigned result = 0;
-            const BitWord * b = (_is_long() ? _data.long_data : _data.short_data);
-            for (unsigned i = 0, i_end = n_words ; i < i_end ; ++i)
-                result += __builtin_popcountll(b[i]);
+            if (! _is_long()) {
+                unsigned result = 0;
+                for (unsigned i = 0 ; i < n_words ; ++i)
+                    result += __builtin_popcountll(_data.short_data[i] & other._data.short_data[i]);
+                return result;
+            }
+            else
+                return bitset_kernels.and_count(_data.long_data, other._data.long_data, n_words);
+        }
+
+        /// Intersect with the complement of other, and then return the first
+        /// bit left, in one pass
+        auto intersect_with_complement_and_find_first(const SVOBitset & other) -> unsigned
+        {
+            if (! _is_long()) {
+                unsigned result = npos;
+                for (unsigned i = 0 ; i < n_words ; ++i)
+                    if (0 != (_data.short_data[i] &= ~other._data.short_data[i]) && npos == result)
+                        result = i * bits_per_word + __builtin_ctzll(_data.short_data[i]);
+                return result;
+            }
+            else
+                return bitset_kernels.and_not_find_first(_data.long_data, other._data.long_data, n_words);
+        }
+
+        auto number_of_words() const -> unsigned
+        {
+            return n_words;
+        }
 
-            return result;
+        /// The underlying words, for things that need to work a word at a time
+        auto words() const -> const BitWord *
+        {
+            return _is_long() ? _data.long_data : _data.short_data;
+        }
+
+        /// Copy in n words, which must be no more than we have, and clear the rest
+        auto assign_words(const std::uint64_t * w, unsigned n) -> void
+        {
+            BitWord * b = (_is_long() ? _data.long_data : _data.short_data);
+            std::copy(w, w + n, b);
+            std::fill(b + n, b + n_words, 0);
+        }
+
+        auto count() const -> unsigned
+        {
+            if (! _is_long()) {
+                unsigned result = 0;
+                for (unsigned i = 0 ; i < n_words ; ++i)
+                    result += __builtin_popcountll(_data.short_data[i]);
+                return result;
+            }
+            else
+                return bitset_kernels.count(_data.long_data, n_words);
         }
 };
 
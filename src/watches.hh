@@ -4,7 +4,7 @@
 #define GLASGOW_SUBGRAPH_SOLVER_GUARD_WATCHES_HH 1
 
 #include <algorithm>
-#include <list>
+#include <cstdint>
 #include <utility>
 #include <vector>
 
@@ -18,71 +18,120 @@ struct Nogood
     std::vector<Decision_> literals;
 };
 
+// Every nogood, stored flat: the literals of nogood n are
+// literals[starts[n]] to literals[starts[n + 1]], so nogoods sit next to
+// each other in memory, rather than each having its own vector. We also
+// count how often each nogood has propagated, to decide which to delete.
+template <typename Decision_>
+struct NogoodArena
+{
+    std::vector<Decision_> literals;
+    std::vector<std::uint32_t> starts{ 0 };
+    std::vector<std::uint32_t> activity;
+
+    auto size() const -> std::uint32_t
+    {
+        return starts.size() - 1;
+    }
+
+    template <typename Iter_>
+    auto push_back(Iter_ first, Iter_ last) -> std::uint32_t
+    {
+        literals.insert(literals.end(), first, last);
+        starts.push_back(literals.size());
+        activity.push_back(0);
+        return size() - 1;
+    }
+
+    auto begin(std::uint32_t n) -> Decision_ *
+    {
+        return literals.data() + starts[n];
+    }
+
+    auto end(std::uint32_t n) -> Decision_ *
+    {
+        return literals.data() + starts[n + 1];
+    }
+
+    auto length(std::uint32_t n) const -> std::uint32_t
+    {
+        return starts[n + 1] - starts[n];
+    }
+};
+
 // Two watched literals for our nogoods store.
 template <typename Decision_, template <typename> typename WatchTable_>
 struct Watches
 {
-    // nogoods stored here
-    using NogoodStore = std::list<Nogood<Decision_> >;
+    // nogoods stored here, and referred to by their index
+    using NogoodStore = NogoodArena<Decision_>;
 
     NogoodStore nogoods;
 
-    // For each watched literal, we have a list of watched things, each of
-    // which is an iterator into the global watch list (so we can reorder
-    // the literal to keep the watches as the first two elements).
-    using WatchList = std::list<typename NogoodStore::iterator>;
+    // For each watched literal, we have a list of watched nogoods. Their
+    // order doesn't matter, so we remove things by swapping in the last.
+    using WatchList = std::vector<std::uint32_t>;
 
     WatchTable_<WatchList> table;
 
     // Rather than backjumping, we update the watch list on restarts (to make
     // parallel shenanigans easier).
-    using NeedToWatch = std::list<typename NogoodStore::iterator>;
+    using NeedToWatch = std::vector<std::uint32_t>;
 
     NeedToWatch need_to_watch, gathered_need_to_watch;
 
+    // statistics
+    unsigned long long propagations = 0, deleted = 0;
+
     template <typename CanWatchFunction_, typename AssignmentIsNogoodFunction_>
     auto propagate(
             Decision_ current_assignment,
             const CanWatchFunction_ & can_watch,
             const AssignmentIsNogoodFunction_ & assignment_is_nogood) -> void
     {
+        // nothing we do here can make a nogood watch current_assignment, so
+        // watches_to_update doesn't move while we change other lists
         auto & watches_to_update = table[current_assignment];
-        for (auto watch_to_update = watches_to_update.begin() ; watch_to_update != watches_to_update.end() ; ) {
-            auto & nogood = **watch_to_update;
+        for (std::size_t w = 0 ; w < watches_to_update.size() ; ) {
+            auto n = watches_to_update[w];
+            Decision_ * literals = nogoods.begin(n);
+            Decision_ * literals_end = nogoods.end(n);
 
             // make the first watch the thing we just triggered
-            if (nogood.literals[0] != current_assignment)
-                std::swap(nogood.literals[0], nogood.literals[1]);
+            if (literals[0] != current_assignment)
+                std::swap(literals[0], literals[1]);
 
             // can we find something else to watch?
             bool success = false;
-            for (auto new_literal = next(nogood.literals.begin(), 2) ; new_literal != nogood.literals.end() ; ++new_literal) {
+            for (Decision_ * new_literal = literals + 2 ; new_literal != literals_end ; ++new_literal) {
                 if (can_watch(*new_literal)) {
                     // we can watch new_literal instead of current_assignment in this nogood
                     success = true;
 
                     // move the new watch to be the first item in the nogood
-                    std::swap(nogood.literals[0], *new_literal);
+                    std::swap(literals[0], *new_literal);
 
                     // start watching it
-                    table[nogood.literals[0]].push_back(*watch_to_update);
+                    table[literals[0]].push_back(n);
 
-                    // remove the current watch, and update the loop iterator
-                    watches_to_update.erase(watch_to_update++);
+                    // remove the current watch, leaving w on whatever we swapped in
+                    watches_to_update[w] = watches_to_update.back();
+                    watches_to_update.pop_back();
 
                     break;
                 }
             }
 
-            // found something new? nothing to propagate (and we've already updated our loop iterator in the erase)
+            // found something new? nothing to propagate (and we've already got a new w)
             if (success)
                 continue;
 
             // no new watch, this nogood will now propagate.
-            assignment_is_nogood(nogood.literals[1]);
+            assignment_is_nogood(literals[1]);
+            ++nogoods.activity[n];
+            ++propagations;
 
-            // step the loop variable, only if we've not already erased it
-            ++watch_to_update;
+            ++w;
         }
     }
 
@@ -90,8 +139,7 @@ struct Watches
     // called.
     auto post_nogood(Nogood<Decision_> && nogood)
     {
-        nogoods.emplace_back(std::move(nogood));
-        need_to_watch.emplace_back(std::prev(nogoods.end()));
+        need_to_watch.push_back(nogoods.push_back(nogood.literals.begin(), nogood.literals.end()));
     }
 
     template <typename AssignmentIsNogoodFunction_>
@@ -111,16 +159,19 @@ struct Watches
 
     template <typename AssignmentIsNogoodFunction_>
     auto apply_one_new_nogood(
-            const typename NogoodStore::iterator & n,
+            std::uint32_t n,
             const AssignmentIsNogoodFunction_ & assignment_is_nogood) -> bool
     {
-        if (n->literals.empty())
+        auto literals = nogoods.begin(n);
+        auto length = nogoods.length(n);
+
+        if (0 == length)
             return true;
-        else if (1 == n->literals.size())
-            assignment_is_nogood(n->literals[0]);
+        else if (1 == length)
+            assignment_is_nogood(literals[0]);
         else {
-            table[n->literals[0]].push_back(n);
-            table[n->literals[1]].push_back(n);
+            table[literals[0]].push_back(n);
+            table[literals[1]].push_back(n);
         }
 
         return false;
@@ -129,10 +180,8 @@ struct Watches
     auto gather_nogoods_from(
             Watches & other)
     {
-        for (auto & n : other.need_to_watch) {
-            nogoods.emplace_back(*n);
-            gathered_need_to_watch.emplace_back(std::prev(nogoods.end()));
-        }
+        for (auto & n : other.need_to_watch)
+            gathered_need_to_watch.push_back(nogoods.push_back(other.nogoods.begin(n), other.nogoods.end(n)));
     }
 
     auto clear_new_nogoods() -> void
@@ -140,6 +189,59 @@ struct Watches
         need_to_watch.clear();
         gathered_need_to_watch.clear();
     }
+
+    // delete the worst fraction of the nogoods numbered below keep_from,
+    // judged first by how often they've propagated since the last time we
+    // did this, and then by size. nogoods of two or fewer literals are
+    // cheap, and are always kept. must only be called when there are no
+    // new nogoods waiting to be applied, and renumbers the nogoods.
+    auto reduce_nogoods(double fraction, std::uint32_t keep_from) -> void
+    {
+        std::vector<std::uint32_t> candidates;
+        for (std::uint32_t n = 0 ; n < keep_from && n < nogoods.size() ; ++n)
+            if (nogoods.length(n) > 2)
+                candidates.push_back(n);
+
+        std::size_t number_to_delete = candidates.size() * fraction;
+        if (0 == number_to_delete)
+            return;
+
+        std::sort(candidates.begin(), candidates.end(), [&] (std::uint32_t a, std::uint32_t b) {
+                if (nogoods.activity[a] != nogoods.activity[b])
+                    return nogoods.activity[a] < nogoods.activity[b];
+                else if (nogoods.length(a) != nogoods.length(b))
+                    return nogoods.length(a) > nogoods.length(b);
+                else
+                    return a < b;
+                });
+
+        std::vector<bool> dead(nogoods.size(), false);
+        for (std::size_t i = 0 ; i < number_to_delete ; ++i)
+            dead[candidates[i]] = true;
+        deleted += number_to_delete;
+
+        // stop watching everything, then rebuild with what's left, halving
+        // activities so that what happens next counts for more
+        NogoodStore kept;
+        for (std::uint32_t n = 0 ; n < nogoods.size() ; ++n) {
+            if (nogoods.length(n) >= 2) {
+                table[nogoods.begin(n)[0]].clear();
+                table[nogoods.begin(n)[1]].clear();
+            }
+
+            if (! dead[n]) {
+                auto k = kept.push_back(nogoods.begin(n), nogoods.end(n));
+                kept.activity[k] = nogoods.activity[n] / 2;
+            }
+        }
+
+        nogoods = std::move(kept);
+        for (std::uint32_t n = 0 ; n < nogoods.size() ; ++n)
+            if (nogoods.length(n) >= 2) {
+                table[nogoods.begin(n)[0]].push_back(n);
+                table[nogoods.begin(n)[1]].push_back(n);
+            }
+    }
 };
 
 #endif
@@ -0,0 +1,38 @@
+# Check that writing the proof log from a separate thread gives exactly the
+# same files as writing it directly, for each way of writing the log.
+
+import os
+import sys
+import tempfile
+
+from graphs import random_graph, solve, write_dimacs
+
+graphs = [(60, 0.5, 1), (120, 0.7, 2), (90, 0.9, 3)]
+
+options = [["--proof-sink", sink] for sink in ["iostream-endl", "iostream", "fmt", "raw"]] + \
+    [["--proof-format", "binary"], ["--proof-compression", "bz2"], ["--proof-compression", "zstd"]]
+
+def main(solver):
+    failures = 0
+    with tempfile.TemporaryDirectory() as directory:
+        path = os.path.join(directory, "g.clq")
+        direct, threaded = os.path.join(directory, "direct"), os.path.join(directory, "threaded")
+        for n, p, seed in graphs:
+            write_dimacs(path, n, random_graph(n, p, seed))
+            for extra in options:
+                solve(solver, [path, "--prove", direct] + extra)
+                solve(solver, [path, "--prove", threaded, "--async-proof"] + extra)
+                for name in sorted(os.listdir(directory)):
+                    if name.startswith("direct"):
+                        with open(os.path.join(directory, name), "rb") as d, \
+                                open(os.path.join(directory, "threaded" + name[len("direct"):]), "rb") as t:
+                            if d.read() != t.read():
+                                print(f"G({n}, {p}) seed {seed} {' '.join(extra)}: {name} differs")
+                                failures += 1
+                        os.remove(os.path.join(directory, name))
+                        os.remove(os.path.join(directory, "threaded" + name[len("direct"):]))
+
+    return 1 if failures else 0
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1]))
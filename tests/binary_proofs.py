@@ -0,0 +1,33 @@
+# Check that a binary proof log, expanded by proof_expand, is exactly the text
+# proof log that --prove writes on its own.
+
+import os
+import subprocess
+import sys
+import tempfile
+
+from graphs import random_graph, solve, write_dimacs
+
+graphs = [(60, 0.5, 1), (120, 0.7, 2), (90, 0.9, 3)]
+
+def main(solver, proof_expand):
+    failures = 0
+    with tempfile.TemporaryDirectory() as directory:
+        path = os.path.join(directory, "g.clq")
+        text, binary = os.path.join(directory, "text"), os.path.join(directory, "binary")
+        for n, p, seed in graphs:
+            write_dimacs(path, n, random_graph(n, p, seed))
+            for extra in [[], ["--tighten-bounds"], ["--proof-skip-singletons", "--proof-no-comments"]]:
+                solve(solver, [path, "--prove", text] + extra)
+                solve(solver, [path, "--prove", binary, "--proof-format", "binary"] + extra)
+                subprocess.run([proof_expand, binary + ".veripb.bin"], check=True)
+                for suffix in [".opb", ".veripb"]:
+                    with open(text + suffix, "rb") as t, open(binary + suffix, "rb") as b:
+                        if t.read() != b.read():
+                            print(f"G({n}, {p}) seed {seed} {' '.join(extra)}: {suffix} differs")
+                            failures += 1
+
+    return 1 if failures else 0
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1], sys.argv[2]))
@@ -0,0 +1,33 @@
+# Check that every colour ordering finds the same omega as the default on
+# sparse random graphs, and that the clique it reports really is a clique.
+
+import os
+import sys
+import tempfile
+
+from graphs import is_clique, random_graph, run, write_dimacs
+
+orderings = ["colour", "singletons-first", "sorted"]
+
+def main(solver):
+    failures = 0
+    with tempfile.TemporaryDirectory() as directory:
+        for n, p, seed in [(500, 0.008, s) for s in range(1, 41)] + [(5000, 0.002, s) for s in range(1, 3)]:
+            edges = random_graph(n, p, seed)
+            path = os.path.join(directory, "g.clq")
+            write_dimacs(path, n, edges)
+
+            expected, _ = run(solver, path, [])
+            for ordering in orderings:
+                for extra in [[], ["--tighten-bounds"]]:
+                    omega, clique = run(solver, path, ["--colour-ordering", ordering] + extra)
+                    really = is_clique(edges, clique)
+                    if omega != expected or len(clique) != omega or not really:
+                        print(f"G({n}, {p}) seed {seed} {ordering} {' '.join(extra)}: omega {omega}, expected {expected}, "
+                                f"clique {clique}{'' if really else ' is not a clique'}")
+                        failures += 1
+
+    return 1 if failures else 0
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1]))
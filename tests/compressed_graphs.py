@@ -0,0 +1,55 @@
+# Check that graph files compressed with gzip, bzip2 or zstd, whatever they
+# are called, and piped in as well as read from a file, give the same omega
+# and clique as the uncompressed file, and that truncated ones are rejected.
+
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+from graphs import parse_output, random_graph, solve, write_csv, write_dimacs, write_lad
+
+graphs = [(60, 0.5, 1), (150, 0.7, 2), (2000, 0.01, 3)]
+
+compressors = ["gzip", "bzip2", "zstd"]
+
+def main(solver):
+    failures = 0
+    with tempfile.TemporaryDirectory() as directory:
+        plain, packed = os.path.join(directory, "plain"), os.path.join(directory, "packed")
+        for n, p, seed in graphs:
+            edges = random_graph(n, p, seed)
+            for write in [lambda path: write_dimacs(path, n, edges), lambda path: write_lad(path, n, edges), lambda path: write_csv(path, edges)]:
+                write(plain)
+                with open(plain, "rb") as f:
+                    contents = f.read()
+                expected = solve(solver, [plain])
+
+                for compressor in compressors:
+                    if not shutil.which(compressor):
+                        print(f"skipping {compressor}, which isn't installed")
+                        continue
+
+                    data = subprocess.run([compressor, "-c"], input=contents, check=True, capture_output=True).stdout
+                    with open(packed, "wb") as f:
+                        f.write(data)
+
+                    piped = subprocess.run([solver, "/dev/stdin"], input=data, check=True, capture_output=True).stdout.decode()
+                    for fields in [solve(solver, [packed]), parse_output(piped)]:
+                        if (fields["omega"], fields["clique"]) != (expected["omega"], expected["clique"]):
+                            print(f"G({n}, {p}) seed {seed} {contents[:10]!r} {compressor}: omega {fields['omega']} clique {fields['clique']}, "
+                                    f"expected {expected['omega']} clique {expected['clique']}")
+                            failures += 1
+
+                    with open(packed, "wb") as f:
+                        f.write(data[:len(data) // 2])
+                    result = subprocess.run([solver, packed], capture_output=True, text=True)
+                    if result.returncode <= 0 or not result.stderr.startswith("Error:"):
+                        print(f"G({n}, {p}) seed {seed} {contents[:10]!r} {compressor} truncated: exit status {result.returncode}")
+                        failures += 1
+
+    return 1 if failures else 0
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1]))
@@ -0,0 +1,70 @@
+# Check that compressed proofs decompress, using the usual command line tools,
+# to exactly the uncompressed proof, and that a compression method or level
+# which can't be used is rejected without leaving any files behind.
+
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+from graphs import random_graph, rejected, solve, write_dimacs
+
+graphs = [(60, 0.5, 1), (120, 0.7, 2), (90, 0.9, 3)]
+
+methods = [("bz2", ".bz2", "bzip2", "1"), ("zstd", ".zst", "zstd", "9"), ("lz4", ".lz4", "lz4", "9")]
+
+bad_levels = [["--proof-compression", "bz2", "--proof-compression-level", "10"],
+    ["--proof-compression", "zstd", "--proof-compression-level", "23"], ["--proof-compression-level", "3"]]
+
+def main(solver):
+    failures = 0
+    with tempfile.TemporaryDirectory() as directory:
+        path = os.path.join(directory, "g.clq")
+        plain, compressed = os.path.join(directory, "plain"), os.path.join(directory, "compressed")
+
+        def leftovers():
+            return sorted(name for name in os.listdir(directory) if name != "g.clq")
+
+        def remove_leftovers():
+            for name in leftovers():
+                os.remove(os.path.join(directory, name))
+
+        n, p, seed = graphs[0]
+        write_dimacs(path, n, random_graph(n, p, seed))
+        unavailable = []
+        for method, _, _, _ in methods:
+            if rejected(solver, [path, "--prove", compressed, "--proof-compression", method]):
+                unavailable.append(["--proof-compression", method])
+            remove_leftovers()
+
+        for extra in bad_levels + unavailable:
+            if not rejected(solver, [path, "--prove", compressed] + extra):
+                print(f"{' '.join(extra)} was not rejected")
+                failures += 1
+            elif leftovers():
+                print(f"{' '.join(extra)} left {' '.join(leftovers())} behind")
+                failures += 1
+            remove_leftovers()
+
+        for method, suffix, tool, level in methods:
+            if ["--proof-compression", method] in unavailable or not shutil.which(tool):
+                print(f"skipping {method}, which isn't available")
+                continue
+
+            for n, p, seed in graphs:
+                write_dimacs(path, n, random_graph(n, p, seed))
+                solve(solver, [path, "--prove", plain])
+                for extra in [[], ["--proof-compression-level", level, "--proof-compression-threads", "3"]]:
+                    solve(solver, [path, "--prove", compressed, "--proof-compression", method] + extra)
+                    for kind in [".opb", ".veripb"]:
+                        expanded = subprocess.run([tool, "-dc", compressed + kind + suffix], check=True, capture_output=True).stdout
+                        with open(plain + kind, "rb") as f:
+                            if f.read() != expanded:
+                                print(f"G({n}, {p}) seed {seed} {method} {' '.join(extra)}: {kind} differs")
+                                failures += 1
+
+    return 1 if failures else 0
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1]))
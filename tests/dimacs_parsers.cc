@@ -0,0 +1,228 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+// Compares read_dimacs with the regex based parser that it replaced, which is
+// kept here as a reference. With no arguments, checks that the two give the
+// same graph, or the same error, on a set of valid and malformed inputs. With
+// --bench and some DIMACS files, times how long each takes to load them.
+
+#include "formats/dimacs.hh"
+#include "formats/graph_file_error.hh"
+#include "formats/input_graph.hh"
+#include "formats/mapped_file.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <regex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::exception;
+using std::function;
+using std::getline;
+using std::ifstream;
+using std::min;
+using std::ofstream;
+using std::pair;
+using std::regex;
+using std::smatch;
+using std::stoi;
+using std::string;
+using std::to_string;
+using std::vector;
+
+using std::chrono::duration;
+using std::chrono::steady_clock;
+
+namespace
+{
+    // the parser from before read_dimacs scanned a memory mapping
+    auto read_dimacs_regex(ifstream && infile, const string & filename) -> InputGraph
+    {
+        InputGraph result{ 0, false, false };
+
+        string line;
+        while (getline(infile, line)) {
+            if (line.empty())
+                continue;
+
+            /* Lines are comments, a problem description (contains the number of
+             * vertices), or an edge. */
+            static const regex
+                comment{ R"(c(\s.*)?)" },
+                problem{ R"(p\s+(edge|col)\s+(\d+)\s+(\d+)?\s*)" },
+                edge{ R"(e\s+(\d+)\s+(\d+)\s*)" };
+
+            smatch match;
+            if (regex_match(line, match, comment)) {
+                /* Comment, ignore */
+            }
+            else if (regex_match(line, match, problem)) {
+                /* Problem. Specifies the size of the graph. Must happen exactly
+                 * once. */
+                if (0 != result.size())
+                    throw GraphFileError{ filename, "multiple 'p' lines encountered", true };
+                result.resize(stoi(match.str(2)));
+            }
+            else if (regex_match(line, match, edge)) {
+                /* An edge. DIMACS files are 1-indexed. We assume we've already had
+                 * a problem line (if not our size will be 0, so we'll throw). */
+                int a{ stoi(match.str(1)) }, b{ stoi(match.str(2)) };
+                if (0 == a || 0 == b || a > result.size() || b > result.size())
+                    throw GraphFileError{ filename, "line '" + line + "' edge index out of bounds", true };
+                result.add_edge(a - 1, b - 1);
+            }
+            else
+                throw GraphFileError{ filename, "cannot parse line '" + line + "'", true };
+        }
+
+        if (! infile.eof())
+            throw GraphFileError{ filename, "error reading file", true };
+
+        for (int v = 0 ; v < result.size() ; ++v)
+            result.set_vertex_name(v, to_string(v + 1));
+
+        return result;
+    }
+
+    auto read_dimacs_regex(const string & filename) -> InputGraph
+    {
+        return read_dimacs_regex(ifstream{ filename }, filename);
+    }
+
+    auto read_dimacs_mapped(const string & filename) -> InputGraph
+    {
+        return read_dimacs(MappedFile{ filename }, filename);
+    }
+
+    // what a parser made of a file: the error it threw, or the graph
+    auto outcome(const function<InputGraph ()> & parse) -> string
+    {
+        try {
+            auto graph = parse();
+            string result = "graph with " + to_string(graph.size()) + " vertices:";
+            for (int v = 0 ; v < graph.size() ; ++v)
+                result += " " + graph.vertex_name(v);
+            graph.for_each_edge([&] (int a, int b, auto) { result += " " + to_string(a) + "-" + to_string(b); });
+            return result;
+        }
+        catch (const GraphFileError & e) {
+            return "GraphFileError: " + string{ e.what() };
+        }
+        catch (const exception & e) {
+            return "exception: " + string{ e.what() };
+        }
+    }
+
+    const vector<pair<string, string> > inputs = {
+        { "empty", "" },
+        { "simple", "p edge 3 2\ne 1 2\ne 2 3\n" },
+        { "comments", "c a comment\nc\np edge 3 1\nc another\ne 3 1\n" },
+        { "col", "p col 4 2\ne 1 4\ne 2 3\n" },
+        { "no edge count", "p edge 4 \ne 1 4\n" },
+        { "wrong edge count", "p edge 3 17\ne 1 2\n" },
+        { "huge edge count", "p edge 3 99999999999\ne 1 2\n" },
+        { "no final newline", "p edge 3 1\ne 1 2" },
+        { "blank lines", "\n\np edge 3 1\n\ne 1 2\n\n" },
+        { "tabs and spaces", "p\tedge  3\t1 \ne\t1  2\t \n" },
+        { "crlf", "p edge 3 1\r\ne 1 2\r\n" },
+        { "crlf comment", "c a comment\r\np edge 3 1\r\ne 1 2\r\n" },
+        { "duplicate edges", "p edge 3 3\ne 1 2\ne 2 1\ne 1 2\n" },
+        { "loop", "p edge 3 1\ne 2 2\n" },
+        { "leading zeros", "p edge 003 1\ne 01 002\n" },
+        { "edge before problem", "e 1 2\np edge 3 1\n" },
+        { "two problems", "p edge 3 1\np edge 3 1\ne 1 2\n" },
+        { "vertex zero", "p edge 3 1\ne 0 2\n" },
+        { "vertex too big", "p edge 3 1\ne 1 4\n" },
+        { "huge vertex", "p edge 3 1\ne 1 99999999999\n" },
+        { "huge size", "p edge 99999999999 1\ne 1 2\n" },
+        { "negative vertex", "p edge 3 1\ne -1 2\n" },
+        { "one endpoint", "p edge 3 1\ne 1\n" },
+        { "three endpoints", "p edge 3 1\ne 1 2 3\n" },
+        { "trailing junk", "p edge 3 1\ne 1 2x\n" },
+        { "no size", "p edge\n" },
+        { "no edge count or space", "p edge 4\n" },
+        { "unknown problem", "p clique 3 1\n" },
+        { "comment without space", "ca comment\np edge 3 0\n" },
+        { "garbage", "p edge 3 1\nhello\n" },
+        { "leading space", "p edge 3 1\n e 1 2\n" }
+    };
+
+    auto check() -> int
+    {
+        char directory_template[] = "/tmp/dimacs_parsers.XXXXXX";
+        if (! mkdtemp(directory_template)) {
+            cerr << "Couldn't create a temporary directory" << endl;
+            return EXIT_FAILURE;
+        }
+        string filename = string{ directory_template } + "/g.clq";
+
+        int failures = 0;
+        for (auto & [ name, contents ] : inputs) {
+            ofstream{ filename, std::ios::binary } << contents;
+            auto expected = outcome([&] { return read_dimacs_regex(filename); });
+            auto actual = outcome([&] { return read_dimacs_mapped(filename); });
+            if (expected != actual) {
+                cout << name << ": expected '" << expected << "', got '" << actual << "'" << endl;
+                ++failures;
+            }
+        }
+
+        unlink(filename.c_str());
+        rmdir(directory_template);
+
+        return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    auto time_ms(const function<InputGraph ()> & parse) -> double
+    {
+        double best = 0.0;
+        for (int i = 0 ; i < 3 ; ++i) {
+            auto start = steady_clock::now();
+            auto graph = parse();
+            graph.compact();
+            double taken = duration<double, std::milli>(steady_clock::now() - start).count();
+            best = 0 == i ? taken : min(best, taken);
+        }
+        return best;
+    }
+
+    auto bench(int argc, char * argv[]) -> int
+    {
+        cout << "file regex_ms mapped_ms" << endl;
+        for (int i = 2 ; i < argc ; ++i) {
+            string filename = argv[i];
+            double regex_ms = time_ms([&] { return read_dimacs_regex(filename); });
+            double mapped_ms = time_ms([&] { return read_dimacs_mapped(filename); });
+            cout << filename << " " << regex_ms << " " << mapped_ms << endl;
+        }
+        return EXIT_SUCCESS;
+    }
+}
+
+auto main(int argc, char * argv[]) -> int
+{
+    try {
+        if (argc >= 2 && string{ argv[1] } == "--bench")
+            return bench(argc, argv);
+        else if (argc == 1)
+            return check();
+
+        cerr << "Usage: " << argv[0] << " [ --bench file ... ]" << endl;
+        return EXIT_FAILURE;
+    }
+    catch (const exception & e) {
+        cerr << "Error: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+}
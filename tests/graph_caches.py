@@ -0,0 +1,55 @@
+# Check that reading a graph from a cache gives the same omega and clique as
+# reading the original file, with and without an adjacency matrix in the
+# cache, and that truncated or corrupted caches are rejected rather than
+# crashing the solver.
+
+import os
+import subprocess
+import sys
+import tempfile
+
+from graphs import random_graph, run, solve, write_dimacs
+
+# the last of these is big and sparse enough that its cache has no matrix
+graphs = [(60, 0.5, 1), (150, 0.7, 2), (2000, 0.01, 3), (10000, 0.0005, 4)]
+
+def main(solver):
+    failures = 0
+    with tempfile.TemporaryDirectory() as directory:
+        path, cache, damaged = (os.path.join(directory, name) for name in ["g.clq", "g.gcs", "damaged.gcs"])
+        for n, p, seed in graphs:
+            write_dimacs(path, n, random_graph(n, p, seed))
+            expected = run(solver, path, [])
+            solve(solver, [path, "--write-cache", cache])
+            for extra in [[], ["--format", "cache"]]:
+                result = run(solver, cache, extra)
+                if result != expected:
+                    print(f"G({n}, {p}) seed {seed} cache {' '.join(extra)}: got {result}, expected {expected}")
+                    failures += 1
+
+        # damage the first graph's cache in various ways
+        n, p, seed = graphs[0]
+        write_dimacs(path, n, random_graph(n, p, seed))
+        solve(solver, [path, "--write-cache", cache])
+        with open(cache, "rb") as f:
+            contents = f.read()
+
+        damage = [("truncated to " + str(length), contents[:length])
+                for length in sorted({ 0, 1, 4, 8, 16, 32, 64, 128, len(contents) // 2, len(contents) - 8, len(contents) - 1 })]
+        for offset in range(0, len(contents), max(1, len(contents) // 200)):
+            for mask in [0x01, 0x80, 0xff]:
+                damage.append((f"byte {offset} xor {mask}", contents[:offset] + bytes([contents[offset] ^ mask]) + contents[offset + 1:]))
+
+        for description, data in damage:
+            with open(damaged, "wb") as f:
+                f.write(data)
+            for extra in [[], ["--format", "cache"]]:
+                result = subprocess.run([solver, damaged] + extra, capture_output=True, text=True, timeout=60)
+                if result.returncode < 0 or (result.returncode > 0 and not result.stderr.startswith("Error:")):
+                    print(f"{description} {' '.join(extra)}: exit status {result.returncode}, {result.stderr.strip()}")
+                    failures += 1
+
+    return 1 if failures else 0
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1]))
@@ -0,0 +1,61 @@
+# Helpers shared by the tests: random graphs, writing them out, and running
+# the solver.
+
+import math
+import random
+import re
+import subprocess
+
+def random_graph(n, p, seed):
+    r = random.Random(seed)
+    edges = set()
+    # skip over non-edges geometrically, rather than testing every pair
+    v, w, lp = 0, 0, math.log(1 - p)
+    while v < n:
+        w += 1 + int(math.log(1 - r.random()) / lp)
+        while w >= n and v < n:
+            v += 1
+            w = w - n + v + 1
+        if v < n:
+            edges.add((v + 1, w + 1))
+    return edges
+
+def write_dimacs(path, n, edges):
+    with open(path, "w") as f:
+        f.write(f"p edge {n} {len(edges)}\n")
+        for a, b in sorted(edges):
+            f.write(f"e {a} {b}\n")
+
+def write_lad(path, n, edges):
+    neighbours = [[] for _ in range(n)]
+    for a, b in edges:
+        neighbours[a - 1].append(b - 1)
+        neighbours[b - 1].append(a - 1)
+    with open(path, "w") as f:
+        f.write(f"{n}\n")
+        for ns in neighbours:
+            f.write(" ".join(str(x) for x in [len(ns)] + sorted(ns)) + "\n")
+
+def write_csv(path, edges):
+    with open(path, "w") as f:
+        for a, b in sorted(edges):
+            f.write(f"v{a},v{b}\n")
+
+# the result is a line of comma separated fields, and any statistics follow
+# on lines of their own
+def parse_output(output):
+    return dict(f.split(" = ", 1) for f in re.split("[,\n]", output.strip()) if " = " in f)
+
+def solve(solver, args, timeout=None):
+    return parse_output(subprocess.run([solver] + args, check=True, capture_output=True, text=True, timeout=timeout).stdout)
+
+def run(solver, path, args):
+    fields = solve(solver, [path] + args)
+    return int(fields["omega"]), [int(v) for v in fields["clique"].split()]
+
+def is_clique(edges, clique):
+    return all((min(a, b), max(a, b)) in edges for a in clique for b in clique if a != b)
+
+def rejected(solver, args):
+    result = subprocess.run([solver] + args, capture_output=True, text=True)
+    return result.returncode > 0 and result.stderr.startswith("Error:")
@@ -0,0 +1,39 @@
+# Check that restarts find the same omega as a plain run, that nogoods really
+# are deleted when asked, and that not keeping any nogoods still terminates.
+
+import os
+import sys
+import tempfile
+
+from graphs import random_graph, run, solve, write_dimacs
+
+graphs = [(200, 0.5, 1), (150, 0.7, 2), (120, 0.8, 3)]
+
+restarts = ["--restarts-constant", "50"]
+reduce = ["--nogood-reduce-interval", "2", "--nogood-reduce-fraction", "0.5"]
+
+def main(solver):
+    failures = 0
+    with tempfile.TemporaryDirectory() as directory:
+        path = os.path.join(directory, "g.clq")
+        for n, p, seed in graphs:
+            write_dimacs(path, n, random_graph(n, p, seed))
+            expected, _ = run(solver, path, [])
+
+            for extra in [[], reduce, ["--nogood-size-limit", "3"] + reduce, ["--nogood-size-limit", "0"]]:
+                fields = solve(solver, [path] + restarts + extra, timeout=300)
+                omega, restarted, deleted = int(fields["omega"]), int(fields["restarts"]), int(fields["nogoods_deleted"])
+                if omega != expected:
+                    print(f"G({n}, {p}) seed {seed} {' '.join(extra)}: omega {omega}, expected {expected}")
+                    failures += 1
+                if 0 == restarted:
+                    print(f"G({n}, {p}) seed {seed} {' '.join(extra)}: never restarted")
+                    failures += 1
+                if ("--nogood-reduce-interval" in extra) != (0 != deleted):
+                    print(f"G({n}, {p}) seed {seed} {' '.join(extra)}: {deleted} nogoods deleted")
+                    failures += 1
+
+    return 1 if failures else 0
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1]))
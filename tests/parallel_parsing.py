@@ -0,0 +1,55 @@
+# Check that LAD and CSV files parsed in several pieces give the same graph,
+# and so the same omega and clique, as parsing them in one piece, and the
+# same omega as the DIMACS file, and that errors are reported the same way.
+
+import os
+import subprocess
+import sys
+import tempfile
+
+from graphs import is_clique, random_graph, solve, write_csv, write_dimacs, write_lad
+
+graphs = [(60, 0.5, 1), (150, 0.7, 2), (2000, 0.01, 3)]
+
+pieces = ["1", "2", "3", "8", "64"]
+
+malformed = [("lad", "3\n1 1\n2 0 2\n1 1 junk\n"), ("lad", "3\n1 1\n2 0 7\n1 1\n"), ("lad", "3\n1 1\n2 0 2\n"),
+    ("csv", "a,b\nb,c\nno comma\nc,d\n"), ("csv", "a,b\nb,c\nc,d\nd,e\ne,f\nno comma\n")]
+
+def main(solver):
+    failures = 0
+    with tempfile.TemporaryDirectory() as directory:
+        dimacs, lad, csv = (os.path.join(directory, name) for name in ["g.clq", "g.lad", "g.csv"])
+        for n, p, seed in graphs:
+            edges = random_graph(n, p, seed)
+            write_dimacs(dimacs, n, edges)
+            write_lad(lad, n, edges)
+            write_csv(csv, edges)
+            expected = int(solve(solver, [dimacs])["omega"])
+
+            for path, extra in [(lad, ["--format", "lad"]), (csv, [])]:
+                serial = solve(solver, [path, "--parse-pieces", "1"] + extra)
+                for k in pieces:
+                    fields = solve(solver, [path, "--parse-pieces", k] + extra)
+                    clique = [int(v.lstrip("v")) + (1 if path == lad else 0) for v in fields["clique"].split()]
+                    if int(fields["omega"]) != expected or fields["clique"] != serial["clique"] or not is_clique(edges, clique):
+                        print(f"G({n}, {p}) seed {seed} {os.path.basename(path)} in {k} pieces: omega {fields['omega']}, "
+                                f"expected {expected}, clique {fields['clique']}, serial clique {serial['clique']}")
+                        failures += 1
+
+        for format, contents in malformed:
+            path = os.path.join(directory, "bad." + format)
+            with open(path, "w") as f:
+                f.write(contents)
+            errors = set()
+            for k in pieces:
+                result = subprocess.run([solver, path, "--format", format, "--parse-pieces", k], capture_output=True, text=True)
+                errors.add((result.returncode, result.stderr))
+            if len(errors) != 1 or next(iter(errors))[0] <= 0:
+                print(f"{format} file {contents!r}: {errors}")
+                failures += 1
+
+    return 1 if failures else 0
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1]))
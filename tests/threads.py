@@ -0,0 +1,38 @@
+# Check that searching with several threads finds the same omega as a single
+# thread, and reports a real clique, and that the options which need a single
+# thread are rejected.
+
+import os
+import sys
+import tempfile
+
+from graphs import is_clique, random_graph, rejected, run, write_dimacs
+
+graphs = [(200, 0.5, 1), (150, 0.7, 2), (120, 0.8, 3), (2000, 0.01, 4)]
+
+def main(solver):
+    failures = 0
+    with tempfile.TemporaryDirectory() as directory:
+        path = os.path.join(directory, "g.clq")
+        for n, p, seed in graphs:
+            edges = random_graph(n, p, seed)
+            write_dimacs(path, n, edges)
+
+            expected, _ = run(solver, path, [])
+            for threads in ["1", "2", "4", "0"]:
+                omega, clique = run(solver, path, ["--threads", threads])
+                really = is_clique(edges, clique)
+                if omega != expected or len(clique) != omega or not really:
+                    print(f"G({n}, {p}) seed {seed} --threads {threads}: omega {omega}, expected {expected}, "
+                            f"clique {clique}{'' if really else ' is not a clique'}")
+                    failures += 1
+
+        for extra in [["--prove", os.path.join(directory, "proof")], ["--restarts-constant", "100"]]:
+            if not rejected(solver, [path, "--threads", "2"] + extra):
+                print(f"--threads 2 {' '.join(extra)} was not rejected")
+                failures += 1
+
+    return 1 if failures else 0
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1]))
@@ -0,0 +1,38 @@
+# Check that --tighten-bounds finds the same omega as a plain run, with and
+# without proof logging, and that both ways of tightening get used.
+
+import os
+import sys
+import tempfile
+
+from graphs import is_clique, random_graph, solve, write_dimacs
+
+graphs = [(60, 0.5, 1), (120, 0.7, 2), (90, 0.9, 3), (150, 0.5, 4), (300, 0.1, 5)]
+
+def main(solver):
+    failures = 0
+    recoloured, conflicts = 0, 0
+    with tempfile.TemporaryDirectory() as directory:
+        path, proof = os.path.join(directory, "g.clq"), os.path.join(directory, "proof")
+        for n, p, seed in graphs:
+            edges = random_graph(n, p, seed)
+            write_dimacs(path, n, edges)
+            expected = int(solve(solver, [path])["omega"])
+
+            for extra in [[], ["--prove", proof]]:
+                fields = solve(solver, [path, "--tighten-bounds"] + extra)
+                clique = [int(v) for v in fields["clique"].split()]
+                if int(fields["omega"]) != expected or len(clique) != expected or not is_clique(edges, clique):
+                    print(f"G({n}, {p}) seed {seed} {' '.join(extra)}: omega {fields['omega']}, expected {expected}, clique {clique}")
+                    failures += 1
+                recoloured += int(fields["tightened_by_recolouring"])
+                conflicts += int(fields["tightened_by_conflicts"])
+
+    if 0 == recoloured or 0 == conflicts:
+        print(f"only {recoloured} vertices were recoloured and {conflicts} were in conflicts")
+        failures += 1
+
+    return 1 if failures else 0
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1]))